@@ -0,0 +1,244 @@
+/**
+ * @file fragment_stress.cpp
+ * @brief Stress test of CFragmentReassembler with lost, reordered, duplicated and malformed fragments.
+ * @details fragments of many messages are interleaved randomly within a reorder window and fed to one reassembler
+ * as a receiver thread would. every completed message is compared byte by byte with what was sent.
+ *
+ * a message must complete if all its fragments arrived at least once and must not complete otherwise.
+ * malformed messages have a hole or an overlap between fragments and must never complete.
+ *
+ * exits with 1 if any message is corrupted, completed wrongly or missed.
+ *
+ * usage: de_fragment_stress [-n messages] [-l max length] [-f fragment length] [-p loss %] [-d duplicate %] [-w reorder window] [-m malformed %] [-s seed]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <getopt.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "../src/helpers/helpers.hpp"
+#include "../src/messageFragments.hpp"
+
+
+typedef struct
+{
+    uint32_t message_id;
+    std::string datagram;
+} STRESS_FRAGMENT;
+
+
+typedef struct
+{
+    uint32_t length;
+    bool malformed;
+    bool all_delivered;
+    bool completed;
+} STRESS_MESSAGE;
+
+
+static unsigned int message_count = 20000;
+static unsigned int max_length = 64 * 1024;
+static unsigned int fragment_length = 1400;
+static unsigned int loss_percent = 2;
+static unsigned int duplicate_percent = 5;
+static unsigned int reorder_window = 64;
+static unsigned int malformed_percent = 1;
+static unsigned int seed = 1;
+
+
+/**
+ * @brief content of a message is derived from its id so it can be checked when completed.
+ * @details first 4 bytes hold the id.
+ */
+static std::string make_message (const uint32_t message_id, const uint32_t length)
+{
+    std::string message(length, 0);
+    for (uint32_t i=0; i<length; ++i)
+    {
+        message[i] = (char) ((message_id * 31 + i * 7) & 0xff);
+    }
+    memcpy(&message[0], &message_id, sizeof(message_id));
+
+    return message;
+}
+
+
+static std::string make_fragment (const std::string& message, const uint32_t message_id, const uint32_t offset, const uint32_t length, const uint16_t index, const uint16_t count)
+{
+    uavos::comm::FRAGMENT_HEADER header;
+    uavos::comm::buildFragmentHeader(header, message_id, message.length(), offset, index, count);
+
+    std::string datagram((const char *) &header, sizeof(header));
+    datagram.append(message, offset, length);
+
+    return datagram;
+}
+
+
+int main (int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:f:p:d:w:m:s:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': message_count = std::stoul(optarg); break;
+            case 'l': max_length = std::stoul(optarg); break;
+            case 'f': fragment_length = std::stoul(optarg); break;
+            case 'p': loss_percent = std::stoul(optarg); break;
+            case 'd': duplicate_percent = std::stoul(optarg); break;
+            case 'w': reorder_window = std::stoul(optarg); break;
+            case 'm': malformed_percent = std::stoul(optarg); break;
+            case 's': seed = std::stoul(optarg); break;
+            default:
+                std::cout << "usage: " << argv[0] << " [-n messages] [-l max length] [-f fragment length] [-p loss %] [-d duplicate %] [-w reorder window] [-m malformed %] [-s seed]" << std::endl;
+                return 0;
+        }
+    }
+
+    if ((max_length < sizeof(uint32_t) + 1) || (fragment_length < 2) || (reorder_window == 0))
+    {
+        std::cout << "max length should be > 4, fragment length > 1 and reorder window > 0" << std::endl;
+        return 1;
+    }
+
+    std::cout << "messages:" << message_count << " max length:" << max_length << " fragment:" << fragment_length
+              << " loss:" << loss_percent << "% duplicates:" << duplicate_percent << "% reorder window:" << reorder_window
+              << " malformed:" << malformed_percent << "% seed:" << seed << std::endl;
+
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<uint32_t> length_distribution(sizeof(uint32_t) + 1, max_length);
+    std::uniform_int_distribution<unsigned int> percent(0, 99);
+
+    SOCKET_ADDRESS sender;
+    memset(&sender, 0, sizeof(sender));
+    struct sockaddr_in * address = (struct sockaddr_in *) &sender.address;
+    address->sin_family = AF_INET;
+    address->sin_port = htons(61000);
+    address->sin_addr.s_addr = inet_addr("127.0.0.1");
+    sender.length = sizeof(struct sockaddr_in);
+
+    uavos::comm::CFragmentReassembler reassembler;
+    std::vector<STRESS_MESSAGE> messages(message_count);
+    std::vector<STRESS_FRAGMENT> window;
+    std::vector<char> completed;
+    uint64_t completed_ingress_nsec = 0;
+    uint64_t corrupted = 0, wrongly_completed = 0, fragments_fed = 0;
+
+    const auto feed = [&](const STRESS_FRAGMENT& fragment)
+    {
+        fragments_fed++;
+        if (!reassembler.addFragment(fragment.datagram.c_str(), fragment.datagram.length(), &sender, get_time_usec() * 1000, completed, completed_ingress_nsec)) return ;
+
+        uint32_t message_id;
+        memcpy(&message_id, completed.data(), sizeof(message_id));
+        if ((message_id != fragment.message_id) || (message_id >= message_count))
+        {
+            corrupted++;
+            return ;
+        }
+
+        STRESS_MESSAGE& message = messages[message_id];
+        const std::string expected = make_message(message_id, message.length);
+        if ((completed.size() != expected.length()) || (memcmp(completed.data(), expected.c_str(), expected.length()) != 0))
+        {
+            corrupted++;
+        }
+        if ((message.malformed) || (!message.all_delivered) || (message.completed))
+        {
+            wrongly_completed++;
+        }
+        message.completed = true;
+    };
+
+    const auto feed_random = [&]()
+    {
+        std::uniform_int_distribution<std::size_t> pick(0, window.size() - 1);
+        const std::size_t index = pick(random);
+        std::swap(window[index], window.back());
+        const STRESS_FRAGMENT fragment = std::move(window.back());
+        window.pop_back();
+        feed(fragment);
+    };
+
+    const uint64_t time_start = get_time_usec();
+    for (uint32_t message_id=0; message_id<message_count; ++message_id)
+    {
+        STRESS_MESSAGE& message = messages[message_id];
+        message.length = length_distribution(random);
+        message.completed = false;
+        message.all_delivered = true;
+
+        const std::string content = make_message(message_id, message.length);
+        const uint16_t count = (message.length + fragment_length - 1) / fragment_length;
+
+        // a hole or an overlap needs at least two fragments.
+        message.malformed = (count > 1) && (percent(random) < malformed_percent);
+        const bool hole = message.malformed && ((message_id % 2) == 0);
+
+        for (uint16_t index=0; index<count; ++index)
+        {
+            uint32_t offset = index * fragment_length;
+            uint32_t length = std::min<uint32_t>(fragment_length, message.length - offset);
+            if ((message.malformed) && (index == 1))
+            {
+                if (hole)
+                {
+                    // second fragment starts one byte late and is one byte short.
+                    offset += 1;
+                    length -= 1;
+                }
+                else
+                {
+                    // second fragment overlaps first one by a byte.
+                    offset -= 1;
+                }
+            }
+
+            if (percent(random) < loss_percent)
+            {
+                message.all_delivered = false;
+                continue;
+            }
+
+            const std::string datagram = make_fragment(content, message_id, offset, length, index, count);
+            window.push_back({message_id, datagram});
+            if (percent(random) < duplicate_percent)
+            {
+                window.push_back({message_id, datagram});
+            }
+
+            while (window.size() > reorder_window) feed_random();
+        }
+    }
+    while (!window.empty()) feed_random();
+    const uint64_t elapsed_usec = get_time_usec() - time_start;
+
+    // partial messages of lost fragments are released by timeout.
+    reassembler.expire(get_time_usec() + FRAGMENT_TIMEOUT_USEC + 1);
+
+    uint64_t expected_completed = 0, missed = 0;
+    for (const STRESS_MESSAGE& message : messages)
+    {
+        const bool should_complete = (message.all_delivered) && (!message.malformed);
+        if (should_complete) expected_completed++;
+        if ((should_complete) && (!message.completed)) missed++;
+    }
+
+    const uavos::comm::FRAGMENT_COUNTERS& counters = reassembler.getCounters();
+    std::cout << "fragments:" << fragments_fed << " completed:" << counters.completed << " expected:" << expected_completed
+              << " expired:" << counters.expired << " dropped:" << counters.dropped
+              << " us/fragment:" << std::setprecision(3) << ((fragments_fed != 0) ? (double) elapsed_usec / fragments_fed : 0) << std::endl;
+    std::cout << "corrupted:" << corrupted << " wrongly completed:" << wrongly_completed << " missed:" << missed << std::endl;
+
+    const bool failed = (corrupted != 0) || (wrongly_completed != 0) || (missed != 0);
+    std::cout << (failed ? "FAILED" : "PASSED") << std::endl;
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,352 @@
+/**
+ * @file intermodule_parse_bench.cpp
+ * @brief Compares full JSON DOM parsing of intermodule messages with header scanning.
+ * @details DOM: Json::parse of every message then routing fields & ms are read (old parseIntermoduleMessage).
+ * SCAN: scanIntermoduleHeader then Json::parse only for messages that needsFullParse.
+ *
+ * traffic is read from a capture of communicator port:
+ *     tcpdump -i lo -w modules.pcap udp dst port 60000
+ * without a capture a MAVLink-heavy mix is generated like a vehicle with fcb, camera & telemetry modules.
+ *
+ * usage: de_parse_bench [-f capture.pcap] [-p port] [-n passes] [-m generated messages]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <getopt.h>
+#include <arpa/inet.h>
+
+#include "../src/helpers/helpers.hpp"
+#include "../src/messages.hpp"
+#include "../src/uavos/uavos_message_scanner.hpp"
+
+
+#define PCAP_MAGIC              0xa1b2c3d4
+#define PCAP_MAGIC_NSEC         0xa1b23c4d
+#define PCAP_LINKTYPE_NULL      0
+#define PCAP_LINKTYPE_ETHERNET  1
+#define PCAP_LINKTYPE_RAW       101
+#define PCAP_LINKTYPE_SLL       113
+#define PCAP_LINKTYPE_SLL2      276
+
+
+static std::string capture_file;
+static unsigned int capture_port = 60000;
+static unsigned int passes = 20;
+static unsigned int generated_messages = 20000;
+
+
+static inline uint32_t swap32 (const uint32_t value, const bool swapped)
+{
+    return swapped ? __builtin_bswap32(value) : value;
+}
+
+
+/**
+ * @brief UDP payload of an IPv4 or IPv6 packet if its destination is port.
+ */
+static bool udp_payload (const unsigned char * packet, const std::size_t length, const unsigned int port, std::string& payload)
+{
+    if (length < 1) return false;
+
+    std::size_t offset;
+    const unsigned int version = packet[0] >> 4;
+    if (version == 4)
+    {
+        if (length < 20) return false;
+        const std::size_t header_length = (packet[0] & 0x0f) * 4;
+        // IP fragments are not reassembled.
+        const uint16_t fragment = (packet[6] << 8) | packet[7];
+        if ((packet[9] != 17) || ((fragment & 0x3fff) != 0)) return false;
+        offset = header_length;
+    }
+    else if (version == 6)
+    {
+        if ((length < 40) || (packet[6] != 17)) return false;
+        offset = 40;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (length < offset + 8) return false;
+    const unsigned int destination = (packet[offset + 2] << 8) | packet[offset + 3];
+    if (destination != port) return false;
+
+    payload.assign((const char *) packet + offset + 8, length - offset - 8);
+    return true;
+}
+
+
+static bool read_capture (const std::string& file_name, std::vector<std::string>& messages)
+{
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file) return false;
+
+    unsigned char global_header[24];
+    if (!file.read((char *) global_header, sizeof(global_header))) return false;
+
+    uint32_t magic;
+    memcpy(&magic, global_header, 4);
+    const bool swapped = (magic != PCAP_MAGIC) && (magic != PCAP_MAGIC_NSEC);
+    if ((swapped) && (swap32(magic, true) != PCAP_MAGIC) && (swap32(magic, true) != PCAP_MAGIC_NSEC))
+    {
+        std::cout << file_name << " is not a pcap file. pcapng is not supported." << std::endl;
+        return false;
+    }
+
+    uint32_t link_type;
+    memcpy(&link_type, global_header + 20, 4);
+    link_type = swap32(link_type, swapped);
+
+    std::size_t link_header;
+    switch (link_type)
+    {
+        case PCAP_LINKTYPE_NULL:     link_header = 4;  break;
+        case PCAP_LINKTYPE_ETHERNET: link_header = 14; break;
+        case PCAP_LINKTYPE_RAW:      link_header = 0;  break;
+        case PCAP_LINKTYPE_SLL:      link_header = 16; break;
+        case PCAP_LINKTYPE_SLL2:     link_header = 20; break;
+        default:
+            std::cout << "unsupported pcap link type " << link_type << std::endl;
+            return false;
+    }
+
+    unsigned char record_header[16];
+    std::vector<unsigned char> packet;
+    std::string payload;
+    while (file.read((char *) record_header, sizeof(record_header)))
+    {
+        uint32_t captured_length;
+        memcpy(&captured_length, record_header + 8, 4);
+        captured_length = swap32(captured_length, swapped);
+
+        packet.resize(captured_length);
+        if (!file.read((char *) packet.data(), captured_length)) break;
+        if (captured_length <= link_header) continue;
+
+        if (!udp_payload(packet.data() + link_header, captured_length - link_header, capture_port, payload)) continue;
+        // fragments of large messages are not intermodule messages by themselves.
+        if ((payload.empty()) || (payload[0] != '{')) continue;
+        messages.push_back(payload);
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief MAVLink v2 frame with random payload.
+ */
+static std::string mavlink_frame (std::mt19937& rng, const unsigned int payload_length, const uint32_t message_id)
+{
+    std::string frame;
+    frame.push_back((char) 0xFD);
+    frame.push_back((char) payload_length);
+    frame.push_back(0);
+    frame.push_back(0);
+    frame.push_back((char) (rng() & 0xff));
+    frame.push_back(1);
+    frame.push_back(1);
+    frame.push_back((char) (message_id & 0xff));
+    frame.push_back((char) ((message_id >> 8) & 0xff));
+    frame.push_back((char) ((message_id >> 16) & 0xff));
+    for (unsigned int i=0; i<payload_length + 2; ++i)
+    {
+        frame.push_back((char) (rng() & 0xff));
+    }
+    // communicator takes a message that ends with '}' as text.
+    if (frame.back() == '}') frame.back() = 0;
+    return frame;
+}
+
+
+static void generate_traffic (std::vector<std::string>& messages)
+{
+    std::mt19937 rng(7);
+
+    for (unsigned int i=0; i<generated_messages; ++i)
+    {
+        const unsigned int kind = rng() % 100;
+        Json message;
+        if (kind < 75)
+        {
+            // fcb module: MAVLink to GCS. one or more frames per message.
+            message[INTERMODULE_ROUTING_TYPE]       = CMD_COMM_GROUP;
+            message[ANDRUAV_PROTOCOL_MESSAGE_TYPE]  = TYPE_AndruavMessage_MAVLINK;
+            message[INTERMODULE_MODULE_KEY]         = "fcb_module_key_123456";
+            message[ANDRUAV_PROTOCOL_MESSAGE_CMD]   = Json::object();
+            std::string text = message.dump();
+            text.push_back(0);
+            const unsigned int frames = 1 + rng() % 4;
+            for (unsigned int f=0; f<frames; ++f) text += mavlink_frame(rng, 9 + rng() % 60, rng() % 300);
+            messages.push_back(text);
+            continue;
+        }
+
+        if (kind < 90)
+        {
+            // telemetry summaries in text.
+            message[INTERMODULE_ROUTING_TYPE]       = CMD_COMM_GROUP;
+            message[ANDRUAV_PROTOCOL_MESSAGE_TYPE]  = TYPE_AndruavMessage_NAV_INFO;
+            message[INTERMODULE_MODULE_KEY]         = "fcb_module_key_123456";
+            message[ANDRUAV_PROTOCOL_MESSAGE_CMD]   = {{"a", (int) (rng() % 360)}, {"b", (int) (rng() % 90)}, {"c", (int) (rng() % 180)},
+                                                       {"d", (rng() % 1000) / 10.0}, {"e", (rng() % 1000) / 10.0}, {"f", (int) (rng() % 100000)}};
+        }
+        else if (kind < 95)
+        {
+            // module to module.
+            message[INTERMODULE_ROUTING_TYPE]       = CMD_TYPE_INTERMODULE;
+            message[ANDRUAV_PROTOCOL_MESSAGE_TYPE]  = TYPE_AndruavMessage_RemoteExecute;
+            message[INTERMODULE_MODULE_KEY]         = "camera_module_key_654321";
+            message[ANDRUAV_PROTOCOL_MESSAGE_CMD]   = {{"C", 102}, {"Act", true}};
+        }
+        else
+        {
+            // interpreted by communicator.
+            message[INTERMODULE_ROUTING_TYPE]       = CMD_TYPE_INTERMODULE;
+            message[ANDRUAV_PROTOCOL_MESSAGE_TYPE]  = TYPE_AndruavModule_Location_Info;
+            message[ANDRUAV_PROTOCOL_MESSAGE_CMD]   = {{"la", (int) rng()}, {"ln", (int) rng()}, {"a", (int) (rng() % 1000)},
+                                                       {"r", (int) (rng() % 1000)}, {"ha", 3}, {"y", (int) (rng() % 360)}};
+        }
+        messages.push_back(message.dump());
+    }
+}
+
+
+/**
+ * @brief routing the way parseIntermoduleMessage did before header scanning.
+ */
+static uint64_t route_dom (const std::string& message)
+{
+    Json json_message;
+    try
+    {
+        json_message = Json::parse(message.c_str());
+    }
+    catch (...)
+    {
+        return 0;
+    }
+
+    if ((!validateField(json_message, INTERMODULE_ROUTING_TYPE, Json::value_t::string))
+        || (!validateField(json_message, ANDRUAV_PROTOCOL_MESSAGE_TYPE, Json::value_t::number_unsigned)))
+    {
+        return 0;
+    }
+
+    const std::string routing_type = json_message[INTERMODULE_ROUTING_TYPE].get<std::string>();
+    std::string target_id;
+    if (json_message.contains(ANDRUAV_PROTOCOL_TARGET_ID)) target_id = json_message[ANDRUAV_PROTOCOL_TARGET_ID].get<std::string>();
+    std::string module_key;
+    if (json_message.contains(INTERMODULE_MODULE_KEY)) module_key = json_message[INTERMODULE_MODULE_KEY].get<std::string>();
+    const int mt = json_message[ANDRUAV_PROTOCOL_MESSAGE_TYPE].get<int>();
+    const Json ms = json_message[ANDRUAV_PROTOCOL_MESSAGE_CMD];
+
+    return mt + routing_type.length() + target_id.length() + module_key.length() + ms.size();
+}
+
+
+static uint64_t route_scan (const std::string& message)
+{
+    uavos::INTERMODULE_MESSAGE_HEADER header;
+    if (!uavos::scanIntermoduleHeader(message.c_str(), message.length(), header)) return 0;
+    if ((!header.has_routing_type) || (header.message_type < 0)) return 0;
+
+    std::size_t ms_size = header.ms_length;
+    if (uavos::needsFullParse(header.message_type))
+    {
+        try
+        {
+            const Json json_message = Json::parse(message.c_str(), message.c_str() + header.json_length);
+            ms_size = json_message[ANDRUAV_PROTOCOL_MESSAGE_CMD].size();
+        }
+        catch (...)
+        {
+            return 0;
+        }
+    }
+
+    return header.message_type + header.routing_type.length() + header.target_id.length() + header.module_key.length() + ms_size;
+}
+
+
+template <typename ROUTE>
+static uint64_t measure (const std::vector<std::string>& messages, ROUTE route, uint64_t& checksum)
+{
+    checksum = 0;
+    const uint64_t start = get_time_usec();
+    for (unsigned int p=0; p<passes; ++p)
+    {
+        for (const std::string& message : messages) checksum += route(message);
+    }
+    return get_time_usec() - start;
+}
+
+
+int main (int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "f:p:n:m:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f': capture_file = optarg; break;
+            case 'p': capture_port = std::stoul(optarg); break;
+            case 'n': passes = std::stoul(optarg); break;
+            case 'm': generated_messages = std::stoul(optarg); break;
+            default:
+                std::cout << "usage: " << argv[0] << " [-f capture.pcap] [-p port] [-n passes] [-m generated messages]" << std::endl;
+                return 0;
+        }
+    }
+
+    std::vector<std::string> messages;
+    if (!capture_file.empty())
+    {
+        if (!read_capture(capture_file, messages)) return 1;
+        std::cout << "capture:" << capture_file << " port:" << capture_port;
+    }
+    else
+    {
+        generate_traffic(messages);
+        std::cout << "generated MAVLink-heavy traffic";
+    }
+
+    if ((messages.empty()) || (passes == 0))
+    {
+        std::cout << " no messages" << std::endl;
+        return 1;
+    }
+
+    uint64_t bytes = 0;
+    uint64_t full_parse = 0;
+    for (const std::string& message : messages)
+    {
+        bytes += message.length();
+        uavos::INTERMODULE_MESSAGE_HEADER header;
+        if ((uavos::scanIntermoduleHeader(message.c_str(), message.length(), header)) && (uavos::needsFullParse(header.message_type))) full_parse++;
+    }
+    std::cout << " messages:" << messages.size() << " avg length:" << bytes / messages.size()
+              << " need DOM:" << std::fixed << std::setprecision(1) << 100.0 * full_parse / messages.size() << "%" << std::endl;
+
+    uint64_t dom_checksum, scan_checksum;
+    const uint64_t dom_usec  = measure(messages, route_dom, dom_checksum);
+    const uint64_t scan_usec = measure(messages, route_scan, scan_checksum);
+
+    const double total = (double) messages.size() * passes;
+    std::cout << std::setprecision(0)
+              << "DOM   ns/msg:" << std::setw(7) << dom_usec * 1000.0 / total  << " MB/s:" << std::setw(6) << bytes * passes / (double) dom_usec << std::endl
+              << "SCAN  ns/msg:" << std::setw(7) << scan_usec * 1000.0 / total << " MB/s:" << std::setw(6) << bytes * passes / (double) scan_usec << std::endl
+              << std::setprecision(1) << "speedup:" << (double) dom_usec / scan_usec << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,439 @@
+/**
+ * @file module_loadgen.cpp
+ * @brief Load generator of intermodule traffic against a running communicator (de_comm).
+ * @details starts N fake modules on loopback. each module registers with TYPE_AndruavModule_ID,
+ * subscribes to text & binary message types then sends a weighted mix of:
+ *
+ * text:   intermodule JSON (TYPE_AndruavMessage_NAV_INFO) forwarded by communicator to other modules.
+ * binary: intermodule JSON + binary part (TYPE_AndruavMessage_MAVLINK) forwarded to other modules.
+ * img:    TYPE_AndruavMessage_IMG to Andruav server. dropped by communicator when it is offline.
+ *
+ * a module does not receive its own messages so each text/binary message is expected by N-1 modules.
+ * drops are expected deliveries that did not arrive.
+ *
+ * usage: de_loadgen [-H comm host] [-p comm port] [-n modules] [-d seconds] [-r msgs/sec per module (0 max)]
+ *                   [-x text:binary:img weights] [-l payload length] [-b first module port] [-P de_comm pid]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "../src/helpers/helpers.hpp"
+#include "../src/messages.hpp"
+
+
+// maximum UDP payload size.
+#define LOADGEN_MAXLINE             65507
+// time to wait for communicator to reply to registration.
+#define LOADGEN_REGISTER_USEC       2000000
+// messages still in flight are collected for this time after sending stops.
+#define LOADGEN_DRAIN_USEC          1000000
+#define LOADGEN_RECEIVE_TIMEOUT_USEC 100000
+
+
+typedef enum
+{
+    LOADGEN_TEXT    = 0,
+    LOADGEN_BINARY  = 1,
+    LOADGEN_IMG     = 2,
+    LOADGEN_KINDS   = 3
+} ENUM_LOADGEN_KIND;
+
+
+/**
+ * @brief counters of one fake module.
+ */
+typedef struct
+{
+    std::atomic<uint64_t> sent[LOADGEN_KINDS];
+    std::atomic<uint64_t> sent_bytes;
+    std::atomic<uint64_t> send_errors;
+    std::atomic<uint64_t> received;
+    std::atomic<uint64_t> received_bytes;
+    std::atomic<uint64_t> foreign;
+    std::atomic<bool>     registered;
+} LOADGEN_MODULE;
+
+
+static std::string comm_host = "127.0.0.1";
+static unsigned int comm_port = 60000;
+static unsigned int modules_count = 4;
+static unsigned int duration_sec = 5;
+static unsigned int rate_per_module = 1000;
+static unsigned int weights[LOADGEN_KINDS] = {70, 20, 10};
+static unsigned int payload_length = 200;
+static unsigned int first_module_port = 62000;
+static int comm_pid = -1;
+
+static std::atomic<bool> sending = {true};
+static std::atomic<bool> receiving = {true};
+
+
+static uint64_t cpu_time_usec ()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull
+            + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+
+/**
+ * @brief user+system cpu time of another process from /proc.
+ *
+ * @return uint64_t 0 if process is not found.
+ */
+static uint64_t process_cpu_time_usec (const int pid)
+{
+    std::ifstream stat_file("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(stat_file, line)) return 0;
+
+    // process name may contain spaces. fields are counted after its closing bracket.
+    const std::size_t name_end = line.rfind(')');
+    if (name_end == std::string::npos) return 0;
+
+    std::istringstream fields(line.substr(name_end + 2));
+    std::string field;
+    uint64_t utime = 0, stime = 0;
+    // utime & stime are fields 14 & 15. field 3 is first one after name.
+    for (int i=3; i<=15; ++i)
+    {
+        if (!(fields >> field)) return 0;
+        if (i == 14) utime = std::stoull(field);
+        if (i == 15) stime = std::stoull(field);
+    }
+
+    return (utime + stime) * 1000000ull / sysconf(_SC_CLK_TCK);
+}
+
+
+static struct sockaddr_in make_address (const std::string& host, const int port)
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = inet_addr(host.c_str());
+    return address;
+}
+
+
+/**
+ * @brief module id is unique per run as communicator keeps the address of a known module id.
+ */
+static std::string module_id (const unsigned int index)
+{
+    return "loadgen_" + std::to_string(getpid()) + "_" + std::to_string(index);
+}
+
+
+static std::string module_key (const unsigned int index)
+{
+    // communicator matches sender key as substring so keys should not contain each other.
+    std::ostringstream key;
+    key << "loadgen_" << getpid() << "_" << std::setw(5) << std::setfill('0') << index << "_key";
+    return key.str();
+}
+
+
+static std::string registration_message (const unsigned int index)
+{
+    Json ms;
+    ms[JSON_INTERMODULE_MODULE_ID]              = module_id(index);
+    ms[JSON_INTERMODULE_MODULE_CLASS]           = "loadgen";
+    ms[JSON_INTERMODULE_MODULE_MESSAGES_LIST]   = Json::array({TYPE_AndruavMessage_NAV_INFO, TYPE_AndruavMessage_MAVLINK});
+    ms[JSON_INTERMODULE_MODULE_FEATURES]        = Json::array();
+    ms[JSON_INTERMODULE_MODULE_KEY]             = module_key(index);
+    ms[JSON_INTERMODULE_RESEND]                 = true;
+
+    Json message;
+    message[INTERMODULE_ROUTING_TYPE]       = CMD_TYPE_INTERMODULE;
+    message[ANDRUAV_PROTOCOL_MESSAGE_TYPE]  = TYPE_AndruavModule_ID;
+    message[ANDRUAV_PROTOCOL_MESSAGE_CMD]   = ms;
+
+    return message.dump();
+}
+
+
+/**
+ * @brief build the three kinds of messages sent by module index.
+ */
+static void build_messages (const unsigned int index, std::string messages[LOADGEN_KINDS])
+{
+    Json text;
+    text[INTERMODULE_ROUTING_TYPE]          = CMD_TYPE_INTERMODULE;
+    text[ANDRUAV_PROTOCOL_MESSAGE_TYPE]     = TYPE_AndruavMessage_NAV_INFO;
+    text[INTERMODULE_MODULE_KEY]            = module_key(index);
+    text[ANDRUAV_PROTOCOL_MESSAGE_CMD]      = {{"p", std::string(payload_length, 'x')}};
+    messages[LOADGEN_TEXT] = text.dump();
+
+    // JSON part, zero delimiter then binary part.
+    Json binary;
+    binary[INTERMODULE_ROUTING_TYPE]        = CMD_TYPE_INTERMODULE;
+    binary[ANDRUAV_PROTOCOL_MESSAGE_TYPE]   = TYPE_AndruavMessage_MAVLINK;
+    binary[INTERMODULE_MODULE_KEY]          = module_key(index);
+    binary[ANDRUAV_PROTOCOL_MESSAGE_CMD]    = Json::object();
+    messages[LOADGEN_BINARY] = binary.dump();
+    messages[LOADGEN_BINARY].push_back(0);
+    // binary part should not end with '}' or it is taken as text.
+    messages[LOADGEN_BINARY].append(payload_length, (char) 0xAB);
+
+    Json img;
+    img[INTERMODULE_ROUTING_TYPE]           = CMD_COMM_GROUP;
+    img[ANDRUAV_PROTOCOL_MESSAGE_TYPE]      = TYPE_AndruavMessage_IMG;
+    img[INTERMODULE_MODULE_KEY]             = module_key(index);
+    img[ANDRUAV_PROTOCOL_MESSAGE_CMD]       = Json::object();
+    messages[LOADGEN_IMG] = img.dump();
+    messages[LOADGEN_IMG].push_back(0);
+    messages[LOADGEN_IMG].append(payload_length, (char) 0xFF);
+}
+
+
+static void receiver_entry (const int fd, LOADGEN_MODULE& module)
+{
+    // messages of modules of a previous run may still be forwarded by communicator.
+    const std::string run_prefix = "\"loadgen_" + std::to_string(getpid()) + "_";
+    char buffer[LOADGEN_MAXLINE + 1];
+    while (receiving)
+    {
+        const ssize_t length = recv(fd, buffer, LOADGEN_MAXLINE, 0);
+        if (length <= 0) continue;
+
+        buffer[length] = 0;
+        // ID of communicator is a reply to registration and is not counted as traffic.
+        if (strstr(buffer, "\"mt\":9100") != NULL)
+        {
+            module.registered = true;
+            continue;
+        }
+
+        if (strstr(buffer, run_prefix.c_str()) == NULL)
+        {
+            module.foreign++;
+            continue;
+        }
+
+        module.received++;
+        module.received_bytes += length;
+    }
+}
+
+
+static void sender_entry (const int fd, const unsigned int index, LOADGEN_MODULE& module)
+{
+    const struct sockaddr_in comm_address = make_address(comm_host, comm_port);
+
+    std::string messages[LOADGEN_KINDS];
+    build_messages(index, messages);
+
+    // deterministic interleaving of kinds according to weights.
+    std::vector<int> pattern;
+    for (int kind=0; kind<LOADGEN_KINDS; ++kind)
+    {
+        for (unsigned int w=0; w<weights[kind]; ++w) pattern.push_back(kind);
+    }
+    if (pattern.empty()) return ;
+    for (std::size_t i=0; i<pattern.size(); ++i)
+    {
+        std::swap(pattern[i], pattern[(i * 7919 + index) % pattern.size()]);
+    }
+
+    const uint64_t start = get_time_usec();
+    uint64_t count = 0;
+    while (sending)
+    {
+        if (rate_per_module != 0)
+        {
+            // stay on schedule instead of sleeping a fixed time per message.
+            const uint64_t due = start + count * 1000000ull / rate_per_module;
+            const uint64_t now = get_time_usec();
+            if (due > now) usleep(std::min<uint64_t>(due - now, 10000));
+            if (due > get_time_usec()) continue;
+        }
+
+        const int kind = pattern[count % pattern.size()];
+        const std::string& message = messages[kind];
+        if (sendto(fd, message.c_str(), message.length(), 0, (const struct sockaddr *) &comm_address, sizeof(comm_address)) < 0)
+        {
+            module.send_errors++;
+        }
+        else
+        {
+            module.sent[kind]++;
+            module.sent_bytes += message.length();
+        }
+        count++;
+    }
+}
+
+
+int main (int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:n:d:r:x:l:b:P:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'H': comm_host = optarg; break;
+            case 'p': comm_port = std::stoul(optarg); break;
+            case 'n': modules_count = std::stoul(optarg); break;
+            case 'd': duration_sec = std::stoul(optarg); break;
+            case 'r': rate_per_module = std::stoul(optarg); break;
+            case 'x':
+            {
+                const std::vector<std::string> parts = split_string_by_delimeter(optarg, ':');
+                for (int kind=0; kind<LOADGEN_KINDS; ++kind)
+                {
+                    weights[kind] = (kind < (int) parts.size()) ? std::stoul(parts[kind]) : 0;
+                }
+            }
+            break;
+            case 'l': payload_length = std::stoul(optarg); break;
+            case 'b': first_module_port = std::stoul(optarg); break;
+            case 'P': comm_pid = std::stoi(optarg); break;
+            default:
+                std::cout << "usage: " << argv[0] << " [-H comm host] [-p comm port] [-n modules] [-d seconds] [-r msgs/sec per module (0 max)]" << std::endl
+                          << "       [-x text:binary:img weights] [-l payload length] [-b first module port] [-P de_comm pid]" << std::endl;
+                return 0;
+        }
+    }
+
+    if (modules_count == 0) return 0;
+
+    std::cout << "modules:" << modules_count << " duration(s):" << duration_sec << " rate/module:" << rate_per_module
+              << " mix text:binary:img " << weights[LOADGEN_TEXT] << ":" << weights[LOADGEN_BINARY] << ":" << weights[LOADGEN_IMG]
+              << " payload:" << payload_length << std::endl;
+
+    std::vector<LOADGEN_MODULE> modules(modules_count);
+    std::vector<int> fds;
+    const struct sockaddr_in comm_address = make_address(comm_host, comm_port);
+    for (unsigned int i=0; i<modules_count; ++i)
+    {
+        LOADGEN_MODULE& module = modules[i];
+        for (int kind=0; kind<LOADGEN_KINDS; ++kind) module.sent[kind] = 0;
+        module.sent_bytes = 0;
+        module.send_errors = 0;
+        module.received = 0;
+        module.received_bytes = 0;
+        module.foreign = 0;
+        module.registered = false;
+
+        const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        const int buffer_size = 8 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+        struct timeval timeout = {0, LOADGEN_RECEIVE_TIMEOUT_USEC};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        const struct sockaddr_in address = make_address("127.0.0.1", first_module_port + i);
+        if (bind(fd, (const struct sockaddr *) &address, sizeof(address)) != 0)
+        {
+            std::cout << "cannot bind module port " << first_module_port + i << std::endl;
+            return 1;
+        }
+        fds.push_back(fd);
+    }
+
+    std::vector<std::thread> receivers;
+    for (unsigned int i=0; i<modules_count; ++i)
+    {
+        receivers.push_back(std::thread([&fds, &modules, i](){ receiver_entry(fds[i], modules[i]); }));
+
+        const std::string registration = registration_message(i);
+        sendto(fds[i], registration.c_str(), registration.length(), 0, (const struct sockaddr *) &comm_address, sizeof(comm_address));
+    }
+
+    const uint64_t register_start = get_time_usec();
+    unsigned int registered = 0;
+    while (get_time_usec() - register_start < LOADGEN_REGISTER_USEC)
+    {
+        registered = 0;
+        for (const LOADGEN_MODULE& module : modules) if (module.registered) registered++;
+        if (registered == modules_count) break;
+        usleep(10000);
+    }
+    std::cout << "registered modules:" << registered << "/" << modules_count << std::endl;
+    if (registered == 0)
+    {
+        std::cout << "communicator is not responding on " << comm_host << ":" << comm_port << std::endl;
+        receiving = false;
+        for (std::thread& thread : receivers) thread.join();
+        return 1;
+    }
+
+    const uint64_t cpu_start = cpu_time_usec();
+    const uint64_t comm_cpu_start = (comm_pid > 0) ? process_cpu_time_usec(comm_pid) : 0;
+    const uint64_t time_start = get_time_usec();
+
+    std::vector<std::thread> senders;
+    for (unsigned int i=0; i<modules_count; ++i)
+    {
+        senders.push_back(std::thread([&fds, &modules, i](){ sender_entry(fds[i], i, modules[i]); }));
+    }
+
+    sleep(duration_sec);
+    sending = false;
+    for (std::thread& thread : senders) thread.join();
+    const uint64_t elapsed_usec = get_time_usec() - time_start;
+
+    usleep(LOADGEN_DRAIN_USEC);
+    receiving = false;
+    for (std::thread& thread : receivers) thread.join();
+    for (const int fd : fds) close(fd);
+
+    // cpu is measured till forwarding of in-flight messages is over.
+    const uint64_t cpu_window_usec = get_time_usec() - time_start;
+    const uint64_t cpu_usec = cpu_time_usec() - cpu_start;
+    const uint64_t comm_cpu_usec = (comm_pid > 0) ? process_cpu_time_usec(comm_pid) - comm_cpu_start : 0;
+
+    uint64_t sent[LOADGEN_KINDS] = {0, 0, 0};
+    uint64_t sent_total = 0, sent_bytes = 0, send_errors = 0, received = 0, received_bytes = 0, foreign = 0;
+    for (const LOADGEN_MODULE& module : modules)
+    {
+        for (int kind=0; kind<LOADGEN_KINDS; ++kind)
+        {
+            sent[kind] += module.sent[kind];
+            sent_total += module.sent[kind];
+        }
+        sent_bytes      += module.sent_bytes;
+        send_errors     += module.send_errors;
+        received        += module.received;
+        received_bytes  += module.received_bytes;
+        foreign         += module.foreign;
+    }
+
+    // every text & binary message is forwarded to all other registered modules.
+    const uint64_t expected = (sent[LOADGEN_TEXT] + sent[LOADGEN_BINARY]) * (registered - 1);
+    const double seconds = elapsed_usec / 1000000.0;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "sent      msgs:" << sent_total << " (text:" << sent[LOADGEN_TEXT] << " binary:" << sent[LOADGEN_BINARY] << " img:" << sent[LOADGEN_IMG] << ")"
+              << " msgs/s:" << sent_total / seconds << " MB/s:" << sent_bytes / seconds / 1e6
+              << " send errors:" << send_errors << std::endl
+              << "delivered msgs:" << received << " of " << expected
+              << " msgs/s:" << received / seconds << " MB/s:" << received_bytes / seconds / 1e6
+              << " drops:" << ((expected > received) ? expected - received : 0)
+              << " (" << ((expected != 0) ? 100.0 * (expected - std::min(expected, received)) / expected : 0) << "%)"
+              << " not from this run:" << foreign << std::endl
+              << "cpu       loadgen:" << 100.0 * cpu_usec / cpu_window_usec << "%";
+    if (comm_pid > 0)
+    {
+        std::cout << " de_comm:" << 100.0 * comm_cpu_usec / cpu_window_usec << "%"
+                  << " de_comm cpu(us)/sent msg:" << std::setprecision(2) << ((sent_total != 0) ? (double) comm_cpu_usec / sent_total : 0);
+    }
+    std::cout << std::endl;
+
+    return 0;
+}
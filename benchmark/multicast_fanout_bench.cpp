@@ -0,0 +1,248 @@
+/**
+ * @file multicast_fanout_bench.cpp
+ * @brief Compares unicast fan-out with loopback multicast as number of subscribed modules grows.
+ * @details for each module count the same messages are sent by CUDPCommunicator:
+ *
+ * unicast:   one datagram per module using SendMsgToMany (sendmmsg batches) as module dispatcher does.
+ * multicast: one datagram to a group joined by all modules on 127.0.0.1.
+ *
+ * reports deliveries, losses, send syscalls and sender CPU per message. modules are sink threads.
+ *
+ * usage: de_fanout_bench [-n messages] [-l length] [-k max modules] [-g group address]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "../src/helpers/helpers.hpp"
+#include "../src/udpCommunicator.hpp"
+
+
+#define BENCH_COMM_PORT         60992
+#define BENCH_SINK_PORT         62100
+#define BENCH_GROUP_PORT        62099
+// sink stops when no message is received for this time.
+#define BENCH_IDLE_USEC         300000
+// messages sent between pauses so sinks can keep up.
+#define BENCH_BURST             64
+#define BENCH_BURST_PAUSE_USEC  50
+
+
+typedef struct
+{
+    uint64_t deliveries;
+    uint64_t syscalls;
+    uint64_t elapsed_usec;
+    uint64_t cpu_usec;
+} BENCH_RESULT;
+
+
+static unsigned int message_count = 20000;
+static unsigned int message_length = 200;
+static unsigned int max_modules = 32;
+static std::string group_address = "239.255.77.99";
+
+
+/**
+ * @brief cpu time of calling thread only. sinks are excluded.
+ */
+static uint64_t thread_cpu_time_usec ()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull
+            + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+
+static void onReceive (const char *, int, const SOCKET_ADDRESS *, const uint64_t)
+{
+}
+
+
+static SOCKET_ADDRESS make_address (const char * host, const int port)
+{
+    SOCKET_ADDRESS socket_address;
+    memset(&socket_address, 0, sizeof(SOCKET_ADDRESS));
+
+    struct sockaddr_in * address = (struct sockaddr_in *) &socket_address.address;
+    address->sin_family = AF_INET;
+    address->sin_port = htons(port);
+    address->sin_addr.s_addr = inet_addr(host);
+    socket_address.length = sizeof(struct sockaddr_in);
+
+    return socket_address;
+}
+
+
+/**
+ * @brief socket of a fake module.
+ *
+ * @param multicast bind to group port and join group instead of own unicast port.
+ * @param index
+ */
+static int create_sink (const bool multicast, const unsigned int index)
+{
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    const int buffer_size = 8 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    struct timeval timeout = {0, BENCH_IDLE_USEC};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    SOCKET_ADDRESS address;
+    if (multicast)
+    {
+        const int enable = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        address = make_address(group_address.c_str(), BENCH_GROUP_PORT);
+    }
+    else
+    {
+        address = make_address("127.0.0.1", BENCH_SINK_PORT + index);
+    }
+
+    if (bind(fd, (const struct sockaddr *) &address.address, address.length) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    if (multicast)
+    {
+        struct ip_mreq membership;
+        membership.imr_multiaddr.s_addr = inet_addr(group_address.c_str());
+        membership.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+
+static bool run (const bool multicast, const unsigned int modules, BENCH_RESULT& result)
+{
+    uavos::comm::CUDPCommunicator& communicator = uavos::comm::CUDPCommunicator::getInstance();
+
+    std::vector<int> sink_fds;
+    std::vector<SOCKET_ADDRESS> addresses;
+    for (unsigned int k=0; k<modules; ++k)
+    {
+        const int fd = create_sink(multicast, k);
+        if (fd == -1) return false;
+        sink_fds.push_back(fd);
+        addresses.push_back(make_address("127.0.0.1", BENCH_SINK_PORT + k));
+    }
+    const SOCKET_ADDRESS group = make_address(group_address.c_str(), BENCH_GROUP_PORT);
+
+    std::atomic<uint64_t> deliveries = {0};
+    std::vector<std::thread> threads;
+    for (const int fd : sink_fds)
+    {
+        threads.push_back(std::thread([fd, &deliveries]()
+        {
+            char buffer[MAXLINE];
+            while (recv(fd, buffer, sizeof(buffer), 0) > 0) deliveries++;
+        }));
+    }
+
+    const std::string message = "{\"ty\":\"uv\",\"mt\":1005,\"ms\":{\"p\":\"" + std::string(message_length, 'x') + "\"}}";
+
+    const uint64_t syscalls_start = communicator.getIOCounters().tx_syscalls;
+    const uint64_t cpu_start = thread_cpu_time_usec();
+    const uint64_t time_start = get_time_usec();
+    for (unsigned int i=0; i<message_count; ++i)
+    {
+        if (multicast)
+        {
+            communicator.SendMsg(message.c_str(), message.length(), &group);
+        }
+        else
+        {
+            communicator.SendMsgToMany(message.c_str(), message.length(), addresses);
+        }
+
+        if ((i % BENCH_BURST) == (BENCH_BURST - 1)) usleep(BENCH_BURST_PAUSE_USEC);
+    }
+    result.elapsed_usec = get_time_usec() - time_start;
+    result.cpu_usec     = thread_cpu_time_usec() - cpu_start;
+    result.syscalls     = communicator.getIOCounters().tx_syscalls - syscalls_start;
+
+    for (std::thread& thread : threads) thread.join();
+    for (const int fd : sink_fds) close(fd);
+
+    result.deliveries = deliveries;
+    return true;
+}
+
+
+static void print_result (const char * name, const unsigned int modules, const BENCH_RESULT& result)
+{
+    const uint64_t expected = (uint64_t) message_count * modules;
+    std::cout << std::left << std::setw(10) << name << " modules:" << std::setw(4) << modules
+              << " deliveries:" << std::setw(9) << result.deliveries
+              << " lost:" << std::setw(8) << ((expected > result.deliveries) ? expected - result.deliveries : 0)
+              << " syscalls/msg:" << std::setw(7) << std::setprecision(3) << (double) result.syscalls / message_count
+              << " cpu(us)/msg:" << std::setw(7) << std::setprecision(3) << (double) result.cpu_usec / message_count
+              << " send(ms):" << result.elapsed_usec / 1000
+              << std::endl;
+}
+
+
+int main (int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:l:k:g:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': message_count = std::stoul(optarg); break;
+            case 'l': message_length = std::stoul(optarg); break;
+            case 'k': max_modules = std::stoul(optarg); break;
+            case 'g': group_address = optarg; break;
+            default:
+                std::cout << "usage: " << argv[0] << " [-n messages] [-l length] [-k max modules] [-g group address]" << std::endl;
+                return 0;
+        }
+    }
+
+    std::cout << "messages:" << message_count << " length:" << message_length << " max modules:" << max_modules
+              << " group:" << group_address << std::endl;
+
+    uavos::comm::CUDPCommunicator& communicator = uavos::comm::CUDPCommunicator::getInstance();
+    communicator.enableLoopbackMulticast();
+    communicator.init("127.0.0.1", BENCH_COMM_PORT);
+    communicator.SetMessageOnReceive(&onReceive);
+    communicator.start();
+
+    for (unsigned int modules=1; modules<=max_modules; modules*=2)
+    {
+        BENCH_RESULT unicast, multicast;
+        if (!run(false, modules, unicast) || !run(true, modules, multicast))
+        {
+            std::cout << "cannot create module sockets. is multicast available on loopback?" << std::endl;
+            break;
+        }
+
+        print_result("unicast", modules, unicast);
+        print_result("multicast", modules, multicast);
+    }
+
+    communicator.stop();
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file snapshot_stress.cpp
+ * @brief Stress test of CSnapshotHandoff used for module registry & camera list. built with ThreadSanitizer.
+ * @details one writer publishes snapshots as fast as possible while reader threads acquire them as receiver threads do,
+ * including nested acquires of a message handled within another one.
+ * every entry of a snapshot holds its version so a torn or freed snapshot is detected.
+ * a reader must never see versions going back. all snapshots must be freed when threads exit.
+ *
+ * exits with 1 on any error. ThreadSanitizer reports data races on its own.
+ *
+ * usage: de_snapshot_stress [-r readers] [-d seconds] [-e entries per snapshot] [-p publish interval usec]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "../src/helpers/helpers.hpp"
+#include "../src/uavos/uavos_snapshot_handoff.hpp"
+
+
+static std::atomic<int64_t> live_snapshots = {0};
+
+
+class CStressSnapshot
+{
+    public:
+
+        CStressSnapshot ()
+        {
+            live_snapshots++;
+        }
+
+        CStressSnapshot (const uint64_t snapshot_version, const std::size_t entry_count)
+            : version(snapshot_version)
+            , entries(entry_count, snapshot_version)
+        {
+            live_snapshots++;
+        }
+
+        ~CStressSnapshot ()
+        {
+            live_snapshots--;
+        }
+
+    public:
+
+        uint64_t version = 0;
+        std::vector<uint64_t> entries;
+};
+
+
+static unsigned int reader_count = 4;
+static unsigned int duration_sec = 5;
+static unsigned int entry_count = 64;
+static unsigned int publish_interval_usec = 100;
+
+static std::atomic<bool> exit_flag = {false};
+static std::atomic<uint64_t> errors = {0};
+
+
+static bool is_consistent (const CStressSnapshot& snapshot)
+{
+    for (const uint64_t entry : snapshot.entries)
+    {
+        if (entry != snapshot.version) return false;
+    }
+    return true;
+}
+
+
+static void reader_entry (const uavos::CSnapshotHandoff<CStressSnapshot>& handoff, uint64_t& acquires)
+{
+    uint64_t last_version = 0;
+    while (!exit_flag.load(std::memory_order_relaxed))
+    {
+        const std::shared_ptr<const CStressSnapshot> snapshot = handoff.acquire();
+        acquires++;
+
+        if ((snapshot->version < last_version) || (!is_consistent(*snapshot))) errors++;
+        last_version = snapshot->version;
+
+        // message handled within another one acquires again while outer snapshot is in use.
+        if ((acquires % 16) == 0)
+        {
+            const std::shared_ptr<const CStressSnapshot> nested = handoff.acquire();
+            acquires++;
+            if ((nested->version < snapshot->version) || (!is_consistent(*nested))) errors++;
+            if (!is_consistent(*snapshot)) errors++;
+        }
+    }
+}
+
+
+int main (int argc, char *argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "r:d:e:p:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r': reader_count = std::stoul(optarg); break;
+            case 'd': duration_sec = std::stoul(optarg); break;
+            case 'e': entry_count = std::stoul(optarg); break;
+            case 'p': publish_interval_usec = std::stoul(optarg); break;
+            default:
+                std::cout << "usage: " << argv[0] << " [-r readers] [-d seconds] [-e entries per snapshot] [-p publish interval usec]" << std::endl;
+                return 0;
+        }
+    }
+
+    std::cout << "readers:" << reader_count << " seconds:" << duration_sec << " entries:" << entry_count
+              << " publish interval:" << publish_interval_usec << " us" << std::endl;
+
+    uint64_t publishes = 0;
+    std::vector<uint64_t> acquires(reader_count, 0);
+    uint64_t elapsed_usec = 0;
+    {
+        uavos::CSnapshotHandoff<CStressSnapshot> handoff;
+
+        std::vector<std::thread> readers;
+        for (unsigned int i=0; i<reader_count; ++i)
+        {
+            readers.push_back(std::thread(reader_entry, std::cref(handoff), std::ref(acquires[i])));
+        }
+
+        const uint64_t time_start = get_time_usec();
+        const uint64_t time_end = time_start + (uint64_t) duration_sec * 1000000;
+        while (get_time_usec() < time_end)
+        {
+            publishes++;
+            handoff.publish(std::make_shared<const CStressSnapshot>(publishes, entry_count));
+            if (publish_interval_usec != 0) usleep(publish_interval_usec);
+        }
+
+        exit_flag = true;
+        for (std::thread& reader : readers) reader.join();
+        elapsed_usec = get_time_usec() - time_start;
+
+        if (handoff.getVersion() != publishes) errors++;
+    }
+
+    uint64_t total_acquires = 0;
+    for (const uint64_t reader_acquires : acquires) total_acquires += reader_acquires;
+
+    std::cout << "publishes:" << publishes << " acquires:" << total_acquires
+              << " acquires/sec:" << std::fixed << std::setprecision(0) << ((elapsed_usec != 0) ? total_acquires * 1000000.0 / elapsed_usec : 0)
+              << " leaked snapshots:" << live_snapshots.load() << " errors:" << errors.load() << std::endl;
+
+    const bool failed = (errors.load() != 0) || (live_snapshots.load() != 0);
+    std::cout << (failed ? "FAILED" : "PASSED") << std::endl;
+
+    return failed ? 1 : 0;
+}
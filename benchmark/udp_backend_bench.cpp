@@ -0,0 +1,328 @@
+/**
+ * @file udp_backend_bench.cpp
+ * @brief Compares intermodule I/O backends (epoll vs io_uring) and recvmmsg/sendmmsg batching on loopback.
+ * @details each run is in its own process as CUDPCommunicator is a singleton.
+ * epoll runs twice: with batch size 1 (one syscall per datagram) and with -B batch size.
+ *
+ * RX: sender threads flood communicator port. reports messages/sec, drops and CPU of communicator process.
+ * TX: communicator sends to sink sockets using TrySendMany. reports messages/sec and CPU of communicator process.
+ *
+ * usage: de_udp_bench [-b epoll|io_uring|both] [-n messages per sender] [-s senders] [-l length] [-k sinks] [-t receiver threads] [-B batch size]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "../src/helpers/helpers.hpp"
+#include "../src/udpCommunicator.hpp"
+
+
+#define BENCH_RX_PORT   60990
+#define BENCH_TX_PORT   60991
+#define BENCH_SINK_PORT 61990
+// test ends when no message is received for this time.
+#define BENCH_IDLE_USEC 500000
+
+
+typedef struct
+{
+    uint64_t messages;
+    uint64_t syscalls;
+    uint64_t elapsed_usec;
+    uint64_t cpu_usec;
+} BENCH_RESULT;
+
+
+static unsigned int messages_per_sender = 200000;
+static unsigned int senders = 2;
+static unsigned int message_length = 200;
+static unsigned int sinks = 4;
+static unsigned int receiver_threads = 1;
+static unsigned int batch_size = 16;
+
+static std::atomic<uint64_t> received_count = {0};
+static std::atomic<uint64_t> last_receive_time = {0};
+static std::atomic<uint64_t> first_receive_time = {0};
+
+
+static uint64_t cpu_time_usec ()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull
+            + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+
+static void onReceive (const char *, int, const SOCKET_ADDRESS *, const uint64_t)
+{
+    const uint64_t now = get_time_usec();
+    if (received_count++ == 0) first_receive_time = now;
+    last_receive_time = now;
+}
+
+
+static struct sockaddr_in local_address (const int port)
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+    return address;
+}
+
+
+/**
+ * @brief communicator side of RX test. runs in child process.
+ */
+static void rx_child (const uavos::comm::ENUM_IO_BACKEND backend, const unsigned int batch, const int result_fd, const int ready_fd)
+{
+    uavos::comm::CUDPCommunicator& communicator = uavos::comm::CUDPCommunicator::getInstance();
+    communicator.setIOBackend(backend);
+    communicator.setBatchSize(batch);
+    communicator.setReceiverThreads(receiver_threads);
+    communicator.init("127.0.0.1", BENCH_RX_PORT);
+    communicator.SetMessageOnReceive(&onReceive);
+    communicator.start();
+
+    const uint64_t cpu_start = cpu_time_usec();
+    const char ready = communicator.getIOBackend();
+    if (write(ready_fd, &ready, 1) != 1) _exit(1);
+
+    // wait for first message then until traffic stops.
+    while ((received_count == 0) || (get_time_usec() - last_receive_time < BENCH_IDLE_USEC))
+    {
+        usleep(10000);
+    }
+
+    BENCH_RESULT result;
+    result.messages     = received_count;
+    result.syscalls     = communicator.getIOCounters().rx_syscalls;
+    result.elapsed_usec = last_receive_time - first_receive_time;
+    // exclude idle wait which costs almost no cpu.
+    result.cpu_usec     = cpu_time_usec() - cpu_start;
+    if (write(result_fd, &result, sizeof(result)) != sizeof(result)) _exit(1);
+
+    communicator.stop();
+    _exit(0);
+}
+
+
+/**
+ * @brief communicator side of TX test. runs in child process.
+ */
+static void tx_child (const uavos::comm::ENUM_IO_BACKEND backend, const unsigned int batch, const int result_fd, const uint64_t total_messages)
+{
+    uavos::comm::CUDPCommunicator& communicator = uavos::comm::CUDPCommunicator::getInstance();
+    communicator.setIOBackend(backend);
+    communicator.setBatchSize(batch);
+    communicator.init("127.0.0.1", BENCH_TX_PORT);
+    communicator.start();
+
+    std::vector<SOCKET_ADDRESS> addresses(sinks);
+    for (unsigned int k=0; k<sinks; ++k)
+    {
+        const struct sockaddr_in address = local_address(BENCH_SINK_PORT + k);
+        memset(&addresses[k], 0, sizeof(SOCKET_ADDRESS));
+        memcpy(&addresses[k].address, &address, sizeof(address));
+        addresses[k].length = sizeof(address);
+    }
+
+    const std::string message(message_length, 'x');
+    // like module dispatcher: a burst of 8 messages per module per round.
+    const unsigned int burst = 8;
+    std::vector<uavos::comm::OUTBOUND_DATAGRAM> datagrams;
+
+    const uint64_t cpu_start = cpu_time_usec();
+    const uint64_t time_start = get_time_usec();
+    uint64_t sent = 0;
+    while (sent < total_messages)
+    {
+        datagrams.clear();
+        for (unsigned int k=0; k<sinks; ++k)
+        {
+            for (unsigned int b=0; b<burst; ++b)
+            {
+                datagrams.push_back({message.c_str(), message.length(), &addresses[k], 0});
+            }
+        }
+
+        communicator.TrySendMany(datagrams);
+        for (const uavos::comm::OUTBOUND_DATAGRAM& datagram : datagrams)
+        {
+            if (datagram.result == 1) sent++;
+        }
+    }
+
+    BENCH_RESULT result;
+    result.messages     = sent;
+    result.syscalls     = communicator.getIOCounters().tx_syscalls;
+    result.elapsed_usec = get_time_usec() - time_start;
+    result.cpu_usec     = cpu_time_usec() - cpu_start;
+    if (write(result_fd, &result, sizeof(result)) != sizeof(result)) _exit(1);
+
+    communicator.stop();
+    _exit(0);
+}
+
+
+static void print_result (const char * name, const char * backend, const unsigned int batch, const BENCH_RESULT& result, const uint64_t expected)
+{
+    const double seconds = result.elapsed_usec / 1000000.0;
+    std::cout << std::left << std::setw(4) << name << std::setw(10) << backend
+              << " batch:" << std::setw(4) << batch
+              << " msgs:" << std::setw(9) << result.messages
+              << " lost:" << std::setw(8) << ((expected > result.messages) ? expected - result.messages : 0)
+              << " msgs/s:" << std::setw(10) << (uint64_t) ((seconds > 0) ? result.messages / seconds : 0)
+              << " msgs/syscall:" << std::setw(7) << std::setprecision(3) << ((result.syscalls != 0) ? (double) result.messages / result.syscalls : 0)
+              << " cpu(ms):" << result.cpu_usec / 1000
+              << " cpu(us)/msg:" << std::setprecision(3) << ((result.messages != 0) ? (double) result.cpu_usec / result.messages : 0)
+              << std::endl;
+}
+
+
+static bool run_rx (const uavos::comm::ENUM_IO_BACKEND backend, const char * name, const unsigned int batch)
+{
+    int result_pipe[2], ready_pipe[2];
+    if ((pipe(result_pipe) != 0) || (pipe(ready_pipe) != 0)) return false;
+
+    const pid_t pid = fork();
+    if (pid == 0) rx_child(backend, batch, result_pipe[1], ready_pipe[1]);
+
+    char actual_backend;
+    if (read(ready_pipe[0], &actual_backend, 1) != 1) return false;
+    if (actual_backend != backend) std::cout << name << " is not available. fallback to epoll." << std::endl;
+
+    std::vector<std::thread> threads;
+    for (unsigned int s=0; s<senders; ++s)
+    {
+        threads.push_back(std::thread([]()
+        {
+            const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+            const struct sockaddr_in address = local_address(BENCH_RX_PORT);
+            const std::string message = "{\"ty\":\"uv\",\"mt\":1005,\"ms\":{\"p\":\"" + std::string(message_length, 'x') + "\"}}";
+            for (unsigned int i=0; i<messages_per_sender; ++i)
+            {
+                sendto(fd, message.c_str(), message.length(), 0, (const struct sockaddr *) &address, sizeof(address));
+            }
+            close(fd);
+        }));
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    BENCH_RESULT result;
+    const bool ok = (read(result_pipe[0], &result, sizeof(result)) == sizeof(result));
+    waitpid(pid, NULL, 0);
+    close(result_pipe[0]); close(result_pipe[1]); close(ready_pipe[0]); close(ready_pipe[1]);
+
+    if (ok) print_result("RX", name, batch, result, (uint64_t) messages_per_sender * senders);
+    return ok;
+}
+
+
+static bool run_tx (const uavos::comm::ENUM_IO_BACKEND backend, const char * name, const unsigned int batch)
+{
+    const uint64_t total_messages = (uint64_t) messages_per_sender * senders;
+
+    // sinks play the role of modules.
+    std::vector<int> sink_fds;
+    for (unsigned int k=0; k<sinks; ++k)
+    {
+        const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        const int buffer_size = 8 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+        const struct sockaddr_in address = local_address(BENCH_SINK_PORT + k);
+        if (bind(fd, (const struct sockaddr *) &address, sizeof(address)) != 0) return false;
+        struct timeval timeout = {0, BENCH_IDLE_USEC};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        sink_fds.push_back(fd);
+    }
+
+    std::atomic<uint64_t> sink_count = {0};
+    std::vector<std::thread> threads;
+    for (const int fd : sink_fds)
+    {
+        threads.push_back(std::thread([fd, &sink_count]()
+        {
+            char buffer[MAXLINE];
+            while (recv(fd, buffer, sizeof(buffer), 0) > 0) sink_count++;
+        }));
+    }
+
+    int result_pipe[2];
+    if (pipe(result_pipe) != 0) return false;
+
+    const pid_t pid = fork();
+    if (pid == 0) tx_child(backend, batch, result_pipe[1], total_messages);
+
+    BENCH_RESULT result;
+    const bool ok = (read(result_pipe[0], &result, sizeof(result)) == sizeof(result));
+    waitpid(pid, NULL, 0);
+    for (std::thread& thread : threads) thread.join();
+    for (const int fd : sink_fds) close(fd);
+    close(result_pipe[0]); close(result_pipe[1]);
+
+    if (ok)
+    {
+        // messages accepted by kernel but not read by sinks count as lost.
+        result.messages = std::min<uint64_t>(result.messages, sink_count);
+        print_result("TX", name, batch, result, total_messages);
+    }
+    return ok;
+}
+
+
+int main (int argc, char *argv[])
+{
+    std::string backend = "both";
+    int opt;
+    while ((opt = getopt(argc, argv, "b:n:s:l:k:t:B:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': backend = optarg; break;
+            case 'n': messages_per_sender = std::stoul(optarg); break;
+            case 's': senders = std::stoul(optarg); break;
+            case 'l': message_length = std::stoul(optarg); break;
+            case 'k': sinks = std::stoul(optarg); break;
+            case 't': receiver_threads = std::stoul(optarg); break;
+            case 'B': batch_size = std::stoul(optarg); break;
+            default:
+                std::cout << "usage: " << argv[0] << " [-b epoll|io_uring|both] [-n messages per sender] [-s senders] [-l length] [-k sinks] [-t receiver threads] [-B batch size]" << std::endl;
+                return 0;
+        }
+    }
+
+    std::cout << "senders:" << senders << " messages/sender:" << messages_per_sender
+              << " length:" << message_length << " sinks:" << sinks << " receiver threads:" << receiver_threads << " batch size:" << batch_size << std::endl;
+
+    if ((backend == "epoll") || (backend == "both"))
+    {
+        // one syscall per datagram as before recvmmsg/sendmmsg batching.
+        run_rx(uavos::comm::IO_BACKEND_EPOLL, "epoll", 1);
+        run_tx(uavos::comm::IO_BACKEND_EPOLL, "epoll", 1);
+        run_rx(uavos::comm::IO_BACKEND_EPOLL, "epoll", batch_size);
+        run_tx(uavos::comm::IO_BACKEND_EPOLL, "epoll", batch_size);
+    }
+
+    if ((backend == "io_uring") || (backend == "both"))
+    {
+        run_rx(uavos::comm::IO_BACKEND_IO_URING, "io_uring", batch_size);
+        run_tx(uavos::comm::IO_BACKEND_IO_URING, "io_uring", batch_size);
+    }
+
+    return 0;
+}
@@ -95,6 +95,7 @@ bool uavos::andruav_servers::CAndruavAuthenticator::doAuthentication()
  */
 bool uavos::andruav_servers::CAndruavAuthenticator::doValidateHardware(const std::string hardware_id, const int hardware_type)
 {
+    m_hardware_reply_received = false;
 
     if (hardware_id == std::string("")) return false;
 
@@ -376,6 +377,7 @@ bool uavos::andruav_servers::CAndruavAuthenticator::translateResponse_doValidate
 
      // Error Should be read before any other validation as if error some fields are not sent.
     m_auth_error = json_response[AUTH_REPLY_ERROR].get<int>();
+    m_hardware_reply_received = true;
     
     if (validateField (json_response, AUTH_REPLY_ERROR_MSG, Json::value_t::string))
     {
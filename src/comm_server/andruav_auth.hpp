@@ -85,6 +85,10 @@ class CAndruavAuthenticator
         bool isAuthenticationOK() { return m_is_authentication_ok;}
         bool doAuthentication();
         bool doValidateHardware(const std::string hardware_id, const int hardware_type);
+        /**
+         * @brief true if last @link doValidateHardware @endlink result is a reply of auth server not a connection failure.
+         */
+        bool isHardwareReplyReceived() { return m_hardware_reply_received;}
 
         void uninit();
     
@@ -131,6 +135,7 @@ class CAndruavAuthenticator
         std::string m_hardware_error_string;
         
         bool m_is_authentication_ok = false;
+        bool m_hardware_reply_received = false;
         
 };
 }
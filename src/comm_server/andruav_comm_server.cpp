@@ -352,7 +352,11 @@ void uavos::andruav_servers::CAndruavCommServer::onBinaryMessageRecieved (const
             break;
         }
 
-        uavos::CUavosModulesManager::getInstance().processIncommingServerMessage(sender, command_type,  message, datalength, std::string());
+        // modules waiting for this message as a reply receive it with their correlation id instead of the subscribers copy.
+        std::set<std::string> replied_modules;
+        uavos::CUavosModulesManager::getInstance().deliverRequestReply(command_type, message, datalength, replied_modules);
+
+        uavos::CUavosModulesManager::getInstance().processIncommingServerMessage(sender, command_type,  message, datalength, std::string(), NULL, &replied_modules);
     }
     
 }
@@ -453,7 +457,11 @@ void uavos::andruav_servers::CAndruavCommServer::onTextMessageRecieved(const std
             break;
         }
 
-        uavos::CUavosModulesManager::getInstance().processIncommingServerMessage(sender, command_type,  jsonMessage.c_str(), jsonMessage.length(), std::string());
+        // modules waiting for this message as a reply receive it with their correlation id instead of the subscribers copy.
+        std::set<std::string> replied_modules;
+        uavos::CUavosModulesManager::getInstance().deliverRequestReply(command_type, jsonMessage.c_str(), jsonMessage.length(), replied_modules);
+
+        uavos::CUavosModulesManager::getInstance().processIncommingServerMessage(sender, command_type,  jsonMessage.c_str(), jsonMessage.length(), std::string(), NULL, &replied_modules);
     }
 }
 
@@ -657,6 +665,52 @@ void uavos::andruav_servers::CAndruavCommServer::API_sendCMD (const std::string&
 
 
 
+/**
+ * @details Sends Andruav Command to Andruav Server with ms given as JSON text.
+ * message is built as text in the same field order as @link generateJSONMessage @endlink output.
+ * @param target_party_id party_id of a target or can be null or _GD_, _AGN_, _GCS_
+ * @param command_type 
+ * @param msg JSON text of ms field. NULL means null.
+ * @param msg_length 
+ */
+void uavos::andruav_servers::CAndruavCommServer::API_sendRawCMD (const std::string& target_party_id, const int command_type, const char * msg, const std::size_t msg_length)
+{
+    static std::mutex g_i_mutex; 
+
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+    
+    if (m_status != SOCKET_STATUS_REGISTERED) return ;
+
+    const std::string message_routing = (target_party_id.empty() == false) ? CMD_COMM_INDIVIDUAL : CMD_COMM_GROUP;
+
+    std::string json_msg;
+    json_msg.reserve(msg_length + m_party_id.length() + target_party_id.length() + 64);
+    json_msg += "{\"" ANDRUAV_PROTOCOL_MESSAGE_CMD "\":";
+    if (msg != NULL)
+    {
+        json_msg.append(msg, msg_length);
+    }
+    else
+    {
+        json_msg += "null";
+    }
+    json_msg += ",\"" ANDRUAV_PROTOCOL_MESSAGE_TYPE "\":";
+    json_msg += std::to_string(command_type);
+    json_msg += ",\"" ANDRUAV_PROTOCOL_SENDER "\":";
+    json_msg += Json(m_party_id).dump();
+    if (!target_party_id.empty())
+    {
+        json_msg += ",\"" ANDRUAV_PROTOCOL_TARGET_ID "\":";
+        json_msg += Json(target_party_id).dump();
+    }
+    json_msg += ",\"" INTERMODULE_ROUTING_TYPE "\":";
+    json_msg += Json(message_routing).dump();
+    json_msg += "}";
+
+    _cwssession.get()->writeText(json_msg);
+}
+
+
 /**
  * @details Sends Andruav Command to Andruav Server
  *  *_GCS_: broadcast to GCS.
@@ -692,16 +746,10 @@ void uavos::andruav_servers::CAndruavCommServer::API_sendBinaryCMD (const std::s
     {
         Json json  = this->generateJSONMessage (message_routing, m_party_id, target_party_id, command_type, message_cmd);
         std::string json_msg = json.dump();
-        char * msg_ptr = new char[json_msg.length() + 1 + bmsg_length];
-        std::unique_ptr<char []> msg = std::unique_ptr<char []> (msg_ptr);
-        strcpy(msg_ptr,json_msg.c_str());
-        msg_ptr[json_msg.length()] = 0;
-        memcpy(&msg[json_msg.length()+1], bmsg, bmsg_length);
-
-
-        _cwssession.get()->writeBinary(msg_ptr, json_msg.length() + 1 + bmsg_length);
         
-        msg.release();
+        // JSON part including its zero delimiter followed by binary part. 
+        // sent as one frame without copying bmsg.
+        _cwssession.get()->writeBinary(json_msg.c_str(), json_msg.length() + 1, bmsg, bmsg_length);
         // #ifdef DEBUG
         // std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "API_sendCMD " << jmsg.dump() << _NORMAL_CONSOLE_TEXT_ << std::endl;
         // #endif
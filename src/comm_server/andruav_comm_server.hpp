@@ -84,6 +84,17 @@ namespace andruav_servers
             void API_pingServer();
             void API_sendSystemMessage(const int command_type, const Json& msg) const;
             void API_sendCMD (const std::string& target_party_id, const int command_type, const Json& msg);
+            
+            /**
+             * @brief same as @link API_sendCMD @endlink but msg is JSON text that is copied as it is.
+             * @details used to forward module messages without parsing them.
+             * 
+             * @param target_party_id 
+             * @param command_type 
+             * @param msg JSON text of ms field. NULL means null.
+             * @param msg_length 
+             */
+            void API_sendRawCMD (const std::string& target_party_id, const int command_type, const char * msg, const std::size_t msg_length);
             void API_sendBinaryCMD (const std::string& target_party_id, const int command_type, const char * bmsg, const int bmsg_length, const Json& message_cmd);
 
             int getStatus ()
@@ -16,7 +16,10 @@
 
 #include "../helpers/colors.hpp"
 #include <boost/asio.hpp>
+#include <array>
 #include "andruav_comm_session.hpp"
+#include "../messageLatency.hpp"
+#include "../messageStatistics.hpp"
 
 #include <plog/Log.h> 
 #include "plog/Initializers/RollingFileInitializer.h"
@@ -243,11 +246,19 @@ void uavos::andruav_servers::CWSSession::writeText (const std::string message)
         if (bytes<=0)
         {
             PLOG(plog::error) << "WebSocket ws_.write error:" << bytes;
+            uavos::comm::CMessageStatistics::getInstance().countUplinkError();
         }
-            
+        else
+        {
+            uavos::comm::CMessageStatistics::getInstance().countUplink(bytes);
+        }
+        
+        uavos::comm::CMessageLatency::getInstance().recordEgress();
+
     }
     catch (const std::exception& ex)
     {
+        uavos::comm::CMessageStatistics::getInstance().countUplinkError();
         std::cout << "WebSocket Disconnected with Andruav Server on writeText" <<   std::endl;
         PLOG(plog::error) << "WebSocket Disconnected with Andruav Server on writeText."; 
         m_callback.onSocketError();
@@ -258,6 +269,39 @@ void uavos::andruav_servers::CWSSession::writeText (const std::string message)
 }
 
 
+void uavos::andruav_servers::CWSSession::writeBinary (const char * header, const std::size_t header_length, const char * payload, const std::size_t payload_length)
+{
+
+    #ifdef DEBUG_2
+         std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "write Binary" << std::endl;
+    #endif
+    try
+    {
+        const std::array<net::const_buffer, 2> buffers = 
+        {
+            net::buffer(header, header_length),
+            net::buffer(payload, payload_length)
+        };
+
+        const std::lock_guard<std::mutex> lock(g_i_mutex_writeText);
+        ws_.binary(true);
+        const std::size_t bytes = ws_.write(buffers);
+        uavos::comm::CMessageStatistics::getInstance().countUplink(bytes);
+        uavos::comm::CMessageLatency::getInstance().recordEgress();
+    }
+    catch (const std::exception& ex)
+    {
+        uavos::comm::CMessageStatistics::getInstance().countUplinkError();
+        std::cout << "WebSocket Disconnected with Andruav Server on writeBinary" <<   std::endl;
+        PLOG(plog::error) << "WebSocket Disconnected with Andruav Server on writeBinary."; 
+        m_callback.onSocketError();
+        return ;
+    }
+
+    return ;
+}
+
+
 void uavos::andruav_servers::CWSSession::writeBinary (const char * bmsg, const int& length)
 {
 
@@ -268,10 +312,13 @@ void uavos::andruav_servers::CWSSession::writeBinary (const char * bmsg, const i
     {
         const std::lock_guard<std::mutex> lock(g_i_mutex_writeText);
         ws_.binary(true);
-        ws_.write(net::buffer(bmsg, length));
+        const std::size_t bytes = ws_.write(net::buffer(bmsg, length));
+        uavos::comm::CMessageStatistics::getInstance().countUplink(bytes);
+        uavos::comm::CMessageLatency::getInstance().recordEgress();
     }
     catch (const std::exception& ex)
     {
+        uavos::comm::CMessageStatistics::getInstance().countUplinkError();
         std::cout << "WebSocket Disconnected with Andruav Server on writeBinary" <<   std::endl;
         PLOG(plog::error) << "WebSocket Disconnected with Andruav Server on writeBinary."; 
         m_callback.onSocketError();
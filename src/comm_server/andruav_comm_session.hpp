@@ -78,6 +78,17 @@ class CWSSession : public std::enable_shared_from_this<CWSSession>
         void writeText (const std::string message);
         void writeBinary (const char * bmsg, const int& length);
         
+        /**
+         * @brief write one binary frame made of two parts without joining them first.
+         * @details used to send JSON header and a payload that lives elsewhere (e.g. shared memory).
+         * 
+         * @param header 
+         * @param header_length 
+         * @param payload 
+         * @param payload_length 
+         */
+        void writeBinary (const char * header, const std::size_t header_length, const char * payload, const std::size_t payload_length);
+        
         /**
          * @brief Close socket normally.
          * 
@@ -46,8 +46,26 @@ void uavos::andruav_servers::CAndruavFacade::API_sendID (const std::string& targ
 
 
     uavos::CAndruavUnitMe& m_andruavMe = uavos::CAndruavUnitMe::getInstance();
-    uavos::ANDRUAV_UNIT_INFO&  unit_info = m_andruavMe.getUnitInfo();
+    uavos::CUavosModulesManager& module_manager = uavos::CUavosModulesManager::getInstance();
    
+    const std::lock_guard<std::mutex> lock(m_id_lock);
+
+    // read before building so changes made meanwhile cause a rebuild next time.
+    const uint64_t unit_generation = m_andruavMe.getUnitInfoGeneration();
+    const uint64_t registry_version = module_manager.getRegistryVersion();
+    
+    if ((m_id_valid) && (m_id_unit_generation == unit_generation) && (m_id_registry_version == registry_version))
+    {
+        uavos::andruav_servers::CAndruavCommServer::getInstance().API_sendRawCMD (target_party_id, TYPE_AndruavMessage_ID, m_id_text.c_str(), m_id_text.length());
+        return ;
+    }
+
+    // copied as unit info is updated by module receiver threads.
+    uavos::ANDRUAV_UNIT_INFO unit_info;
+    {
+        const std::lock_guard<std::mutex> unit_lock(m_andruavMe.getLock());
+        unit_info = m_andruavMe.getUnitInfo();
+    }
 
     Json jMsg = 
     {   
@@ -63,7 +81,7 @@ void uavos::andruav_servers::CAndruavFacade::API_sendID (const std::string& targ
         {"DS", jsonConfig["unitDescription"]},              // unit Description
         {"p",  unit_info.permission},                       // permissions
         {"dv", version_string},                             // de version
-        {"m1", uavos::CUavosModulesManager::getInstance().getModuleListAsJSON()}
+        {"m1", module_manager.getModuleListAsJSON()}
     };
  
     if (unit_info.is_tracking_mode)
@@ -113,7 +131,13 @@ void uavos::andruav_servers::CAndruavFacade::API_sendID (const std::string& targ
     {
         jMsg["a"] = unit_info.flying_total_duration;    // is whisling
     }
-    uavos::andruav_servers::CAndruavCommServer::getInstance().API_sendCMD (target_party_id, TYPE_AndruavMessage_ID, jMsg);
+
+    m_id_text = jMsg.dump();
+    m_id_unit_generation = unit_generation;
+    m_id_registry_version = registry_version;
+    m_id_valid = true;
+
+    uavos::andruav_servers::CAndruavCommServer::getInstance().API_sendRawCMD (target_party_id, TYPE_AndruavMessage_ID, m_id_text.c_str(), m_id_text.length());
 }
 
 void uavos::andruav_servers::CAndruavFacade::API_sendCameraList(const bool reply, const std::string& target_party_id) const 
@@ -124,15 +148,16 @@ void uavos::andruav_servers::CAndruavFacade::API_sendCameraList(const bool reply
     
     uavos::CUavosModulesManager& module_manager = uavos::CUavosModulesManager::getInstance();
     
-    Json camera_list = module_manager.getCameraList();
-
-    const Json jMsg = 
-    {
-        {"R", reply},
-        {"T", camera_list}
-    };
+    // camera list is already serialized. only reply flag is added.
+    const std::shared_ptr<const CAMERA_LIST_SNAPSHOT> camera_list = module_manager.getCameraList();
+
+    std::string msg;
+    msg.reserve(camera_list->camera_list_text.length() + 20);
+    msg.append(reply ? "{\"R\":true,\"T\":" : "{\"R\":false,\"T\":");
+    msg.append(camera_list->camera_list_text);
+    msg.push_back('}');
         
-    uavos::andruav_servers::CAndruavCommServer::getInstance().API_sendCMD (target_party_id, TYPE_AndruavMessage_CameraList, jMsg);
+    uavos::andruav_servers::CAndruavCommServer::getInstance().API_sendRawCMD (target_party_id, TYPE_AndruavMessage_CameraList, msg.c_str(), msg.length());
 }
 
 
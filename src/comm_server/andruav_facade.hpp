@@ -1,6 +1,10 @@
 #ifndef ANDRUAV_FACADE_H_
 #define ANDRUAV_FACADE_H_
 
+#include <cstdint>
+#include <mutex>
+#include <string>
+
 namespace uavos
 {
 
@@ -60,6 +64,19 @@ namespace andruav_servers
             void API_loadTask (const int larger_than_SID, const std::string& account_id, const std::string& party_sid, const std::string& group_name, const std::string& sender, const std::string& receiver, const int msg_type, bool is_permanent ) const;
 
             void API_sendPrepherals (const std::string& target_party_id) const ;
+
+        private:
+
+            /**
+             * @brief serialized ms of TYPE_AndruavMessage_ID.
+             * @details rebuilt only when unit info or module registry has changed.
+             * 
+             */
+            mutable std::mutex m_id_lock;
+            mutable std::string m_id_text;
+            mutable uint64_t m_id_unit_generation = 0;
+            mutable uint64_t m_id_registry_version = 0;
+            mutable bool m_id_valid = false;
     };
 
 }
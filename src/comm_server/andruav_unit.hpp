@@ -4,6 +4,8 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <atomic>
+#include <mutex>
 
 
 #include <plog/Log.h> 
@@ -162,8 +164,35 @@ class CAndruavUnit
             return m_unit_location_info;
         }
 
+        /**
+         * @brief should be called after fields of @link getUnitInfo @endlink are changed.
+         * @details messages built from unit info are cached till generation changes.
+         * 
+         */
+        void touchUnitInfo ()
+        {
+            m_unit_info_generation++;
+        }
+
+        uint64_t getUnitInfoGeneration () const
+        {
+            return m_unit_info_generation;
+        }
+
+        /**
+         * @brief should be held while accessing @link getUnitInfo @endlink or @link getUnitLocationInfo @endlink
+         * @details they are written by module receiver threads and read by server threads.
+         * 
+         */
+        std::mutex& getLock ()
+        {
+            return m_lock;
+        }
+
     protected:
+        std::mutex m_lock;
         ANDRUAV_UNIT_INFO m_unit_info;
+        std::atomic<uint64_t> m_unit_info_generation = {0};
         ANDRUAV_UNIT_LOCATION m_unit_location_info;
 };
 
@@ -0,0 +1,189 @@
+#include <iostream>
+#include <chrono>
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+#include "../helpers/colors.hpp"
+#include "../messageStatistics.hpp"
+#include "../messageLatency.hpp"
+#include "andruav_comm_server.hpp"
+#include "andruav_uplink_coalescer.hpp"
+
+
+using namespace uavos::andruav_servers;
+
+
+CAndruavUplinkCoalescer::~CAndruavUplinkCoalescer ()
+{
+    if (m_stopped_called == false)
+    {
+        stop();
+    }
+}
+
+
+void CAndruavUplinkCoalescer::init (const std::set<int>& message_types, const uint64_t interval_ms)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    m_message_types = message_types;
+    m_interval_ms = (interval_ms == 0) ? 1 : interval_ms;
+}
+
+
+bool CAndruavUplinkCoalescer::offer (const std::string& target_party_id, const int message_type, const char * payload, const std::size_t payload_length, const bool is_binary, const int module_index, const uint64_t ingress_nsec)
+{
+    if (!m_enabled) return false;
+
+    // types are not changed after start.
+    if (m_message_types.find(message_type) == m_message_types.end()) return false;
+
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    m_counters.offered++;
+
+    auto entry = m_pending.emplace(std::make_pair(message_type, target_party_id), COALESCED_MESSAGE());
+    if (!entry.second)
+    {
+        // older message has not been sent yet.
+        m_counters.superseded++;
+    }
+
+    COALESCED_MESSAGE& message = entry.first->second;
+    if ((payload != NULL) && (payload_length != 0))
+    {
+        message.payload.assign(payload, payload_length);
+    }
+    else
+    {
+        // NULL ms is sent as null.
+        message.payload.assign(is_binary ? "" : "null");
+    }
+    message.is_binary = is_binary;
+    message.module_index = module_index;
+    message.ingress_nsec = ingress_nsec;
+
+    return true;
+}
+
+
+void CAndruavUplinkCoalescer::start ()
+{
+    if (m_started) return ;
+    if (m_message_types.empty()) return ;
+
+    m_started = true;
+    m_thread = std::thread {[&](){ flusherEntry(); }};
+    m_enabled = true;
+}
+
+
+void CAndruavUplinkCoalescer::stop ()
+{
+    m_enabled = false;
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        m_stopped_called = true;
+    }
+    m_wakeup.notify_one();
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+
+UPLINK_COALESCE_COUNTERS CAndruavUplinkCoalescer::getCounters ()
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    return m_counters;
+}
+
+
+void CAndruavUplinkCoalescer::logSummary (const bool only_if_changed)
+{
+    UPLINK_COALESCE_COUNTERS counters;
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        if ((only_if_changed) && (m_counters.offered == m_offered_last_log)) return ;
+        m_offered_last_log = m_counters.offered;
+        counters = m_counters;
+    }
+
+    PLOG(plog::info) << "Uplink coalescing offered:" << counters.offered << " sent:" << counters.sent
+                    << " superseded:" << counters.superseded;
+
+    #ifdef DEBUG
+        std::cout << _LOG_CONSOLE_TEXT << "Uplink coalescing offered:" << counters.offered << " sent:" << counters.sent
+                    << " superseded:" << counters.superseded << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    #endif
+}
+
+
+/**
+ * @brief flusher thread.
+ * @details pending messages are taken as a whole then written without holding the lock.
+ * next flush starts one interval after previous one started or as soon as it ends if writing took longer.
+ *
+ */
+void CAndruavUplinkCoalescer::flusherEntry ()
+{
+    #ifdef DEBUG
+        std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: flusherEntry" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    #endif
+
+    CAndruavCommServer& andruav_server = CAndruavCommServer::getInstance();
+
+    COALESCED_MESSAGE_LIST messages;
+    auto next_flush = std::chrono::steady_clock::now();
+
+    while (!m_stopped_called)
+    {
+        next_flush += std::chrono::milliseconds(m_interval_ms);
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_wakeup.wait_until(lock, next_flush, [this]{ return m_stopped_called.load(); });
+
+            if (m_stopped_called) break;
+
+            messages.swap(m_pending);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (next_flush < now) next_flush = now;
+
+        std::size_t sent = 0;
+        for (const auto& message : messages)
+        {
+            const int message_type = message.first.first;
+            const std::string& target_party_id = message.first.second;
+            const std::string& payload = message.second.payload;
+
+            // uplink is counted against sender module.
+            comm::CMessageStatistics::CScope stats_scope(message_type, message.second.module_index);
+            // latency includes time spent waiting for flush.
+            comm::CMessageLatency::CScope latency_scope(message.second.ingress_nsec);
+            latency_scope.setMessageType(message_type);
+
+            if (message.second.is_binary)
+            {
+                andruav_server.API_sendBinaryCMD(target_party_id, message_type, payload.c_str(), payload.length(), Json());
+            }
+            else
+            {
+                andruav_server.API_sendRawCMD(target_party_id, message_type, payload.c_str(), payload.length());
+            }
+            sent++;
+        }
+        messages.clear();
+
+        if (sent != 0)
+        {
+            const std::lock_guard<std::mutex> lock(m_lock);
+            m_counters.sent += sent;
+        }
+    }
+}
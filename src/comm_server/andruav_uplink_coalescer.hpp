@@ -0,0 +1,132 @@
+#ifndef ANDRUAV_UPLINK_COALESCER_H_
+#define ANDRUAV_UPLINK_COALESCER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+
+
+// default time between flushes of coalesced messages.
+#define DEFAULT_UPLINK_COALESCE_INTERVAL_MS     100
+
+
+typedef struct
+{
+    // messages given to coalescer.
+    uint64_t offered;
+    // messages written to websocket.
+    uint64_t sent;
+    // messages replaced by a newer one of the same type & target before being sent.
+    uint64_t superseded;
+} UPLINK_COALESCE_COUNTERS;
+
+
+namespace uavos
+{
+namespace andruav_servers
+{
+    /**
+     * @brief Keeps only the newest message of each (message type, target) for state-like message types
+     * e.g. TYPE_AndruavMessage_NAV_INFO and sends them to Andruav server every flush interval.
+     * @details websocket writes are blocking. when uplink is slow a flush takes longer and messages arriving
+     * meanwhile replace older ones instead of waiting behind them.
+     * disabled till message types are set.
+     *
+     */
+    class CAndruavUplinkCoalescer
+    {
+        public:
+            //https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+            static CAndruavUplinkCoalescer& getInstance()
+            {
+                static CAndruavUplinkCoalescer instance;
+
+                return instance;
+            }
+
+            CAndruavUplinkCoalescer(CAndruavUplinkCoalescer const&)     = delete;
+            void operator=(CAndruavUplinkCoalescer const&)              = delete;
+
+        private:
+
+            CAndruavUplinkCoalescer() {};
+
+        public:
+
+            ~CAndruavUplinkCoalescer ();
+
+            /**
+             * @brief should be called before @link start @endlink
+             *
+             * @param message_types
+             * @param interval_ms
+             */
+            void init (const std::set<int>& message_types, const uint64_t interval_ms);
+
+            /**
+             * @brief take message if its type is coalesced.
+             *
+             * @param target_party_id
+             * @param message_type
+             * @param payload ms JSON text or binary part when is_binary.
+             * @param payload_length
+             * @param is_binary
+             * @param module_index statistics index of sender module. @see CMessageStatistics::registerModule
+             * @param ingress_nsec kernel receive time of message. latency of sent message is measured from it.
+             * @return false if message is not coalesced and should be sent by caller.
+             */
+            bool offer (const std::string& target_party_id, const int message_type, const char * payload, const std::size_t payload_length, const bool is_binary, const int module_index = 0, const uint64_t ingress_nsec = 0);
+
+            void start ();
+            void stop ();
+
+            UPLINK_COALESCE_COUNTERS getCounters ();
+
+            /**
+             * @brief write counters to log.
+             *
+             * @param only_if_changed skip if nothing has been offered since last call.
+             */
+            void logSummary (const bool only_if_changed);
+
+        private:
+
+            typedef struct
+            {
+                std::string payload;
+                bool is_binary;
+                int module_index;
+                uint64_t ingress_nsec;
+            } COALESCED_MESSAGE;
+
+            typedef std::map<std::pair<int, std::string>, COALESCED_MESSAGE> COALESCED_MESSAGE_LIST;
+
+            void flusherEntry ();
+
+        private:
+
+            std::set<int> m_message_types;
+            uint64_t m_interval_ms = DEFAULT_UPLINK_COALESCE_INTERVAL_MS;
+            std::atomic<bool> m_enabled = {false};
+
+            // newest message of each (type, target) waiting for next flush.
+            COALESCED_MESSAGE_LIST m_pending;
+            UPLINK_COALESCE_COUNTERS m_counters = {0, 0, 0};
+            uint64_t m_offered_last_log = 0;
+            std::mutex m_lock;
+            std::condition_variable m_wakeup;
+
+            std::thread m_thread;
+            std::atomic<bool> m_started = {false};
+            std::atomic<bool> m_stopped_called = {false};
+    };
+}
+}
+
+#endif
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <cstring>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "./helpers/colors.hpp"
+#include "epollReactor.hpp"
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+#define MAX_REACTOR_EVENTS 16
+
+
+uavos::comm::CEpollReactor::CEpollReactor()
+{
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd < 0)
+    {
+        perror("epoll creation failed");
+        PLOG(plog::error) << "epoll creation failed" ;
+        exit(EXIT_FAILURE);
+    }
+
+    m_shutdown_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_shutdown_fd < 0)
+    {
+        perror("eventfd creation failed");
+        PLOG(plog::error) << "eventfd creation failed" ;
+        exit(EXIT_FAILURE);
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL; // NULL marks shutdown fd.
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_shutdown_fd, &event);
+}
+
+
+uavos::comm::CEpollReactor::~CEpollReactor()
+{
+    for (const int timer_fd : m_timer_fds)
+    {
+        close(timer_fd);
+    }
+
+    if (m_shutdown_fd != -1) close(m_shutdown_fd);
+    if (m_epoll_fd != -1) close(m_epoll_fd);
+}
+
+
+bool uavos::comm::CEpollReactor::addFD (const int fd, REACTOR_CALLBACK callback)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    REACTOR_ENTRY * entry = new REACTOR_ENTRY();
+    entry->fd = fd;
+    entry->callback = callback;
+    m_entries.push_back(std::unique_ptr<REACTOR_ENTRY>(entry));
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = entry;
+
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        PLOG(plog::error) << "CEpollReactor::addFD failed fd:" << fd << " errno:" << errno;
+        return false;
+    }
+
+    return true;
+}
+
+
+int uavos::comm::CEpollReactor::addTimer (const unsigned int interval_ms, REACTOR_CALLBACK callback)
+{
+    const int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (timer_fd < 0)
+    {
+        PLOG(plog::error) << "CEpollReactor::addTimer timerfd_create failed errno:" << errno;
+        return -1;
+    }
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec  = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (interval_ms % 1000) * 1000000l;
+    spec.it_value            = spec.it_interval;
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        m_timer_fds.push_back(timer_fd);
+    }
+
+    const bool added = addFD(timer_fd, [callback](const int fd)
+    {
+        // consume expirations so level-triggered epoll does not fire again.
+        uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+        {
+            callback(fd);
+        }
+    });
+
+    return added ? timer_fd : -1;
+}
+
+
+void uavos::comm::CEpollReactor::run ()
+{
+    while (!m_stopped)
+    {
+        if (!processEvents(-1)) break;
+    }
+}
+
+
+void uavos::comm::CEpollReactor::poll ()
+{
+    if (m_stopped) return ;
+
+    processEvents(0);
+}
+
+
+bool uavos::comm::CEpollReactor::processEvents (const int timeout_ms)
+{
+    struct epoll_event events[MAX_REACTOR_EVENTS];
+
+    const int count = epoll_wait(m_epoll_fd, events, MAX_REACTOR_EVENTS, timeout_ms);
+    if (count < 0)
+    {
+        if (errno == EINTR) return true;
+
+        PLOG(plog::error) << "CEpollReactor::run epoll_wait failed errno:" << errno;
+        return false;
+    }
+
+    for (int i=0; i<count; ++i)
+    {
+        const REACTOR_ENTRY * entry = (const REACTOR_ENTRY *) events[i].data.ptr;
+        if (entry == NULL)
+        {
+            m_stopped = true;
+            break;
+        }
+
+        entry->callback(entry->fd);
+    }
+
+    return true;
+}
+
+
+void uavos::comm::CEpollReactor::stop ()
+{
+    const uint64_t value = 1;
+    if (write(m_shutdown_fd, &value, sizeof(value)) != sizeof(value))
+    {
+        PLOG(plog::error) << "CEpollReactor::stop eventfd write failed errno:" << errno;
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef CEPOLLREACTOR_H
+
+#define CEPOLLREACTOR_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace uavos
+{
+namespace comm
+{
+
+/**
+ * @brief called from reactor thread when fd is readable.
+ * @param fd that became readable.
+ */
+typedef std::function<void(const int fd)> REACTOR_CALLBACK;
+
+
+/**
+ * @brief Event loop based on epoll.
+ * @details waits on registered fds, timerfds and a shutdown eventfd together.
+ * Thread is blocked in epoll_wait when idle and wakes up immediately on @link stop @endlink.
+ * All callbacks are executed in the thread that calls @link run @endlink.
+ *
+ */
+class CEpollReactor
+{
+    public:
+
+        CEpollReactor();
+        ~CEpollReactor();
+
+        CEpollReactor(CEpollReactor const&)            = delete;
+        void operator=(CEpollReactor const&)           = delete;
+
+    public:
+
+        /**
+         * @brief watch fd for read events.
+         * @details can be called from any thread. fd is not owned by reactor.
+         *
+         * @param fd
+         * @param callback
+         * @return true if added.
+         */
+        bool addFD (const int fd, REACTOR_CALLBACK callback);
+
+        /**
+         * @brief create a periodic timer.
+         * @details timer is owned and closed by reactor.
+         *
+         * @param interval_ms
+         * @param callback called once per expiration batch.
+         * @return int timerfd or -1 if failed.
+         */
+        int addTimer (const unsigned int interval_ms, REACTOR_CALLBACK callback);
+
+        /**
+         * @brief runs event loop until @link stop @endlink is called.
+         *
+         */
+        void run ();
+
+        /**
+         * @brief handle events that are ready now without waiting.
+         * @details used when reactor is driven by another event loop that watches @link getFD @endlink.
+         *
+         */
+        void poll ();
+
+        /**
+         * @brief signal shutdown eventfd. can be called from any thread.
+         *
+         */
+        void stop ();
+
+        bool isStopped () const { return m_stopped; }
+
+        /**
+         * @brief epoll fd. becomes readable when any event is ready.
+         */
+        int getFD () const { return m_epoll_fd; }
+
+    private:
+
+        /**
+         * @brief wait for events up to timeout_ms and dispatch them.
+         * @return false if epoll failed.
+         */
+        bool processEvents (const int timeout_ms);
+
+        typedef struct
+        {
+            int fd;
+            REACTOR_CALLBACK callback;
+        } REACTOR_ENTRY;
+
+        int m_epoll_fd    = -1;
+        int m_shutdown_fd = -1;
+        std::atomic<bool> m_stopped = {false};
+
+        std::mutex m_lock;
+        std::vector<std::unique_ptr<REACTOR_ENTRY>> m_entries;
+        std::vector<int> m_timer_fds;
+};
+
+}
+}
+
+#endif
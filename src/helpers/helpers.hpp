@@ -5,6 +5,7 @@
 #include <cctype>
 #include <algorithm>
 #include <sys/time.h>
+#include <time.h>
 #include <vector>
 #include <sstream>
 
@@ -18,6 +19,30 @@ static inline uint64_t get_time_usec()
 	return _time_stamp.tv_sec*1000000 + _time_stamp.tv_usec;
 };
 
+/**
+ * @brief time that is not affected by system clock changes. used for timeouts only.
+ */
+static inline uint64_t get_monotonic_time_usec()
+{
+	struct timespec _time_stamp;
+	clock_gettime(CLOCK_MONOTONIC, &_time_stamp);
+	return _time_stamp.tv_sec*1000000ULL + _time_stamp.tv_nsec / 1000;
+};
+
+/**
+ * @brief FNV-1a 64 bit hash. used to detect changed messages cheaply.
+ */
+inline uint64_t hash_fnv1a_64 (const char * data, const std::size_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (std::size_t i=0; i<length; ++i)
+	{
+		hash ^= (unsigned char) data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
 inline int wait_time_nsec (const time_t& seconds, const long& nano_seconds)
 {
 	struct timespec _time_wait, tim2;
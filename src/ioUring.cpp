@@ -0,0 +1,193 @@
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "ioUring.hpp"
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+
+static inline int io_uring_setup (const unsigned int entries, struct io_uring_params * params)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+
+static inline int io_uring_enter (const int ring_fd, const unsigned int to_submit, const unsigned int min_complete, const unsigned int flags)
+{
+    return (int) syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+
+uavos::comm::CIOUring::CIOUring()
+{
+
+}
+
+
+uavos::comm::CIOUring::~CIOUring()
+{
+    close();
+}
+
+
+bool uavos::comm::CIOUring::isSupported ()
+{
+    CIOUring ring;
+
+    return ring.init(2);
+}
+
+
+bool uavos::comm::CIOUring::init (const unsigned int entries)
+{
+    close();
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    m_ring_fd = io_uring_setup(entries, &params);
+    if (m_ring_fd < 0)
+    {
+        // ENOSYS on old kernels, EPERM if disabled by kernel.io_uring_disabled.
+        m_ring_fd = -1;
+        return false;
+    }
+
+    m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap)
+    {
+        if (m_cq_ring_size > m_sq_ring_size) m_sq_ring_size = m_cq_ring_size;
+        m_cq_ring_size = m_sq_ring_size;
+    }
+
+    m_sq_ring = mmap(NULL, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ring == MAP_FAILED)
+    {
+        m_sq_ring = nullptr;
+        close();
+        return false;
+    }
+
+    if (single_mmap)
+    {
+        m_cq_ring = m_sq_ring;
+    }
+    else
+    {
+        m_cq_ring = mmap(NULL, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+        if (m_cq_ring == MAP_FAILED)
+        {
+            m_cq_ring = nullptr;
+            close();
+            return false;
+        }
+    }
+
+    m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_sqes = (struct io_uring_sqe *) mmap(NULL, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+    if (m_sqes == MAP_FAILED)
+    {
+        m_sqes = nullptr;
+        close();
+        return false;
+    }
+
+    char * sq = (char *) m_sq_ring;
+    m_sq_head       = (unsigned int *) (sq + params.sq_off.head);
+    m_sq_tail       = (unsigned int *) (sq + params.sq_off.tail);
+    m_sq_array      = (unsigned int *) (sq + params.sq_off.array);
+    m_sq_mask       = *(unsigned int *) (sq + params.sq_off.ring_mask);
+    m_sq_entries    = params.sq_entries;
+    m_sqe_head      = 0;
+    m_sqe_tail      = 0;
+
+    char * cq = (char *) m_cq_ring;
+    m_cq_head       = (unsigned int *) (cq + params.cq_off.head);
+    m_cq_tail       = (unsigned int *) (cq + params.cq_off.tail);
+    m_cqes          = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+    m_cq_mask       = *(unsigned int *) (cq + params.cq_off.ring_mask);
+
+    return true;
+}
+
+
+void uavos::comm::CIOUring::close ()
+{
+    if (m_sqes != nullptr) munmap(m_sqes, m_sqes_size);
+    if ((m_cq_ring != nullptr) && (m_cq_ring != m_sq_ring)) munmap(m_cq_ring, m_cq_ring_size);
+    if (m_sq_ring != nullptr) munmap(m_sq_ring, m_sq_ring_size);
+
+    m_sqes = nullptr;
+    m_cq_ring = nullptr;
+    m_sq_ring = nullptr;
+
+    if (m_ring_fd != -1)
+    {
+        ::close(m_ring_fd);
+        m_ring_fd = -1;
+    }
+}
+
+
+struct io_uring_sqe * uavos::comm::CIOUring::getSQE ()
+{
+    const unsigned int head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    if (m_sqe_tail - head >= m_sq_entries) return NULL;
+
+    struct io_uring_sqe * sqe = &m_sqes[m_sqe_tail & m_sq_mask];
+    m_sqe_tail++;
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+
+    return sqe;
+}
+
+
+int uavos::comm::CIOUring::submit (const unsigned int wait_count)
+{
+    // publish entries prepared by getSQE.
+    unsigned int tail = *m_sq_tail;
+    const unsigned int to_submit = m_sqe_tail - m_sqe_head;
+    while (m_sqe_head != m_sqe_tail)
+    {
+        m_sq_array[tail & m_sq_mask] = m_sqe_head & m_sq_mask;
+        tail++;
+        m_sqe_head++;
+    }
+    __atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+
+    int res;
+    do
+    {
+        res = io_uring_enter(m_ring_fd, to_submit, wait_count, (wait_count != 0) ? IORING_ENTER_GETEVENTS : 0);
+    } while ((res < 0) && (errno == EINTR));
+
+    if (res < 0)
+    {
+        return -errno;
+    }
+
+    return res;
+}
+
+
+const struct io_uring_cqe * uavos::comm::CIOUring::peekCQE ()
+{
+    const unsigned int head = *m_cq_head;
+    if (head == __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE)) return NULL;
+
+    return &m_cqes[head & m_cq_mask];
+}
+
+
+void uavos::comm::CIOUring::seenCQE ()
+{
+    __atomic_store_n(m_cq_head, *m_cq_head + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,101 @@
+#ifndef CIOURING_H
+
+#define CIOURING_H
+
+#include <cstdint>
+#include <cstddef>
+#include <linux/io_uring.h>
+
+
+namespace uavos
+{
+namespace comm
+{
+
+/**
+ * @brief Minimal io_uring wrapper based on raw syscalls.
+ * @details liburing is not required. A ring is used by one thread only.
+ * Availability is checked at runtime so callers can fall back to epoll on older kernels.
+ *
+ */
+class CIOUring
+{
+    public:
+
+        CIOUring();
+        ~CIOUring();
+
+        CIOUring(CIOUring const&)            = delete;
+        void operator=(CIOUring const&)      = delete;
+
+    public:
+
+        /**
+         * @brief true if kernel supports io_uring and it is not disabled.
+         */
+        static bool isSupported ();
+
+        /**
+         * @brief create ring.
+         *
+         * @param entries submission queue size.
+         * @return false if io_uring is not available.
+         */
+        bool init (const unsigned int entries);
+        void close ();
+
+        /**
+         * @brief get a cleared submission entry.
+         *
+         * @return struct io_uring_sqe* NULL if queue is full. call @link submit @endlink first.
+         */
+        struct io_uring_sqe * getSQE ();
+
+        /**
+         * @brief submit pending entries and wait for wait_count completions.
+         *
+         * @param wait_count
+         * @return int number of submitted entries or -errno.
+         */
+        int submit (const unsigned int wait_count);
+
+        /**
+         * @brief get next completion without waiting.
+         *
+         * @return const struct io_uring_cqe* NULL if none. call @link seenCQE @endlink after handling it.
+         */
+        const struct io_uring_cqe * peekCQE ();
+        void seenCQE ();
+
+        unsigned int getEntries () const { return m_sq_entries; }
+
+    private:
+
+        int m_ring_fd = -1;
+
+        void * m_sq_ring = nullptr;
+        std::size_t m_sq_ring_size = 0;
+        void * m_cq_ring = nullptr;
+        std::size_t m_cq_ring_size = 0;
+        struct io_uring_sqe * m_sqes = nullptr;
+        std::size_t m_sqes_size = 0;
+
+        unsigned int * m_sq_head = nullptr;
+        unsigned int * m_sq_tail = nullptr;
+        unsigned int * m_sq_array = nullptr;
+        unsigned int m_sq_mask = 0;
+        unsigned int m_sq_entries = 0;
+        // entries handed out by getSQE but not submitted yet.
+        unsigned int m_sqe_head = 0;
+        unsigned int m_sqe_tail = 0;
+
+        unsigned int * m_cq_head = nullptr;
+        unsigned int * m_cq_tail = nullptr;
+        struct io_uring_cqe * m_cqes = nullptr;
+        unsigned int m_cq_mask = 0;
+};
+
+}
+}
+
+#endif
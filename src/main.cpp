@@ -30,11 +30,17 @@
 #include "configFile.hpp"
 #include "localConfigFile.hpp"
 #include "udpCommunicator.hpp"
+#include "messageLatency.hpp"
+#include "messageStatistics.hpp"
 
 #include "./comm_server/andruav_unit.hpp"
 #include "./comm_server/andruav_comm_server.hpp"
 #include "./comm_server/andruav_facade.hpp"
+#include "./comm_server/andruav_uplink_coalescer.hpp"
 #include "./uavos/uavos_modules_manager.hpp"
+#include "./uavos/uavos_module_dispatcher.hpp"
+#include "./uavos/uavos_license_verifier.hpp"
+#include "./uavos/uavos_license_cache.hpp"
 #include "./hal/gpio.hpp"
 #include "./notification_module/leds.hpp"
 #include "./notification_module/buzzer.hpp"
@@ -50,6 +56,9 @@ uavos::CConfigFile& cConfigFile = uavos::CConfigFile::getInstance();
 uavos::CLocalConfigFile& cLocalConfigFile = uavos::CLocalConfigFile::getInstance();
 uavos::comm::CUDPCommunicator& cUDPClient = uavos::comm::CUDPCommunicator::getInstance();  
 uavos::CUavosModulesManager& cUavosModulesManager = uavos::CUavosModulesManager::getInstance();  
+uavos::CUavosModuleDispatcher& cUavosModuleDispatcher = uavos::CUavosModuleDispatcher::getInstance();  
+uavos::CModuleLicenseVerifier& cModuleLicenseVerifier = uavos::CModuleLicenseVerifier::getInstance();  
+uavos::andruav_servers::CAndruavUplinkCoalescer& cAndruavUplinkCoalescer = uavos::andruav_servers::CAndruavUplinkCoalescer::getInstance();  
 
 //hal_linux::CRPI_GPIO &cGPIO = hal_linux::CRPI_GPIO::getInstance();
 notification::CLEDs &cLeds = notification::CLEDs::getInstance();
@@ -100,6 +109,7 @@ void scheduler ()
     const int every_sec_5  =  50;
     const int every_sec_10 = 100;
     const int every_sec_15 = 150;
+    const int every_sec_60 = 600;
 
     uavos::andruav_servers::CAndruavFacade& andruav_facade = uavos::andruav_servers::CAndruavFacade::getInstance();
     
@@ -123,10 +133,12 @@ void scheduler ()
             // }
         }
 
+        // only modules whose deadline is reached are checked.
+        cUavosModulesManager.handleDeadModules(); //TODO: Why when online only ??
+        cUavosModulesManager.handlePendingRequests();
+
         if (hz_10 % every_sec_5 == 0)
         {
-            cUavosModulesManager.handleDeadModules(); //TODO: Why when online only ??
-            
             if (helpers::CUtil_Rpi::getInstance().get_rpi_model() != -1)
             {
                 uint32_t cpu_status=0;
@@ -157,6 +169,8 @@ void scheduler ()
 
         if (hz_10 % every_sec_10 == 0)
         {
+            uavos::comm::CMessageStatistics::getInstance().takeSnapshot();
+
             if (status.is_online())
             {
                 andruav_facade.API_sendID("");
@@ -166,6 +180,13 @@ void scheduler ()
         if (hz_10 % every_sec_15 == 0)
         {
         }
+
+        if (hz_10 % every_sec_60 == 0)
+        {
+            uavos::comm::CMessageLatency::getInstance().logSummary(true);
+            cAndruavUplinkCoalescer.logSummary(true);
+            uavos::comm::CMessageStatistics::getInstance().logSummary(true);
+        }
         
         usleep(100000); // 10Hz
     }
@@ -174,14 +195,14 @@ void scheduler ()
 }
 
 
-void onReceive (const char * message, int len, struct sockaddr_in * ssock)
+void onReceive (const char * message, int len, const SOCKET_ADDRESS * ssock, const uint64_t ingress_nsec)
 {
         
     #ifdef DEBUG        
         std::cout << _INFO_CONSOLE_TEXT << "RX MSG: " << message << _NORMAL_CONSOLE_TEXT_ << std::endl;
     #endif
 
-    cUavosModulesManager.parseIntermoduleMessage(message, len, ssock);
+    cUavosModulesManager.parseIntermoduleMessage(message, len, ssock, ingress_nsec);
 
 }
 
@@ -256,6 +277,7 @@ void defineMe()
     unit_info.unit_name = jsonConfig["userName"].get<std::string>();
     unit_info.group_name = jsonConfig["groupID"].get<std::string>();
     unit_info.description = jsonConfig["unitDescription"].get<std::string>();
+    m_andruavMe.touchUnitInfo();
 }
 
 
@@ -281,13 +303,216 @@ void initSockets()
 {
     const Json& jsonConfig = cConfigFile.GetConfigJSON();
     
+    if (validateField(jsonConfig, "s2s_udp_batch_size", Json::value_t::number_unsigned))
+    {
+        cUDPClient.setBatchSize(jsonConfig["s2s_udp_batch_size"].get<int>());
+    }
+    
+    if (validateField(jsonConfig, "s2s_udp_receiver_threads", Json::value_t::number_unsigned))
+    {
+        cUDPClient.setReceiverThreads(jsonConfig["s2s_udp_receiver_threads"].get<int>());
+    }
+
+    if (validateField(jsonConfig, "s2s_io_backend", Json::value_t::string))
+    {
+        if (jsonConfig["s2s_io_backend"].get<std::string>() == "io_uring")
+        {
+            cUDPClient.setIOBackend(uavos::comm::IO_BACKEND_IO_URING);
+        }
+    }
+
     // UDP Server
     cUDPClient.init(jsonConfig["s2s_udp_listening_ip"].get<std::string>().c_str() ,
                     std::stoi(jsonConfig["s2s_udp_listening_port"].get<std::string>().c_str()));
     
+    // Unix Domain Socket for co-located modules [optional].
+    if (validateField(jsonConfig, "s2s_unix_socket_path", Json::value_t::string))
+    {
+        cUDPClient.initUnix(jsonConfig["s2s_unix_socket_path"].get<std::string>().c_str());
+    }
     
     cUDPClient.SetMessageOnReceive (&onReceive);
     cUDPClient.start();
+
+    // Outbound queues of modules.
+    std::size_t queue_size = DEFAULT_MODULE_QUEUE_SIZE;
+    ENUM_QUEUE_POLICY queue_policy = QUEUE_DROP_OLDEST;
+    if (validateField(jsonConfig, "s2s_module_queue_size", Json::value_t::number_unsigned))
+    {
+        queue_size = jsonConfig["s2s_module_queue_size"].get<int>();
+    }
+
+    if (validateField(jsonConfig, "s2s_module_queue_policy", Json::value_t::string))
+    {
+        const std::string policy = jsonConfig["s2s_module_queue_policy"].get<std::string>();
+        if (policy == "drop_newest")
+        {
+            queue_policy = QUEUE_DROP_NEWEST;
+        }
+        else if (policy == "block")
+        {
+            queue_policy = QUEUE_BLOCK;
+        }
+    }
+
+    cUavosModuleDispatcher.setQueueLimits(queue_size, queue_policy);
+    cUavosModuleDispatcher.start();
+
+    // License verification with auth server is slow so it is done away from receive threads.
+    cModuleLicenseVerifier.setOnVerified([](const std::string& hardware_serial, const int hardware_type, const bool valid, const bool replied)
+    {
+        cUavosModulesManager.handleLicenseVerified(hardware_serial, hardware_type, valid, replied);
+    });
+    cModuleLicenseVerifier.start();
+}
+
+
+/**
+ * @brief load module license verdicts saved by previous runs.
+ * @details cache is stored next to local config file. it should be ready before modules can register.
+ * 
+ */
+void initLicenseCache()
+{
+    const Json& jsonConfig = cConfigFile.GetConfigJSON();
+
+    uint64_t ttl_hours = DEFAULT_LICENSE_CACHE_TTL_HOURS;
+    if (validateField(jsonConfig, "license_cache_ttl_hours", Json::value_t::number_unsigned))
+    {
+        ttl_hours = jsonConfig["license_cache_ttl_hours"].get<uint64_t>();
+    }
+
+    const std::size_t separator = localConfigName.find_last_of('/');
+    const std::string folder = (separator == std::string::npos) ? std::string() : localConfigName.substr(0, separator + 1);
+
+    // entries are signed by a key unique to this unit.
+    const std::string secret = jsonConfig["accessCode"].get<std::string>() 
+                            + cLocalConfigFile.getStringField("party_id") 
+                            + cLocalConfigFile.getStringField("module_key");
+
+    uavos::CLicenseVerdictCache::getInstance().init(folder + LICENSE_CACHE_FILE_NAME, secret, ttl_hours * 3600);
+}
+
+
+/**
+ * @brief time allowed between TYPE_AndruavModule_ID per module class e.g. {"fcb": 1500}.
+ * @details modules of other classes use MODULE_TIME_OUT. it should be set before modules can register.
+ * 
+ */
+void initModuleTimeouts()
+{
+    const Json& jsonConfig = cConfigFile.GetConfigJSON();
+
+    if (!validateField(jsonConfig, "module_timeouts_ms", Json::value_t::object)) return ;
+
+    for (const auto& class_timeout : jsonConfig["module_timeouts_ms"].items())
+    {
+        if (!class_timeout.value().is_number_unsigned()) continue;
+
+        cUavosModulesManager.setModuleClassTimeout(class_timeout.key(), class_timeout.value().get<uint64_t>() * 1000);
+    }
+}
+
+
+/**
+ * @brief message types with many subscribers e.g. [1005, 1004] are sent once to a loopback multicast group.
+ * @details disabled if "module_multicast" is not defined. should be called before initSockets.
+ * 
+ */
+void initModuleMulticast()
+{
+    const Json& jsonConfig = cConfigFile.GetConfigJSON();
+
+    if (!validateField(jsonConfig, "module_multicast", Json::value_t::object)) return ;
+
+    const Json& module_multicast = jsonConfig["module_multicast"];
+    if ((!validateField(module_multicast, "group", Json::value_t::string))
+        || (!validateField(module_multicast, "port", Json::value_t::number_unsigned))
+        || (!validateField(module_multicast, "message_types", Json::value_t::array)))
+    {
+        std::cout  << _ERROR_CONSOLE_BOLD_TEXT_ << "module_multicast requires group, port & message_types" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+        return ;
+    }
+
+    std::vector<int> message_types;
+    for (const auto& message_type : module_multicast["message_types"])
+    {
+        if (!message_type.is_number_integer()) continue;
+
+        message_types.push_back(message_type.get<int>());
+    }
+
+    std::size_t min_subscribers = 2;
+    if (validateField(module_multicast, "min_subscribers", Json::value_t::number_unsigned))
+    {
+        min_subscribers = module_multicast["min_subscribers"].get<std::size_t>();
+    }
+
+    cUDPClient.enableLoopbackMulticast();
+    cUavosModulesManager.setMulticastGroups(module_multicast["group"].get<std::string>(), module_multicast["port"].get<int>(), message_types, min_subscribers);
+
+    std::cout  << _INFO_CONSOLE_TEXT << "Module multicast of " << message_types.size() << " message types on " << module_multicast["group"].get<std::string>() << _NORMAL_CONSOLE_TEXT_ << std::endl;
+}
+
+
+/**
+ * @brief time replies of a module request are expected & requests a module can have waiting for replies.
+ * @details MODULE_REQUEST_TIME_OUT & MODULE_MAX_PENDING_REQUESTS are used if "module_requests" is not defined.
+ * 
+ */
+void initModuleRequests()
+{
+    const Json& jsonConfig = cConfigFile.GetConfigJSON();
+
+    if (!validateField(jsonConfig, "module_requests", Json::value_t::object)) return ;
+
+    const Json& module_requests = jsonConfig["module_requests"];
+    
+    uint64_t timeout_usec = MODULE_REQUEST_TIME_OUT;
+    if (validateField(module_requests, "timeout_ms", Json::value_t::number_unsigned))
+    {
+        timeout_usec = module_requests["timeout_ms"].get<uint64_t>() * 1000;
+    }
+
+    std::size_t max_pending = MODULE_MAX_PENDING_REQUESTS;
+    if (validateField(module_requests, "max_pending", Json::value_t::number_unsigned))
+    {
+        max_pending = module_requests["max_pending"].get<std::size_t>();
+    }
+
+    cUavosModulesManager.setRequestLimits(timeout_usec, max_pending);
+}
+
+
+/**
+ * @brief state-like messages from modules e.g. [1036, 1002] are coalesced before sent to server.
+ * @details disabled if "uplink_coalesce_types" is not defined.
+ * 
+ */
+void initUplinkCoalescer()
+{
+    const Json& jsonConfig = cConfigFile.GetConfigJSON();
+
+    if (!validateField(jsonConfig, "uplink_coalesce_types", Json::value_t::array)) return ;
+
+    std::set<int> message_types;
+    for (const auto& message_type : jsonConfig["uplink_coalesce_types"])
+    {
+        if (!message_type.is_number_integer()) continue;
+
+        message_types.insert(message_type.get<int>());
+    }
+
+    uint64_t interval_ms = DEFAULT_UPLINK_COALESCE_INTERVAL_MS;
+    if (validateField(jsonConfig, "uplink_coalesce_interval_ms", Json::value_t::number_unsigned))
+    {
+        interval_ms = jsonConfig["uplink_coalesce_interval_ms"].get<uint64_t>();
+    }
+
+    cAndruavUplinkCoalescer.init(message_types, interval_ms);
+    cAndruavUplinkCoalescer.start();
+
+    std::cout  << _INFO_CONSOLE_TEXT << "Uplink coalescing of " << message_types.size() << " message types every " << interval_ms << " ms" << _NORMAL_CONSOLE_TEXT_ << std::endl;
 }
 
 
@@ -410,6 +635,12 @@ void init (int argc, char *argv[])
 
     initScheduler();
 
+    initLicenseCache();
+    initModuleTimeouts();
+    initUplinkCoalescer();
+    initModuleMulticast();
+    initModuleRequests();
+
     initSockets();
 
     connectToCommServer ();
@@ -429,6 +660,9 @@ void uninit ()
 	
     cLeds.uninit();
     
+    // pending coalesced messages are dropped.
+    cAndruavUplinkCoalescer.stop();
+
     andruav_server.uninit(true);
     
     #ifdef DEBUG
@@ -436,8 +670,17 @@ void uninit ()
     #endif
     
     
+    cModuleLicenseVerifier.stop();
+
+    cUavosModuleDispatcher.stop();
+
     cUDPClient.stop();
 
+    uavos::comm::CMessageLatency::getInstance().logSummary(false);
+    cAndruavUplinkCoalescer.logSummary(true);
+    uavos::comm::CMessageStatistics::getInstance().takeSnapshot();
+    uavos::comm::CMessageStatistics::getInstance().logSummary(false);
+
     #ifdef DEBUG
         std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: Unint_after Stop" << _NORMAL_CONSOLE_TEXT_ << std::endl;
     #endif
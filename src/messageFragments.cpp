@@ -0,0 +1,191 @@
+#include <iostream>
+#include <cstring>
+#include <arpa/inet.h>
+
+#include "./helpers/colors.hpp"
+#include "./helpers/helpers.hpp"
+#include "messageFragments.hpp"
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+
+void uavos::comm::buildFragmentHeader (FRAGMENT_HEADER& header, const uint32_t message_id, const uint32_t total_length, const uint32_t fragment_offset, const uint16_t fragment_index, const uint16_t fragment_count)
+{
+    header.magic[0]         = FRAGMENT_MAGIC_0;
+    header.magic[1]         = FRAGMENT_MAGIC_1;
+    header.version          = FRAGMENT_VERSION;
+    header.flags            = 0;
+    header.message_id       = htonl(message_id);
+    header.total_length     = htonl(total_length);
+    header.fragment_offset  = htonl(fragment_offset);
+    header.fragment_index   = htons(fragment_index);
+    header.fragment_count   = htons(fragment_count);
+}
+
+
+bool uavos::comm::CFragmentReassembler::addFragment (const char * datagram, const std::size_t length, const SOCKET_ADDRESS * sender, const uint64_t ingress_nsec, std::vector<char>& completed, uint64_t& completed_ingress_nsec)
+{
+    m_counters.fragments++;
+
+    FRAGMENT_HEADER header;
+    memcpy(&header, datagram, sizeof(FRAGMENT_HEADER));
+
+    const uint32_t message_id       = ntohl(header.message_id);
+    const uint32_t total_length     = ntohl(header.total_length);
+    const uint32_t fragment_offset  = ntohl(header.fragment_offset);
+    const uint16_t fragment_index   = ntohs(header.fragment_index);
+    const uint16_t fragment_count   = ntohs(header.fragment_count);
+    const char * payload            = datagram + sizeof(FRAGMENT_HEADER);
+    const std::size_t payload_length = length - sizeof(FRAGMENT_HEADER);
+
+    if ((header.version != FRAGMENT_VERSION)
+        || (total_length == 0) || (total_length > FRAGMENT_MAX_MESSAGE_LENGTH)
+        || (fragment_count == 0) || (fragment_index >= fragment_count)
+        || (fragment_offset > total_length) || (payload_length > total_length - fragment_offset))
+    {
+        m_counters.dropped++;
+        return false;
+    }
+
+    std::string key((const char *) &sender->address, sender->length);
+    key.append((const char *) &message_id, sizeof(message_id));
+
+    if (m_completed_messages.find(key) != m_completed_messages.end())
+    {
+        // late duplicate of a completed message.
+        return false;
+    }
+
+    auto item = m_partial_messages.find(key);
+    if (item == m_partial_messages.end())
+    {
+        while ((!m_partial_messages.empty()) && (m_pending_memory + total_length > FRAGMENT_MAX_PENDING_MEMORY))
+        {
+            dropOldest();
+        }
+
+        PARTIAL_MESSAGE partial;
+        // one extra byte to zero-terminate the message.
+        partial.buffer.resize(total_length + 1);
+        partial.received.resize(fragment_count, false);
+        partial.fragment_offsets.resize(fragment_count, 0);
+        partial.fragment_lengths.resize(fragment_count, 0);
+        partial.total_length    = total_length;
+        partial.fragment_count  = fragment_count;
+        partial.received_count  = 0;
+        partial.first_time      = get_time_usec();
+        partial.first_ingress_nsec = ingress_nsec;
+
+        item = m_partial_messages.insert(std::make_pair(key, std::move(partial))).first;
+        m_pending_memory += total_length;
+    }
+
+    PARTIAL_MESSAGE& partial = item->second;
+    if ((partial.total_length != total_length) || (partial.fragment_count != fragment_count))
+    {
+        // sender reused message id with a different message.
+        m_counters.dropped++;
+        return false;
+    }
+
+    if (partial.received[fragment_index])
+    {
+        // duplicate
+        return false;
+    }
+
+    memcpy(&partial.buffer[fragment_offset], payload, payload_length);
+    partial.received[fragment_index] = true;
+    partial.fragment_offsets[fragment_index] = fragment_offset;
+    partial.fragment_lengths[fragment_index] = payload_length;
+    partial.received_count++;
+    // fragments may be reordered. message latency starts at the earliest one.
+    if (ingress_nsec < partial.first_ingress_nsec) partial.first_ingress_nsec = ingress_nsec;
+
+    if (partial.received_count < partial.fragment_count) return false;
+
+    if (!isContiguous(partial))
+    {
+        // buggy sender. message would have holes of zero bytes.
+        PLOG(plog::warning) << "CFragmentReassembler fragments of message " << message_id << " do not cover its " << total_length << " bytes";
+        m_pending_memory -= total_length;
+        m_partial_messages.erase(item);
+        m_counters.dropped++;
+        return false;
+    }
+
+    completed_ingress_nsec = partial.first_ingress_nsec;
+
+    partial.buffer[total_length] = 0;
+    completed.swap(partial.buffer);
+    completed.resize(total_length);
+    m_pending_memory -= total_length;
+    m_partial_messages.erase(item);
+    m_counters.completed++;
+
+    if (m_completed_order.size() >= FRAGMENT_MAX_COMPLETED_MESSAGES)
+    {
+        m_completed_messages.erase(m_completed_order.front());
+        m_completed_order.pop_front();
+    }
+    m_completed_messages[key] = get_time_usec();
+    m_completed_order.push_back(key);
+
+    return true;
+}
+
+
+bool uavos::comm::CFragmentReassembler::isContiguous (const PARTIAL_MESSAGE& partial)
+{
+    uint64_t next_offset = 0;
+    for (uint16_t i=0; i<partial.fragment_count; ++i)
+    {
+        if (partial.fragment_offsets[i] != next_offset) return false;
+        next_offset += partial.fragment_lengths[i];
+    }
+
+    return (next_offset == partial.total_length);
+}
+
+
+void uavos::comm::CFragmentReassembler::expire (const uint64_t now_usec)
+{
+    for (auto item = m_partial_messages.begin(); item != m_partial_messages.end();)
+    {
+        if (now_usec - item->second.first_time > FRAGMENT_TIMEOUT_USEC)
+        {
+            #ifdef DEBUG
+                std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: fragmented message expired. received " << item->second.received_count << " of " << item->second.fragment_count << _NORMAL_CONSOLE_TEXT_ << std::endl;
+            #endif
+
+            m_pending_memory -= item->second.total_length;
+            item = m_partial_messages.erase(item);
+            m_counters.expired++;
+        }
+        else
+        {
+            ++item;
+        }
+    }
+
+    while ((!m_completed_order.empty()) && (now_usec - m_completed_messages[m_completed_order.front()] > FRAGMENT_TIMEOUT_USEC))
+    {
+        m_completed_messages.erase(m_completed_order.front());
+        m_completed_order.pop_front();
+    }
+}
+
+
+void uavos::comm::CFragmentReassembler::dropOldest ()
+{
+    auto oldest = m_partial_messages.begin();
+    for (auto item = m_partial_messages.begin(); item != m_partial_messages.end(); ++item)
+    {
+        if (item->second.first_time < oldest->second.first_time) oldest = item;
+    }
+
+    m_pending_memory -= oldest->second.total_length;
+    m_partial_messages.erase(oldest);
+    m_counters.dropped++;
+}
@@ -0,0 +1,167 @@
+#ifndef CMESSAGEFRAGMENTS_H
+
+#define CMESSAGEFRAGMENTS_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "udpCommunicator.hpp"
+
+
+#define FRAGMENT_MAGIC_0        'D'
+#define FRAGMENT_MAGIC_1        'F'
+#define FRAGMENT_VERSION        1
+
+// largest message that can be reassembled.
+#define FRAGMENT_MAX_MESSAGE_LENGTH     (16 * 1024 * 1024)
+// total memory of partial messages per reassembler. oldest messages are dropped beyond it.
+#define FRAGMENT_MAX_PENDING_MEMORY     (64 * 1024 * 1024)
+// partial message is dropped if not completed within this time.
+#define FRAGMENT_TIMEOUT_USEC           2000000
+// a message sent to a busy Unix peer waits at most FRAGMENT_SEND_RETRIES * FRAGMENT_SEND_RETRY_USEC.
+#define FRAGMENT_SEND_RETRIES           50
+#define FRAGMENT_SEND_RETRY_USEC        1000
+// completed message ids remembered to drop late duplicate fragments. oldest are forgotten beyond it.
+#define FRAGMENT_MAX_COMPLETED_MESSAGES 4096
+// how often partial messages are checked for timeout.
+#define FRAGMENT_SWEEP_INTERVAL_MS      250
+
+
+namespace uavos
+{
+namespace comm
+{
+
+/**
+ * @brief header that precedes every fragment of a large message.
+ * @details all fields are in network byte order.
+ * JSON messages start with '{' so a datagram that starts with magic is always a fragment.
+ * fragment payload is placed at fragment_offset so fragments can arrive in any order.
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t  magic[2];
+    uint8_t  version;
+    uint8_t  flags;
+    uint32_t message_id;
+    uint32_t total_length;
+    uint32_t fragment_offset;
+    uint16_t fragment_index;
+    uint16_t fragment_count;
+} FRAGMENT_HEADER;
+
+
+typedef struct
+{
+    uint64_t fragments;
+    uint64_t completed;
+    uint64_t expired;
+    uint64_t dropped;
+} FRAGMENT_COUNTERS;
+
+
+/**
+ * @brief true if datagram is a fragment of a larger message.
+ *
+ * @param datagram
+ * @param length
+ */
+inline bool isFragment (const char * datagram, const std::size_t length)
+{
+    return (length > sizeof(FRAGMENT_HEADER))
+        && (datagram[0] == FRAGMENT_MAGIC_0)
+        && (datagram[1] == FRAGMENT_MAGIC_1);
+}
+
+
+/**
+ * @brief fill header of fragment number fragment_index.
+ *
+ */
+void buildFragmentHeader (FRAGMENT_HEADER& header, const uint32_t message_id, const uint32_t total_length, const uint32_t fragment_offset, const uint16_t fragment_index, const uint16_t fragment_count);
+
+
+/**
+ * @brief Rebuilds large messages from their fragments.
+ * @details one instance is owned by each receiver thread so no locking is needed.
+ * Memory is bounded by @link FRAGMENT_MAX_PENDING_MEMORY @endlink and partial messages
+ * expire after @link FRAGMENT_TIMEOUT_USEC @endlink.
+ * fragments of a completed message are ignored for @link FRAGMENT_TIMEOUT_USEC @endlink so duplicates
+ * cannot complete it again. senders should not reuse a message id within this time.
+ *
+ */
+class CFragmentReassembler
+{
+    public:
+
+        CFragmentReassembler() {};
+
+        CFragmentReassembler(CFragmentReassembler const&)     = delete;
+        void operator=(CFragmentReassembler const&)           = delete;
+
+    public:
+
+        /**
+         * @brief add a fragment.
+         *
+         * @param datagram fragment including its header.
+         * @param length
+         * @param sender
+         * @param ingress_nsec receive time of fragment.
+         * @param completed receives the whole message when this is its last missing fragment.
+         * completed is zero-terminated but its size does not count the terminator.
+         * @param completed_ingress_nsec receive time of first fragment of completed message.
+         * @return true if message has been completed. messages whose fragments leave holes or overlap are dropped.
+         */
+        bool addFragment (const char * datagram, const std::size_t length, const SOCKET_ADDRESS * sender, const uint64_t ingress_nsec, std::vector<char>& completed, uint64_t& completed_ingress_nsec);
+
+        /**
+         * @brief drop partial messages that have timed out.
+         *
+         * @param now_usec
+         */
+        void expire (const uint64_t now_usec);
+
+        const FRAGMENT_COUNTERS& getCounters () const { return m_counters; }
+
+    private:
+
+        typedef struct
+        {
+            std::vector<char> buffer;
+            std::vector<bool> received;
+            // span of each fragment. checked to cover whole message without holes or overlaps.
+            std::vector<uint32_t> fragment_offsets;
+            std::vector<uint32_t> fragment_lengths;
+            uint32_t total_length;
+            uint16_t fragment_count;
+            uint16_t received_count;
+            uint64_t first_time;
+            uint64_t first_ingress_nsec;
+        } PARTIAL_MESSAGE;
+
+        void dropOldest ();
+
+        /**
+         * @brief fragments in index order are adjacent and cover [0, total_length).
+         *
+         */
+        static bool isContiguous (const PARTIAL_MESSAGE& partial);
+
+        // key is sender address followed by message id.
+        std::map<std::string, PARTIAL_MESSAGE> m_partial_messages;
+        std::size_t m_pending_memory = 0;
+        // recently completed messages mapped by key to completion time.
+        std::map<std::string, uint64_t> m_completed_messages;
+        // keys of m_completed_messages in completion order.
+        std::deque<std::string> m_completed_order;
+        FRAGMENT_COUNTERS m_counters = {0, 0, 0, 0};
+};
+
+}
+}
+
+#endif
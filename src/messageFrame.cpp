@@ -0,0 +1,92 @@
+#include <cstring>
+#include <arpa/inet.h>
+
+#include "messageFrame.hpp"
+
+
+bool uavos::comm::decodeFrame (const char * message, const std::size_t length, MESSAGE_FRAME& frame)
+{
+    FRAME_HEADER header;
+    memcpy(&header, message, sizeof(FRAME_HEADER));
+
+    const std::size_t header_length     = ntohs(header.header_length);
+    const std::size_t json_length       = ntohl(header.json_length);
+    const std::size_t payload_length    = ntohl(header.payload_length);
+
+    if ((header.version == 0) || (header.version > FRAME_VERSION)
+        || (header_length < sizeof(FRAME_HEADER)) || (header_length > length)
+        || (json_length == 0) || (json_length > length - header_length)
+        || (payload_length != length - header_length - json_length))
+    {
+        return false;
+    }
+
+    frame.json              = message + header_length;
+    frame.json_length       = json_length;
+    frame.is_binary         = ((header.flags & FRAME_FLAG_BINARY) != 0);
+    frame.payload           = frame.is_binary ? frame.json + json_length : NULL;
+    frame.payload_length    = frame.is_binary ? payload_length : 0;
+    frame.is_framed         = true;
+
+    return true;
+}
+
+
+void uavos::comm::decodeLegacyMessage (const char * message, const std::size_t length, MESSAGE_FRAME& frame)
+{
+    frame.json              = message;
+    frame.json_length       = length;
+    frame.payload           = NULL;
+    frame.payload_length    = 0;
+    frame.is_framed         = false;
+    frame.is_binary         = (length > 1) && !(message[length-1]=='}' || (message[length-2]=='}'));
+
+    if (!frame.is_binary) return ;
+
+    // search for char '0' and then binary message is the next byte after it.
+    const char * delimiter = (const char *)(memchr (message, 0x0, length));
+    if (delimiter == NULL) return ;
+
+    frame.json_length       = delimiter - message;
+    frame.payload           = delimiter + 1;
+    frame.payload_length    = length - frame.json_length - 1;
+}
+
+
+void uavos::comm::encodeFrame (const MESSAGE_FRAME& frame, std::string& message)
+{
+    FRAME_HEADER header;
+    header.magic[0]         = FRAME_MAGIC_0;
+    header.magic[1]         = FRAME_MAGIC_1;
+    header.version          = FRAME_VERSION;
+    header.flags            = frame.is_binary ? FRAME_FLAG_BINARY : 0;
+    header.header_length    = htons(sizeof(FRAME_HEADER));
+    header.reserved         = 0;
+    header.json_length      = htonl(frame.json_length);
+    header.payload_length   = htonl(frame.payload_length);
+
+    message.clear();
+    message.reserve(sizeof(FRAME_HEADER) + frame.json_length + frame.payload_length);
+    message.append((const char *) &header, sizeof(FRAME_HEADER));
+    message.append(frame.json, frame.json_length);
+    if (frame.payload_length != 0)
+    {
+        message.append(frame.payload, frame.payload_length);
+    }
+}
+
+
+void uavos::comm::encodeLegacyMessage (const MESSAGE_FRAME& frame, std::string& message)
+{
+    message.clear();
+    message.reserve(frame.json_length + 1 + frame.payload_length);
+    message.append(frame.json, frame.json_length);
+    if (frame.is_binary)
+    {
+        message.push_back(0);
+        if (frame.payload_length != 0)
+        {
+            message.append(frame.payload, frame.payload_length);
+        }
+    }
+}
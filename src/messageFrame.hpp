@@ -0,0 +1,116 @@
+#ifndef CMESSAGEFRAME_H
+
+#define CMESSAGEFRAME_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+#define FRAME_MAGIC_0           'D'
+#define FRAME_MAGIC_1           'E'
+// highest frame version understood by communicator. announced in TYPE_AndruavModule_ID.
+#define FRAME_VERSION           1
+
+// message has a binary part.
+#define FRAME_FLAG_BINARY       0x01
+
+
+namespace uavos
+{
+namespace comm
+{
+
+/**
+ * @brief header that precedes an intermodule message sent by modules that opted into framing.
+ * @details all fields are in network byte order. JSON part starts at header_length
+ * and binary part directly after JSON part. no zero delimiter is used.
+ * JSON messages start with '{' so a message that starts with magic is always framed.
+ * newer versions may append fields. header_length tells where JSON part starts.
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t  magic[2];
+    uint8_t  version;
+    uint8_t  flags;
+    uint16_t header_length;
+    uint16_t reserved;
+    uint32_t json_length;
+    uint32_t payload_length;
+} FRAME_HEADER;
+
+
+/**
+ * @brief parts of an intermodule message. points inside the received message.
+ *
+ */
+typedef struct
+{
+    const char * json;
+    std::size_t json_length;
+    // binary part. NULL if message has no binary part.
+    const char * payload;
+    std::size_t payload_length;
+    bool is_binary;
+    // message has been received as a frame.
+    bool is_framed;
+} MESSAGE_FRAME;
+
+
+/**
+ * @brief true if message starts with a frame header.
+ *
+ * @param message
+ * @param length
+ */
+inline bool isFramed (const char * message, const std::size_t length)
+{
+    return (length >= sizeof(FRAME_HEADER))
+        && (message[0] == FRAME_MAGIC_0)
+        && (message[1] == FRAME_MAGIC_1);
+}
+
+
+/**
+ * @brief locate parts of a framed message from its header.
+ *
+ * @param message
+ * @param length
+ * @param frame
+ * @return false if version is not supported or lengths do not match message length.
+ */
+bool decodeFrame (const char * message, const std::size_t length, MESSAGE_FRAME& frame);
+
+
+/**
+ * @brief locate parts of a legacy message [JSON text][0][binary].
+ * @details message is binary if it does not end with '}'. binary part follows first zero byte.
+ *
+ * @param message
+ * @param length
+ * @param frame
+ */
+void decodeLegacyMessage (const char * message, const std::size_t length, MESSAGE_FRAME& frame);
+
+
+/**
+ * @brief build a framed message.
+ *
+ * @param frame json & payload parts.
+ * @param message
+ */
+void encodeFrame (const MESSAGE_FRAME& frame, std::string& message);
+
+
+/**
+ * @brief build a legacy message [JSON text][0][binary].
+ *
+ * @param frame json & payload parts.
+ * @param message
+ */
+void encodeLegacyMessage (const MESSAGE_FRAME& frame, std::string& message);
+
+}
+}
+
+#endif
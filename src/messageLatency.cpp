@@ -0,0 +1,161 @@
+#include <iostream>
+#include <cstring>
+#include <time.h>
+
+#include "./helpers/colors.hpp"
+#include "messageLatency.hpp"
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+
+namespace
+{
+    /**
+     * @brief message handled by current thread.
+     */
+    typedef struct
+    {
+        uint64_t ingress_nsec;
+        int message_type;
+        bool active;
+    } LATENCY_CONTEXT;
+
+    thread_local LATENCY_CONTEXT latency_context = {0, -1, false};
+
+
+    unsigned int bucketOf (const uint64_t latency_usec)
+    {
+        unsigned int bucket = 0;
+        uint64_t value = latency_usec;
+        while ((value > 1) && (bucket < LATENCY_HISTOGRAM_BUCKETS - 1))
+        {
+            value >>= 1;
+            bucket++;
+        }
+
+        return bucket;
+    }
+
+
+    uint64_t percentileOf (const uavos::comm::LATENCY_HISTOGRAM& histogram, const uint64_t percent)
+    {
+        // rank of the requested sample counting from 1.
+        const uint64_t rank = (histogram.count * percent + 99) / 100;
+        uint64_t seen = 0;
+        for (unsigned int i=0; i<LATENCY_HISTOGRAM_BUCKETS; ++i)
+        {
+            seen += histogram.buckets[i];
+            if (seen >= rank)
+            {
+                const uint64_t upper = (2ull << i) - 1;
+                return (upper < histogram.max_usec) ? upper : histogram.max_usec;
+            }
+        }
+
+        return histogram.max_usec;
+    }
+}
+
+
+uint64_t uavos::comm::get_time_realtime_nsec ()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+
+uavos::comm::CMessageLatency::CScope::CScope (const uint64_t ingress_nsec)
+{
+    latency_context.ingress_nsec    = ingress_nsec;
+    latency_context.message_type    = -1;
+    latency_context.active          = (ingress_nsec != 0);
+}
+
+
+uavos::comm::CMessageLatency::CScope::~CScope ()
+{
+    latency_context.active = false;
+}
+
+
+void uavos::comm::CMessageLatency::CScope::setMessageType (const int message_type)
+{
+    latency_context.message_type = message_type;
+}
+
+
+void uavos::comm::CMessageLatency::recordEgress ()
+{
+    if ((!latency_context.active) || (latency_context.message_type < 0)) return ;
+
+    // a message may cause several writes. only first one is its latency.
+    latency_context.active = false;
+
+    const uint64_t now = get_time_realtime_nsec();
+    // clock may be stepped between receive and write.
+    if (now < latency_context.ingress_nsec) return ;
+
+    record(latency_context.message_type, (now - latency_context.ingress_nsec) / 1000);
+}
+
+
+void uavos::comm::CMessageLatency::record (const int message_type, const uint64_t latency_usec)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    auto item = m_histograms.find(message_type);
+    if (item == m_histograms.end())
+    {
+        LATENCY_HISTOGRAM histogram;
+        memset(&histogram, 0, sizeof(histogram));
+        item = m_histograms.insert(std::make_pair(message_type, histogram)).first;
+    }
+
+    LATENCY_HISTOGRAM& histogram = item->second;
+    histogram.count++;
+    histogram.buckets[bucketOf(latency_usec)]++;
+    if (latency_usec > histogram.max_usec) histogram.max_usec = latency_usec;
+
+    m_recorded++;
+}
+
+
+std::map<int, uavos::comm::LATENCY_SUMMARY> uavos::comm::CMessageLatency::getSummary ()
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    std::map<int, LATENCY_SUMMARY> summary;
+    for (const auto& item : m_histograms)
+    {
+        const LATENCY_HISTOGRAM& histogram = item.second;
+        summary[item.first] = {histogram.count, percentileOf(histogram, 50), percentileOf(histogram, 99), histogram.max_usec};
+    }
+
+    return summary;
+}
+
+
+void uavos::comm::CMessageLatency::logSummary (const bool only_if_changed)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        if ((only_if_changed) && (m_recorded == m_recorded_last_log)) return ;
+        m_recorded_last_log = m_recorded;
+    }
+
+    const std::map<int, LATENCY_SUMMARY> summary = getSummary();
+    for (const auto& item : summary)
+    {
+        PLOG(plog::info) << "Latency mt:" << item.first << " count:" << item.second.count
+                        << " p50(us):" << item.second.p50_usec << " p99(us):" << item.second.p99_usec
+                        << " max(us):" << item.second.max_usec;
+
+        #ifdef DEBUG
+            std::cout << _LOG_CONSOLE_TEXT << "Latency mt:" << item.first << " count:" << item.second.count
+                        << " p50(us):" << item.second.p50_usec << " p99(us):" << item.second.p99_usec
+                        << " max(us):" << item.second.max_usec << _NORMAL_CONSOLE_TEXT_ << std::endl;
+        #endif
+    }
+}
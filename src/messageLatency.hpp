@@ -0,0 +1,128 @@
+#ifndef CMESSAGELATENCY_H
+
+#define CMESSAGELATENCY_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+
+// bucket i holds latencies in [2^i, 2^(i+1)) microseconds. last bucket holds anything larger.
+#define LATENCY_HISTOGRAM_BUCKETS 32
+
+
+namespace uavos
+{
+namespace comm
+{
+
+/**
+ * @brief log2 histogram of ingress-to-egress time of one message type.
+ *
+ */
+typedef struct
+{
+    uint64_t count;
+    uint64_t max_usec;
+    uint64_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+} LATENCY_HISTOGRAM;
+
+
+/**
+ * @brief percentiles of a @link LATENCY_HISTOGRAM @endlink.
+ * @details p50 & p99 are upper bounds of their buckets so they are accurate to a factor of 2.
+ *
+ */
+typedef struct
+{
+    uint64_t count;
+    uint64_t p50_usec;
+    uint64_t p99_usec;
+    uint64_t max_usec;
+} LATENCY_SUMMARY;
+
+
+/**
+ * @brief current time in CLOCK_REALTIME nanoseconds. same clock as SO_TIMESTAMPNS.
+ */
+uint64_t get_time_realtime_nsec ();
+
+
+/**
+ * @brief Measures time from kernel receive of a module message till it is written to Andruav server.
+ * @details a message is handled from receive to websocket write in the same receiver thread.
+ * @link CMessageLatency::CScope @endlink marks the message being handled by this thread
+ * and the first websocket write within the scope is recorded against its message type.
+ *
+ */
+class CMessageLatency
+{
+    public:
+        //https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+        static CMessageLatency& getInstance()
+        {
+            static CMessageLatency instance;
+
+            return instance;
+        }
+
+        CMessageLatency(CMessageLatency const&)        = delete;
+        void operator=(CMessageLatency const&)         = delete;
+
+    private:
+
+        CMessageLatency()
+        {
+
+        }
+
+    public:
+
+        /**
+         * @brief marks message handled by calling thread for its lifetime.
+         *
+         */
+        class CScope
+        {
+            public:
+                /**
+                 * @param ingress_nsec kernel receive time. 0 means unknown and nothing is recorded.
+                 */
+                explicit CScope (const uint64_t ingress_nsec);
+                ~CScope ();
+
+                CScope(CScope const&)           = delete;
+                void operator=(CScope const&)   = delete;
+
+                void setMessageType (const int message_type);
+        };
+
+        /**
+         * @brief called on websocket write. no-op outside a @link CScope @endlink or if already recorded.
+         *
+         */
+        void recordEgress ();
+
+        void record (const int message_type, const uint64_t latency_usec);
+
+        std::map<int, LATENCY_SUMMARY> getSummary ();
+
+        /**
+         * @brief write summary of each message type to log.
+         *
+         * @param only_if_changed skip if nothing has been recorded since last call.
+         */
+        void logSummary (const bool only_if_changed);
+
+    private:
+
+        std::map<int, LATENCY_HISTOGRAM> m_histograms;
+        uint64_t m_recorded = 0;
+        uint64_t m_recorded_last_log = 0;
+        std::mutex m_lock;
+};
+
+}
+}
+
+#endif
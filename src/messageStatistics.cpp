@@ -0,0 +1,302 @@
+#include <iostream>
+#include <algorithm>
+
+#include "./helpers/colors.hpp"
+#include "./helpers/helpers.hpp"
+#include "messageStatistics.hpp"
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+
+namespace
+{
+    /**
+     * @brief message handled by current thread.
+     */
+    typedef struct
+    {
+        int message_type;
+        int module_index;
+        bool active;
+    } STATS_CONTEXT;
+
+    thread_local STATS_CONTEXT stats_context = {STATS_OTHER_MESSAGE_TYPE, 0, false};
+
+
+    /**
+     * @brief only owner thread writes a counter so no read-modify-write is needed.
+     */
+    inline void increment (std::atomic<uint64_t>& counter, const uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+
+    inline int validModuleIndex (const int module_index)
+    {
+        return ((module_index > 0) && (module_index < STATS_MAX_MODULES)) ? module_index : 0;
+    }
+}
+
+
+uavos::comm::CMessageStatistics::CScope::CScope (const int message_type, const int module_index)
+{
+    stats_context.message_type  = message_type;
+    stats_context.module_index  = validModuleIndex(module_index);
+    stats_context.active        = true;
+}
+
+
+uavos::comm::CMessageStatistics::CScope::~CScope ()
+{
+    stats_context.active = false;
+}
+
+
+void uavos::comm::CMessageStatistics::CScope::setMessageType (const int message_type)
+{
+    stats_context.message_type = message_type;
+}
+
+
+int uavos::comm::CMessageStatistics::registerModule (const std::string& module_id)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    if (m_module_ids.size() >= STATS_MAX_MODULES) return 0;
+
+    m_module_ids.push_back(module_id);
+
+    return m_module_ids.size() - 1;
+}
+
+
+std::string uavos::comm::CMessageStatistics::getModuleId (const int module_index)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    if ((module_index <= 0) || ((std::size_t) module_index >= m_module_ids.size())) return std::string();
+
+    return m_module_ids[module_index];
+}
+
+
+/**
+ * @brief shard of calling thread. created on first use.
+ *
+ */
+uavos::comm::CMessageStatistics::STATS_SHARD * uavos::comm::CMessageStatistics::getShard ()
+{
+    thread_local STATS_SHARD * shard = nullptr;
+
+    if (shard == nullptr)
+    {
+        // zero initialized. shards live till exit as threads counters are still needed after they end.
+        shard = new STATS_SHARD();
+
+        const std::lock_guard<std::mutex> lock(m_lock);
+        m_shards.push_back(std::unique_ptr<STATS_SHARD>(shard));
+    }
+
+    return shard;
+}
+
+
+/**
+ * @brief counters of a message type in a shard. slot is added if not found.
+ * @details negative types have no key as key 0 marks an empty slot. they are counted as STATS_OTHER_MESSAGE_TYPE.
+ *
+ */
+std::atomic<uint64_t> * uavos::comm::CMessageStatistics::getMessageTypeCounters (STATS_SHARD * shard, const int message_type)
+{
+    if (message_type < 0) return shard->other_message_types;
+
+    const int key = message_type + 1;
+    unsigned int slot = ((unsigned int) key) % STATS_MESSAGE_TYPE_SLOTS;
+
+    for (unsigned int i=0; i<STATS_MESSAGE_TYPE_SLOTS; ++i)
+    {
+        const int slot_key = shard->message_type_keys[slot].load(std::memory_order_relaxed);
+        if (slot_key == key)
+        {
+            return shard->message_types[slot];
+        }
+
+        if (slot_key == 0)
+        {
+            // counters are zero. key is published after them.
+            shard->message_type_keys[slot].store(key, std::memory_order_release);
+            return shard->message_types[slot];
+        }
+
+        slot = (slot + 1) % STATS_MESSAGE_TYPE_SLOTS;
+    }
+
+    return shard->other_message_types;
+}
+
+
+void uavos::comm::CMessageStatistics::countReceived (const int message_type, const int module_index, const std::size_t bytes)
+{
+    STATS_SHARD * shard = getShard();
+
+    std::atomic<uint64_t> * module_counters = shard->modules[validModuleIndex(module_index)];
+    increment(module_counters[STATS_RX_MESSAGES], 1);
+    increment(module_counters[STATS_RX_BYTES], bytes);
+
+    std::atomic<uint64_t> * message_type_counters = getMessageTypeCounters(shard, message_type);
+    increment(message_type_counters[STATS_RX_MESSAGES], 1);
+    increment(message_type_counters[STATS_RX_BYTES], bytes);
+}
+
+
+void uavos::comm::CMessageStatistics::countSent (const int message_type, const int module_index, const std::size_t bytes)
+{
+    STATS_SHARD * shard = getShard();
+
+    std::atomic<uint64_t> * module_counters = shard->modules[validModuleIndex(module_index)];
+    increment(module_counters[STATS_TX_MESSAGES], 1);
+    increment(module_counters[STATS_TX_BYTES], bytes);
+
+    std::atomic<uint64_t> * message_type_counters = getMessageTypeCounters(shard, message_type);
+    increment(message_type_counters[STATS_TX_MESSAGES], 1);
+    increment(message_type_counters[STATS_TX_BYTES], bytes);
+}
+
+
+void uavos::comm::CMessageStatistics::countParseError (const int module_index)
+{
+    STATS_SHARD * shard = getShard();
+
+    increment(shard->modules[validModuleIndex(module_index)][STATS_PARSE_ERRORS], 1);
+}
+
+
+void uavos::comm::CMessageStatistics::countUplink (const std::size_t bytes)
+{
+    STATS_SHARD * shard = getShard();
+
+    const int module_index = stats_context.active ? stats_context.module_index : 0;
+    const int message_type = stats_context.active ? stats_context.message_type : STATS_OTHER_MESSAGE_TYPE;
+
+    std::atomic<uint64_t> * module_counters = shard->modules[module_index];
+    increment(module_counters[STATS_UPLINK_MESSAGES], 1);
+    increment(module_counters[STATS_UPLINK_BYTES], bytes);
+
+    std::atomic<uint64_t> * message_type_counters = getMessageTypeCounters(shard, message_type);
+    increment(message_type_counters[STATS_UPLINK_MESSAGES], 1);
+    increment(message_type_counters[STATS_UPLINK_BYTES], bytes);
+}
+
+
+void uavos::comm::CMessageStatistics::countUplinkError ()
+{
+    increment(getShard()->uplink_write_errors, 1);
+}
+
+
+void uavos::comm::CMessageStatistics::takeSnapshot ()
+{
+    std::shared_ptr<TRAFFIC_SNAPSHOT> snapshot = std::make_shared<TRAFFIC_SNAPSHOT>();
+    snapshot->time_usec = get_time_usec();
+    snapshot->uplink_write_errors = 0;
+    for (int i=0; i<STATS_MAX_MODULES; ++i)
+    {
+        std::fill(std::begin(snapshot->modules[i].counters), std::end(snapshot->modules[i].counters), 0);
+    }
+
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    for (const auto& shard : m_shards)
+    {
+        for (int i=0; i<STATS_MAX_MODULES; ++i)
+        {
+            for (int c=0; c<STATS_COUNTER_COUNT; ++c)
+            {
+                snapshot->modules[i].counters[c] += shard->modules[i][c].load(std::memory_order_relaxed);
+            }
+        }
+
+        for (int slot=0; slot<STATS_MESSAGE_TYPE_SLOTS; ++slot)
+        {
+            const int key = shard->message_type_keys[slot].load(std::memory_order_acquire);
+            if (key == 0) continue;
+
+            TRAFFIC_COUNTERS& message_type_counters = snapshot->message_types[key - 1];
+            for (int c=0; c<STATS_COUNTER_COUNT; ++c)
+            {
+                message_type_counters.counters[c] += shard->message_types[slot][c].load(std::memory_order_relaxed);
+            }
+        }
+
+        bool other_counted = false;
+        TRAFFIC_COUNTERS other_counters = {};
+        for (int c=0; c<STATS_COUNTER_COUNT; ++c)
+        {
+            other_counters.counters[c] = shard->other_message_types[c].load(std::memory_order_relaxed);
+            other_counted |= (other_counters.counters[c] != 0);
+        }
+        if (other_counted)
+        {
+            TRAFFIC_COUNTERS& message_type_counters = snapshot->message_types[STATS_OTHER_MESSAGE_TYPE];
+            for (int c=0; c<STATS_COUNTER_COUNT; ++c)
+            {
+                message_type_counters.counters[c] += other_counters.counters[c];
+            }
+        }
+
+        snapshot->uplink_write_errors += shard->uplink_write_errors.load(std::memory_order_relaxed);
+    }
+
+    std::atomic_store(&m_previous_snapshot, std::atomic_load(&m_snapshot));
+    std::atomic_store(&m_snapshot, std::shared_ptr<const TRAFFIC_SNAPSHOT>(snapshot));
+}
+
+
+std::shared_ptr<const uavos::comm::TRAFFIC_SNAPSHOT> uavos::comm::CMessageStatistics::getSnapshot () const
+{
+    return std::atomic_load(&m_snapshot);
+}
+
+
+std::shared_ptr<const uavos::comm::TRAFFIC_SNAPSHOT> uavos::comm::CMessageStatistics::getPreviousSnapshot () const
+{
+    return std::atomic_load(&m_previous_snapshot);
+}
+
+
+void uavos::comm::CMessageStatistics::logSummary (const bool only_if_changed)
+{
+    const std::shared_ptr<const TRAFFIC_SNAPSHOT> snapshot = getSnapshot();
+    if (!snapshot) return ;
+
+    const std::shared_ptr<const TRAFFIC_SNAPSHOT> previous = getPreviousSnapshot();
+
+    // modules ordered by uplink bytes since previous snapshot.
+    std::vector<std::pair<uint64_t, int>> uplink;
+    for (int i=0; i<STATS_MAX_MODULES; ++i)
+    {
+        const uint64_t bytes = snapshot->modules[i].counters[STATS_UPLINK_BYTES]
+                            - (previous ? previous->modules[i].counters[STATS_UPLINK_BYTES] : 0);
+        if (bytes != 0) uplink.push_back(std::make_pair(bytes, i));
+    }
+
+    if ((only_if_changed) && (uplink.empty())) return ;
+
+    std::sort(uplink.rbegin(), uplink.rend());
+
+    const uint64_t interval_usec = previous ? (snapshot->time_usec - previous->time_usec) : 0;
+    for (const auto& item : uplink)
+    {
+        const std::string module_id = (item.second == 0) ? std::string("comm") : getModuleId(item.second);
+        const uint64_t rate = (interval_usec == 0) ? 0 : (item.first * 1000000 / interval_usec);
+
+        PLOG(plog::info) << "Uplink module:" << module_id << " bytes:" << item.first << " rate(B/s):" << rate
+                        << " parse errors:" << snapshot->modules[item.second].counters[STATS_PARSE_ERRORS];
+
+        #ifdef DEBUG
+            std::cout << _LOG_CONSOLE_TEXT << "Uplink module:" << module_id << " bytes:" << item.first << " rate(B/s):" << rate << _NORMAL_CONSOLE_TEXT_ << std::endl;
+        #endif
+    }
+}
@@ -0,0 +1,174 @@
+#ifndef CMESSAGESTATISTICS_H
+
+#define CMESSAGESTATISTICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// modules with statistics. index 0 is communicator itself, unknown senders & modules beyond this limit.
+#define STATS_MAX_MODULES               64
+// message types counted per thread. types beyond this limit are counted as STATS_OTHER_MESSAGE_TYPE.
+#define STATS_MESSAGE_TYPE_SLOTS        512
+#define STATS_OTHER_MESSAGE_TYPE        -1
+
+
+namespace uavos
+{
+namespace comm
+{
+
+enum ENUM_STATS_COUNTER
+{
+    // received from modules.
+    STATS_RX_MESSAGES       = 0,
+    STATS_RX_BYTES          = 1,
+    // sent to modules.
+    STATS_TX_MESSAGES       = 2,
+    STATS_TX_BYTES          = 3,
+    // written to Andruav server.
+    STATS_UPLINK_MESSAGES   = 4,
+    STATS_UPLINK_BYTES      = 5,
+    // received messages that could not be parsed.
+    STATS_PARSE_ERRORS      = 6,
+    STATS_COUNTER_COUNT     = 7
+};
+
+
+typedef struct
+{
+    uint64_t counters[STATS_COUNTER_COUNT];
+} TRAFFIC_COUNTERS;
+
+
+/**
+ * @brief sum of all threads counters at a point of time.
+ *
+ */
+typedef struct
+{
+    uint64_t time_usec;
+    TRAFFIC_COUNTERS modules[STATS_MAX_MODULES];
+    std::map<int, TRAFFIC_COUNTERS> message_types;
+    uint64_t uplink_write_errors;
+} TRAFFIC_SNAPSHOT;
+
+
+/**
+ * @brief Counts messages, bytes & parse errors per module and per message type.
+ * @details each thread counts in its own shard without locks or atomic read-modify-write.
+ * shards are summed only when a snapshot is taken.
+ * websocket writes are counted against module & message type marked by @link CMessageStatistics::CScope @endlink
+ * of the writing thread.
+ *
+ */
+class CMessageStatistics
+{
+    public:
+        //https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+        static CMessageStatistics& getInstance()
+        {
+            static CMessageStatistics instance;
+
+            return instance;
+        }
+
+        CMessageStatistics(CMessageStatistics const&)      = delete;
+        void operator=(CMessageStatistics const&)          = delete;
+
+    private:
+
+        CMessageStatistics()
+        {
+
+        }
+
+    public:
+
+        /**
+         * @brief marks message handled by calling thread for its lifetime.
+         *
+         */
+        class CScope
+        {
+            public:
+                CScope (const int message_type, const int module_index);
+                ~CScope ();
+
+                CScope(CScope const&)           = delete;
+                void operator=(CScope const&)   = delete;
+
+                void setMessageType (const int message_type);
+        };
+
+        /**
+         * @brief reserve statistics of a module.
+         *
+         * @param module_id
+         * @return index of module. 0 if limit is reached.
+         */
+        int registerModule (const std::string& module_id);
+
+        void countReceived (const int message_type, const int module_index, const std::size_t bytes);
+        void countSent (const int message_type, const int module_index, const std::size_t bytes);
+        void countParseError (const int module_index);
+
+        /**
+         * @brief called on websocket write. counted against current @link CScope @endlink if any.
+         *
+         */
+        void countUplink (const std::size_t bytes);
+        void countUplinkError ();
+
+        /**
+         * @brief sum counters of all threads. previous snapshot is kept to calculate rates.
+         *
+         */
+        void takeSnapshot ();
+
+        std::shared_ptr<const TRAFFIC_SNAPSHOT> getSnapshot () const;
+        std::shared_ptr<const TRAFFIC_SNAPSHOT> getPreviousSnapshot () const;
+
+        std::string getModuleId (const int module_index);
+
+        /**
+         * @brief write uplink usage of each module since previous snapshot to log.
+         *
+         * @param only_if_changed skip if nothing has been written to server.
+         */
+        void logSummary (const bool only_if_changed);
+
+    private:
+
+        typedef struct
+        {
+            std::atomic<uint64_t> modules[STATS_MAX_MODULES][STATS_COUNTER_COUNT];
+            // message type + 1. 0 means empty slot.
+            std::atomic<int> message_type_keys[STATS_MESSAGE_TYPE_SLOTS];
+            std::atomic<uint64_t> message_types[STATS_MESSAGE_TYPE_SLOTS][STATS_COUNTER_COUNT];
+            // STATS_OTHER_MESSAGE_TYPE & types that do not fit in message_types.
+            std::atomic<uint64_t> other_message_types[STATS_COUNTER_COUNT];
+            std::atomic<uint64_t> uplink_write_errors;
+        } STATS_SHARD;
+
+        STATS_SHARD * getShard ();
+        std::atomic<uint64_t> * getMessageTypeCounters (STATS_SHARD * shard, const int message_type);
+
+    private:
+
+        std::vector<std::unique_ptr<STATS_SHARD>> m_shards;
+        std::vector<std::string> m_module_ids = {std::string()};
+        std::shared_ptr<const TRAFFIC_SNAPSHOT> m_snapshot;
+        std::shared_ptr<const TRAFFIC_SNAPSHOT> m_previous_snapshot;
+        std::mutex m_lock;
+};
+
+}
+}
+
+#endif
@@ -5,6 +5,7 @@
  * @brief CMD_TYPE_INTERMODULE is used when you want to send a message from a  module to another.
  * This is mainly used to emulate a message comes from an external gcs to a module but is created by another module.
  * i.e. FCB module can emulate take_image even comes from gcs to camera module.
+ * Such messages are delivered by communicator to subscribed modules directly and are not sent to server.
  * Even if you do not use CMD_TYPE_INTERMODULE and uses a command id that is for inter-module commands such as id > 9500 
  * then it will be handled by communicator module such as TYPE_AndruavModule_RemoteExecute.
  */
@@ -24,6 +25,18 @@
 #define JSON_INTERMODULE_VERSION                "v"
 #define JSON_INTERMODULE_TIMESTAMP_INSTANCE     "u"
 #define JSON_INTERMODULE_RESEND                 "z"
+// highest message frame version supported by sender. @see FRAME_HEADER
+#define JSON_INTERMODULE_FRAME_VERSION          "fr"
+// multicast groups of message types [{"mt", "a", "p"}] announced by communicator.
+#define JSON_INTERMODULE_MULTICAST_GROUPS       "mc"
+// message types whose multicast groups module has joined.
+#define JSON_INTERMODULE_MULTICAST_JOINED       "mj"
+// envelope field of a module request. replies delivered to requesting module carry the same value.
+#define JSON_INTERMODULE_CORRELATION_ID         "ci"
+
+// JSON_INTERMODULE_MODULE_MESSAGES_LIST entries are message types, ranges "first-last" or wildcard.
+#define INTERMODULE_MESSAGES_WILDCARD           "*"
+#define INTERMODULE_MESSAGES_RANGE_SEPARATOR    '-'
 
 
 
@@ -80,6 +93,14 @@
 #define ANDRUAV_PROTOCOL_MESSAGE_CMD    "ms"
 #define INTERMODULE_ROUTING_TYPE        "ty"
 #define INTERMODULE_MODULE_KEY          "GU"
+// [optional] binary part is stored in a shared memory ring of the sender module. @see CShmRing
+#define INTERMODULE_SHM_DESCRIPTOR      "shm"
+
+// Shared Memory Descriptor Fields
+#define SHM_DESCRIPTOR_RING_NAME        "n"
+#define SHM_DESCRIPTOR_POSITION         "o"
+#define SHM_DESCRIPTOR_LENGTH           "l"
+#define SHM_DESCRIPTOR_SEQUENCE         "q"
 
 
 // System Messages
@@ -96,6 +117,7 @@
 #define TYPE_AndruavModule_ID                   9100
 #define TYPE_AndruavModule_RemoteExecute        9101
 #define TYPE_AndruavModule_Location_Info        9102
+#define TYPE_AndruavModule_Statistics           9103
 
 
 // Andruav Messages
@@ -0,0 +1,173 @@
+#include <iostream>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "./helpers/colors.hpp"
+#include "shmRing.hpp"
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+
+uavos::comm::CShmRing::CShmRing()
+{
+
+}
+
+
+uavos::comm::CShmRing::~CShmRing()
+{
+    close();
+}
+
+
+bool uavos::comm::CShmRing::open (const std::string& name)
+{
+    close();
+
+    m_fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (m_fd < 0)
+    {
+        PLOG(plog::error) << "CShmRing::open shm_open failed name:" << name << " errno:" << errno;
+        return false;
+    }
+
+    struct stat st;
+    if ((fstat(m_fd, &st) < 0) || (st.st_size < (off_t) SHM_RING_DATA_OFFSET))
+    {
+        PLOG(plog::error) << "CShmRing::open bad size name:" << name;
+        close();
+        return false;
+    }
+
+    m_map_size = st.st_size;
+    m_device = st.st_dev;
+    m_inode = st.st_ino;
+    m_map = mmap(NULL, m_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (m_map == MAP_FAILED)
+    {
+        m_map = nullptr;
+        PLOG(plog::error) << "CShmRing::open mmap failed name:" << name << " errno:" << errno;
+        close();
+        return false;
+    }
+
+    m_header = (SHM_RING_HEADER *) m_map;
+    if ((m_header->magic != SHM_RING_MAGIC)
+        || (m_header->version != SHM_RING_VERSION)
+        || (m_header->capacity == 0)
+        || (m_header->capacity > m_map_size - SHM_RING_DATA_OFFSET))
+    {
+        PLOG(plog::error) << "CShmRing::open bad header name:" << name;
+        close();
+        return false;
+    }
+
+    // capacity is copied as it is used to validate descriptors.
+    m_capacity = m_header->capacity;
+    m_data = (const char *) m_map + SHM_RING_DATA_OFFSET;
+    m_name = name;
+    m_first_sequence = true;
+
+    #ifdef DEBUG
+        std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: CShmRing mapped " << name << " capacity:" << m_capacity << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    #endif
+
+    return true;
+}
+
+
+void uavos::comm::CShmRing::close ()
+{
+    if (m_map != nullptr)
+    {
+        munmap(m_map, m_map_size);
+        m_map = nullptr;
+    }
+
+    if (m_fd != -1)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    m_header = nullptr;
+    m_data = nullptr;
+    m_map_size = 0;
+    m_capacity = 0;
+    m_device = 0;
+    m_inode = 0;
+}
+
+
+const char * uavos::comm::CShmRing::acquire (const uint64_t position, const uint64_t length) const
+{
+    if (m_header == nullptr) return NULL;
+
+    // payload must fit in ring without wrapping.
+    if ((length == 0) || (length > m_capacity)) return NULL;
+    const uint64_t index = position % m_capacity;
+    if (index + length > m_capacity) return NULL;
+
+    // payload must be written already and not released before.
+    const uint64_t write_pos = m_header->write_pos.load(std::memory_order_acquire);
+    const uint64_t read_pos  = m_header->read_pos.load(std::memory_order_acquire);
+    if ((position + length > write_pos) || (position < read_pos)) return NULL;
+
+    return &m_data[index];
+}
+
+
+void uavos::comm::CShmRing::release (const uint64_t position, const uint64_t length)
+{
+    if (m_header == nullptr) return ;
+
+    const uint64_t end = position + length;
+    uint64_t read_pos = m_header->read_pos.load(std::memory_order_relaxed);
+    while ((read_pos < end)
+        && (!m_header->read_pos.compare_exchange_weak(read_pos, end, std::memory_order_release, std::memory_order_relaxed)))
+    {
+    }
+}
+
+
+uint64_t uavos::comm::CShmRing::checkSequence (const uint64_t sequence)
+{
+    uint64_t missed = 0;
+    if ((!m_first_sequence) && (sequence > m_last_sequence + 1))
+    {
+        missed = sequence - m_last_sequence - 1;
+    }
+
+    m_first_sequence = false;
+    m_last_sequence = sequence;
+
+    return missed;
+}
+
+
+bool uavos::comm::CShmRing::isTruncated () const
+{
+    if (m_fd == -1) return true;
+
+    struct stat st;
+    if (fstat(m_fd, &st) < 0) return true;
+
+    return (st.st_size < (off_t) m_map_size);
+}
+
+
+bool uavos::comm::CShmRing::isReplaced () const
+{
+    const int fd = shm_open(m_name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return true;
+
+    struct stat st;
+    const bool replaced = (fstat(fd, &st) < 0) || (st.st_dev != m_device) || (st.st_ino != m_inode);
+    ::close(fd);
+
+    return replaced;
+}
@@ -0,0 +1,134 @@
+#ifndef CSHMRING_H
+
+#define CSHMRING_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <sys/types.h>
+
+
+// 'D','E','S','R'
+#define SHM_RING_MAGIC      0x52534544
+#define SHM_RING_VERSION    1
+
+// data area starts after header aligned to cache line.
+#define SHM_RING_DATA_OFFSET 64
+
+
+namespace uavos
+{
+namespace comm
+{
+
+/**
+ * @brief header at the start of a shared memory ring.
+ * @details ring is created & owned by producer module (e.g. camera) using shm_open.
+ *
+ * * write_pos & read_pos are absolute byte counters that never wrap.
+ * * payload of absolute position pos is stored at data[pos % capacity] and is always contiguous.
+ *   producer skips the tail of the ring if payload does not fit before the end.
+ * * producer writes payload, advances write_pos then sends a descriptor to communicator.
+ * * communicator advances read_pos after payload is sent. producer must never write beyond read_pos + capacity.
+ *
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    std::atomic<uint64_t> write_pos;
+    std::atomic<uint64_t> read_pos;
+} SHM_RING_HEADER;
+
+
+/**
+ * @brief Consumer side of a shared memory ring.
+ * @details binary payloads such as images are passed by descriptor {offset, length, sequence}
+ * and are sent directly from the mapped memory without copying.
+ *
+ */
+class CShmRing
+{
+    public:
+
+        CShmRing();
+        ~CShmRing();
+
+        CShmRing(CShmRing const&)            = delete;
+        void operator=(CShmRing const&)      = delete;
+
+    public:
+
+        /**
+         * @brief map an existing ring created by producer.
+         *
+         * @param name shm object name e.g. "/de_camera_1"
+         * @return true if mapped and header is valid.
+         */
+        bool open (const std::string& name);
+        void close ();
+
+        /**
+         * @brief get pointer to payload inside ring.
+         *
+         * @param position absolute position of payload.
+         * @param length
+         * @return const char* NULL if descriptor is invalid or payload is not written yet.
+         */
+        const char * acquire (const uint64_t position, const uint64_t length) const;
+
+        /**
+         * @brief mark payload as consumed so producer can reuse its space.
+         * @details read_pos only moves forward so a lost descriptor is released by the next one.
+         *
+         * @param position
+         * @param length
+         */
+        void release (const uint64_t position, const uint64_t length);
+
+        /**
+         * @brief track descriptor sequence numbers.
+         *
+         * @param sequence
+         * @return uint64_t number of descriptors missed before this one.
+         */
+        uint64_t checkSequence (const uint64_t sequence);
+
+        /**
+         * @brief shm object has been truncated below mapped size. 
+         * @details accessing mapping then raises SIGBUS so ring should be opened again before use.
+         *
+         */
+        bool isTruncated () const;
+
+        /**
+         * @brief ring name refers to another shm object or to none. e.g. producer module restarted.
+         * @details costs shm_open & fstat so it is checked only when a descriptor is rejected.
+         *
+         */
+        bool isReplaced () const;
+
+        const std::string& getName () const { return m_name; }
+
+    private:
+
+        std::string m_name;
+        int m_fd = -1;
+        void * m_map = nullptr;
+        std::size_t m_map_size = 0;
+        // identity of mapped shm object.
+        dev_t m_device = 0;
+        ino_t m_inode = 0;
+        SHM_RING_HEADER * m_header = nullptr;
+        const char * m_data = nullptr;
+        uint64_t m_capacity = 0;
+
+        bool m_first_sequence = true;
+        uint64_t m_last_sequence = 0;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <ctime>
+#include <stdio.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+#include "../helpers/colors.hpp"
+#include "../helpers/helpers.hpp"
+#include "uavos_license_cache.hpp"
+
+
+using namespace uavos;
+
+
+namespace
+{
+    std::string entryKey (const std::string& hardware_serial, const int hardware_type)
+    {
+        return std::to_string(hardware_type) + ":" + hardware_serial;
+    }
+
+
+    uint64_t timeNowSec ()
+    {
+        return (uint64_t) std::time(nullptr);
+    }
+}
+
+
+void CLicenseVerdictCache::init (const std::string& file_path, const std::string& secret, const uint64_t ttl_sec)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    m_file_path = file_path;
+    m_secret = secret;
+    m_ttl_sec = ttl_sec;
+    m_enabled = (ttl_sec != 0);
+    m_verdicts.clear();
+
+    if (!m_enabled) return ;
+
+    readFile();
+}
+
+
+bool CLicenseVerdictCache::getVerdict (const std::string& hardware_serial, const int hardware_type, bool& stale)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    if (!m_enabled) return false;
+
+    auto entry = m_verdicts.find(entryKey(hardware_serial, hardware_type));
+    if (entry == m_verdicts.end()) return false;
+
+    const LICENSE_VERDICT& verdict = entry->second;
+    const uint64_t now = timeNowSec();
+    if (now < verdict.verified_at)
+    {
+        // clock is behind e.g. no RTC & NTP not synced yet. use it but check it again.
+        stale = true;
+        return true;
+    }
+
+    const uint64_t age = now - verdict.verified_at;
+    if (age > m_ttl_sec) return false;
+
+    stale = (age > m_ttl_sec / 2);
+
+    return true;
+}
+
+
+void CLicenseVerdictCache::setVerdict (const std::string& hardware_serial, const int hardware_type, const bool valid)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    if (!m_enabled) return ;
+
+    const std::string entry_key = entryKey(hardware_serial, hardware_type);
+    if (valid)
+    {
+        m_verdicts[entry_key] = {true, timeNowSec()};
+    }
+    else
+    {
+        if (m_verdicts.erase(entry_key) == 0) return ;
+    }
+
+    writeFile();
+}
+
+
+std::string CLicenseVerdictCache::signEntry (const std::string& entry_key, const LICENSE_VERDICT& verdict) const
+{
+    const std::string data = entry_key + "|" + (verdict.valid ? "1" : "0") + "|" + std::to_string(verdict.verified_at);
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_length = 0;
+    if (HMAC(EVP_sha256(), m_secret.c_str(), (int) m_secret.length(),
+            (const unsigned char *) data.c_str(), data.length(), digest, &digest_length) == NULL)
+    {
+        return std::string();
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    std::string signature;
+    signature.reserve(digest_length * 2);
+    for (unsigned int i=0; i<digest_length; ++i)
+    {
+        signature.push_back(hex[digest[i] >> 4]);
+        signature.push_back(hex[digest[i] & 0x0f]);
+    }
+
+    return signature;
+}
+
+
+/**
+ * @brief load entries. entries with bad signature, expired or rejected by older versions are dropped.
+ *
+ */
+void CLicenseVerdictCache::readFile ()
+{
+    std::ifstream stream(m_file_path, std::ifstream::in);
+    if (!stream) return ;
+
+    std::stringstream contents;
+    contents << stream.rdbuf();
+
+    Json cache;
+    try
+    {
+        cache = Json::parse(contents.str());
+    }
+    catch (const std::exception& e)
+    {
+        PLOG(plog::warning) << "License cache " << m_file_path << " is corrupted: " << e.what();
+        return ;
+    }
+
+    if (!validateField(cache, "e", Json::value_t::array)) return ;
+
+    const uint64_t now = timeNowSec();
+    std::size_t rejected = 0;
+    for (const Json& entry : cache["e"])
+    {
+        if ((!validateField(entry, "k", Json::value_t::string))
+            || (!validateField(entry, "v", Json::value_t::boolean))
+            || (!validateField(entry, "a", Json::value_t::number_unsigned))
+            || (!validateField(entry, "h", Json::value_t::string)))
+        {
+            rejected++;
+            continue;
+        }
+
+        const std::string entry_key = entry["k"].get<std::string>();
+        const LICENSE_VERDICT verdict = {entry["v"].get<bool>(), entry["a"].get<uint64_t>()};
+        const std::string signature = signEntry(entry_key, verdict);
+        const std::string& saved_signature = entry["h"].get_ref<const std::string&>();
+
+        if ((signature.empty()) || (signature.length() != saved_signature.length())
+            || (CRYPTO_memcmp(signature.c_str(), saved_signature.c_str(), signature.length()) != 0))
+        {
+            rejected++;
+            continue;
+        }
+
+        if (!verdict.valid) continue;
+        if ((verdict.verified_at <= now) && (now - verdict.verified_at > m_ttl_sec)) continue;
+
+        m_verdicts[entry_key] = verdict;
+    }
+
+    std::cout << _LOG_CONSOLE_TEXT << "License cache: " << _SUCCESS_CONSOLE_TEXT_ << m_verdicts.size() << " verdicts loaded" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    PLOG(plog::info) << "License cache " << m_file_path << " loaded:" << m_verdicts.size() << " rejected:" << rejected;
+}
+
+
+/**
+ * @brief file is replaced as a whole so a crash while writing does not corrupt it.
+ *
+ */
+void CLicenseVerdictCache::writeFile ()
+{
+    Json entries = Json::array();
+    for (const auto& verdict : m_verdicts)
+    {
+        entries.push_back(
+        {
+            {"k", verdict.first},
+            {"v", verdict.second.valid},
+            {"a", verdict.second.verified_at},
+            {"h", signEntry(verdict.first, verdict.second)}
+        });
+    }
+
+    const Json cache = {{"e", entries}};
+    const std::string temp_path = m_file_path + ".tmp";
+
+    std::ofstream stream(temp_path, std::ofstream::out | std::ios::trunc);
+    if (!stream)
+    {
+        PLOG(plog::warning) << "License cache " << temp_path << " cannot be written";
+        return ;
+    }
+
+    stream << cache.dump();
+    stream.close();
+
+    if (rename(temp_path.c_str(), m_file_path.c_str()) != 0)
+    {
+        PLOG(plog::warning) << "License cache " << m_file_path << " cannot be replaced";
+    }
+}
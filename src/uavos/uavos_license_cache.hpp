@@ -0,0 +1,103 @@
+#ifndef UAVOS_LICENSE_CACHE_H_
+#define UAVOS_LICENSE_CACHE_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+
+// default age after which a cached verdict is not used.
+#define DEFAULT_LICENSE_CACHE_TTL_HOURS     72
+
+// file name of cache. it is stored in the same folder of local config file.
+#define LICENSE_CACHE_FILE_NAME             "de_comm.license"
+
+
+typedef struct
+{
+    bool valid;
+    // seconds since epoch when auth server gave this verdict.
+    uint64_t verified_at;
+} LICENSE_VERDICT;
+
+
+namespace uavos
+{
+    /**
+     * @brief Module licenses accepted by auth server saved on disk.
+     * @details a cached verdict is applied at once when a module registers so it does not wait for auth server.
+     * verdicts older than half TTL are applied and revalidated in background.
+     * rejections are not cached as a failed reply e.g. expired session cannot be told from a bad license.
+     * a module is rejected only by a reply of auth server.
+     * each entry is signed with HMAC-SHA256 so edited or copied entries are ignored.
+     *
+     */
+    class CLicenseVerdictCache
+    {
+        public:
+            //https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+            static CLicenseVerdictCache& getInstance()
+            {
+                static CLicenseVerdictCache instance;
+
+                return instance;
+            }
+
+            CLicenseVerdictCache(CLicenseVerdictCache const&)           = delete;
+            void operator=(CLicenseVerdictCache const&)                 = delete;
+
+        private:
+
+            CLicenseVerdictCache() {};
+
+        public:
+
+            /**
+             * @brief load cache file. cache is disabled till this is called.
+             *
+             * @param file_path
+             * @param secret key of entries signature. unique per unit.
+             * @param ttl_sec 0 disables cache.
+             */
+            void init (const std::string& file_path, const std::string& secret, const uint64_t ttl_sec);
+
+            /**
+             * @brief check if a hardware serial has been accepted and its verdict is not expired.
+             *
+             * @param hardware_serial
+             * @param hardware_type
+             * @param stale true if verdict should be revalidated.
+             * @return false if no usable verdict.
+             */
+            bool getVerdict (const std::string& hardware_serial, const int hardware_type, bool& stale);
+
+            /**
+             * @brief save a verdict received from auth server. a rejection removes cached verdict.
+             *
+             * @param hardware_serial
+             * @param hardware_type
+             * @param valid
+             */
+            void setVerdict (const std::string& hardware_serial, const int hardware_type, const bool valid);
+
+        private:
+
+            std::string signEntry (const std::string& entry_key, const LICENSE_VERDICT& verdict) const;
+            void readFile ();
+            void writeFile ();
+
+        private:
+
+            bool m_enabled = false;
+            std::string m_file_path;
+            std::string m_secret;
+            uint64_t m_ttl_sec = 0;
+
+            // verdicts mapped by hardware type & serial.
+            std::map<std::string, LICENSE_VERDICT> m_verdicts;
+            std::mutex m_lock;
+    };
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include <iostream>
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+#include "../helpers/colors.hpp"
+#include "../comm_server/andruav_auth.hpp"
+#include "uavos_license_verifier.hpp"
+
+
+using namespace uavos;
+
+
+CModuleLicenseVerifier::~CModuleLicenseVerifier ()
+{
+    if (m_stopped_called == false)
+    {
+        stop();
+    }
+}
+
+
+void CModuleLicenseVerifier::setOnVerified (LICENSE_VERIFIED_CALLBACK on_verified)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+    m_on_verified = on_verified;
+}
+
+
+bool CModuleLicenseVerifier::requestVerification (const std::string& hardware_serial, const int hardware_type)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+
+        if (!m_in_flight.insert(hardware_serial).second) return false;
+
+        m_requests.push_back({hardware_serial, hardware_type});
+    }
+
+    m_wakeup.notify_one();
+
+    return true;
+}
+
+
+void CModuleLicenseVerifier::start ()
+{
+    if (m_started) return ;
+
+    m_started = true;
+    m_thread = std::thread {[&](){ verifierEntry(); }};
+}
+
+
+void CModuleLicenseVerifier::stop ()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        m_stopped_called = true;
+    }
+    m_wakeup.notify_one();
+
+    // a verification in progress is completed first.
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+
+/**
+ * @brief verifier thread.
+ * @details requests are verified one at a time in arrival order.
+ * if authentication is lost meanwhile the request is dropped and module stays not verified
+ * till it registers again.
+ *
+ */
+void CModuleLicenseVerifier::verifierEntry ()
+{
+    #ifdef DEBUG
+        std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: verifierEntry" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    #endif
+
+    andruav_servers::CAndruavAuthenticator &auth = andruav_servers::CAndruavAuthenticator::getInstance();
+
+    while (!m_stopped_called)
+    {
+        LICENSE_REQUEST request;
+        LICENSE_VERIFIED_CALLBACK on_verified;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_wakeup.wait(lock, [this]{ return (!m_requests.empty()) || m_stopped_called; });
+
+            if (m_stopped_called) break;
+
+            request = m_requests.front();
+            m_requests.pop_front();
+            on_verified = m_on_verified;
+        }
+
+        bool verified = false;
+        bool valid = false;
+        bool replied = false;
+        if (auth.isAuthenticationOK())
+        {
+            try
+            {
+                valid = auth.doValidateHardware(request.hardware_serial, request.hardware_type);
+                replied = auth.isHardwareReplyReceived();
+            }
+            catch (const std::exception& e)
+            {
+                // unreadable reply is treated as failed verification.
+                PLOG(plog::error)<< "Module License " << request.hardware_serial << " reply error: " << e.what();
+                valid = false;
+            }
+            verified = true;
+        }
+        else
+        {
+            PLOG(plog::warning)<< "Module License " << request.hardware_serial << " could not been verified";
+        }
+
+        if ((verified) && (on_verified))
+        {
+            on_verified(request.hardware_serial, request.hardware_type, valid, replied);
+        }
+
+        {
+            // serial can be requested again from now on.
+            const std::lock_guard<std::mutex> lock(m_lock);
+            m_in_flight.erase(request.hardware_serial);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef UAVOS_LICENSE_VERIFIER_H_
+#define UAVOS_LICENSE_VERIFIER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+
+/**
+ * @brief called from verifier thread when a hardware serial has been checked by auth server.
+ * @details replied is false when auth server could not be reached. valid is false then.
+ *
+ */
+typedef std::function<void(const std::string& hardware_serial, const int hardware_type, const bool valid, const bool replied)> LICENSE_VERIFIED_CALLBACK;
+
+
+typedef struct
+{
+    std::string hardware_serial;
+    int hardware_type;
+} LICENSE_REQUEST;
+
+
+namespace uavos
+{
+    /**
+     * @brief Verifies module licenses with auth server from a dedicated thread.
+     * @details verification is an https round trip that can take seconds on poor links.
+     * callers only queue requests so module traffic is not stalled meanwhile.
+     * a hardware serial is requested once while it is queued or being verified.
+     *
+     */
+    class CModuleLicenseVerifier
+    {
+        public:
+            //https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+            static CModuleLicenseVerifier& getInstance()
+            {
+                static CModuleLicenseVerifier instance;
+
+                return instance;
+            }
+
+            CModuleLicenseVerifier(CModuleLicenseVerifier const&)           = delete;
+            void operator=(CModuleLicenseVerifier const&)                   = delete;
+
+        private:
+
+            CModuleLicenseVerifier() {};
+
+        public:
+
+            ~CModuleLicenseVerifier ();
+
+            void setOnVerified (LICENSE_VERIFIED_CALLBACK on_verified);
+
+            /**
+             * @brief queue a hardware serial for verification.
+             *
+             * @param hardware_serial
+             * @param hardware_type
+             * @return false if the same serial is already waiting or being verified.
+             */
+            bool requestVerification (const std::string& hardware_serial, const int hardware_type);
+
+            void start ();
+            void stop ();
+
+        private:
+
+            void verifierEntry ();
+
+        private:
+
+            LICENSE_VERIFIED_CALLBACK m_on_verified;
+
+            std::deque<LICENSE_REQUEST> m_requests;
+            // serials queued or being verified.
+            std::set<std::string> m_in_flight;
+            std::mutex m_lock;
+            std::condition_variable m_wakeup;
+
+            std::thread m_thread;
+            std::atomic<bool> m_started = {false};
+            std::atomic<bool> m_stopped_called = {false};
+    };
+}
+
+#endif
@@ -0,0 +1,335 @@
+#include <cstring>
+
+#include "../helpers/helpers.hpp"
+#include "uavos_message_scanner.hpp"
+
+
+namespace
+{
+    // nesting limit of skipped values.
+    const int MAX_DEPTH = 128;
+
+
+    inline void skipWhiteSpace (const char *& p, const char * end)
+    {
+        while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n'))) ++p;
+    }
+
+
+    inline bool isDigit (const char c)
+    {
+        return (c >= '0') && (c <= '9');
+    }
+
+
+    inline bool isHexDigit (const char c)
+    {
+        return isDigit(c) || ((c >= 'a') && (c <= 'f')) || ((c >= 'A') && (c <= 'F'));
+    }
+
+
+    /**
+     * @brief p points to opening quote. on return p is after closing quote.
+     */
+    bool skipString (const char *& p, const char * end, bool& has_escape)
+    {
+        has_escape = false;
+        ++p;
+        while (p < end)
+        {
+            const unsigned char c = *p;
+            if (c == '"')
+            {
+                ++p;
+                return true;
+            }
+
+            if (c < 0x20)
+            {
+                // control characters should be escaped.
+                return false;
+            }
+
+            if (c == '\\')
+            {
+                has_escape = true;
+                ++p;
+                if (p >= end) return false;
+                switch (*p)
+                {
+                    case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                    break;
+
+                    case 'u':
+                        if ((end - p < 5) || (!isHexDigit(p[1])) || (!isHexDigit(p[2])) || (!isHexDigit(p[3])) || (!isHexDigit(p[4]))) return false;
+                        p += 4;
+                    break;
+
+                    default:
+                        return false;
+                }
+            }
+            ++p;
+        }
+
+        return false;
+    }
+
+
+    bool skipNumber (const char *& p, const char * end)
+    {
+        if ((p < end) && (*p == '-')) ++p;
+        if (p >= end) return false;
+
+        if (*p == '0')
+        {
+            ++p;
+        }
+        else if (isDigit(*p))
+        {
+            while ((p < end) && (isDigit(*p))) ++p;
+        }
+        else
+        {
+            return false;
+        }
+
+        if ((p < end) && (*p == '.'))
+        {
+            ++p;
+            if ((p >= end) || (!isDigit(*p))) return false;
+            while ((p < end) && (isDigit(*p))) ++p;
+        }
+
+        if ((p < end) && ((*p == 'e') || (*p == 'E')))
+        {
+            ++p;
+            if ((p < end) && ((*p == '+') || (*p == '-'))) ++p;
+            if ((p >= end) || (!isDigit(*p))) return false;
+            while ((p < end) && (isDigit(*p))) ++p;
+        }
+
+        return true;
+    }
+
+
+    bool skipLiteral (const char *& p, const char * end, const char * literal, const std::size_t literal_length)
+    {
+        if (((std::size_t) (end - p) < literal_length) || (memcmp(p, literal, literal_length) != 0)) return false;
+        p += literal_length;
+        return true;
+    }
+
+
+    /**
+     * @brief move p after the JSON value it points to. value is validated but nothing is built.
+     */
+    bool skipValue (const char *& p, const char * end, const int depth)
+    {
+        if (p >= end) return false;
+
+        bool has_escape;
+        switch (*p)
+        {
+            case '"':
+                return skipString(p, end, has_escape);
+
+            case '{':
+            case '[':
+            {
+                if (depth >= MAX_DEPTH) return false;
+
+                const bool is_object = (*p == '{');
+                const char close = is_object ? '}' : ']';
+                ++p;
+                skipWhiteSpace(p, end);
+                if ((p < end) && (*p == close))
+                {
+                    ++p;
+                    return true;
+                }
+
+                while (p < end)
+                {
+                    if (is_object)
+                    {
+                        if ((*p != '"') || (!skipString(p, end, has_escape))) return false;
+                        skipWhiteSpace(p, end);
+                        if ((p >= end) || (*p != ':')) return false;
+                        ++p;
+                        skipWhiteSpace(p, end);
+                    }
+
+                    if (!skipValue(p, end, depth + 1)) return false;
+                    skipWhiteSpace(p, end);
+                    if (p >= end) return false;
+
+                    if (*p == close)
+                    {
+                        ++p;
+                        return true;
+                    }
+                    if (*p != ',') return false;
+                    ++p;
+                    skipWhiteSpace(p, end);
+                }
+                return false;
+            }
+
+            case 't':
+                return skipLiteral(p, end, "true", 4);
+
+            case 'f':
+                return skipLiteral(p, end, "false", 5);
+
+            case 'n':
+                return skipLiteral(p, end, "null", 4);
+
+            default:
+                return skipNumber(p, end);
+        }
+    }
+
+
+    inline bool isKey (const char * key, const std::size_t key_length, const char * name)
+    {
+        return (strlen(name) == key_length) && (memcmp(key, name, key_length) == 0);
+    }
+
+
+    /**
+     * @brief value of a string field. escaped strings are rare and decoded by JSON parser.
+     */
+    bool readString (const char * value, const std::size_t value_length, std::string& out)
+    {
+        if ((value_length < 2) || (value[0] != '"')) return false;
+
+        if (memchr(value, '\\', value_length) == NULL)
+        {
+            out.assign(value + 1, value_length - 2);
+            return true;
+        }
+
+        try
+        {
+            out = Json::parse(value, value + value_length).get<std::string>();
+        }
+        catch (...)
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+
+    /**
+     * @brief value of an unsigned integer field.
+     * @return -1 if it is not an unsigned integer.
+     */
+    int readUnsigned (const char * value, const std::size_t value_length)
+    {
+        if ((value_length == 0) || (value_length > 9)) return -1;
+
+        int result = 0;
+        for (std::size_t i=0; i<value_length; ++i)
+        {
+            if ((value[i] < '0') || (value[i] > '9')) return -1;
+            result = result * 10 + (value[i] - '0');
+        }
+
+        return result;
+    }
+}
+
+
+bool uavos::scanIntermoduleHeader (const char * message, const std::size_t length, INTERMODULE_MESSAGE_HEADER& header)
+{
+    header.has_routing_type = false;
+    header.message_type     = -1;
+    header.has_target_id    = false;
+    header.has_module_key   = false;
+    header.ms               = NULL;
+    header.ms_length        = 0;
+    header.shm              = NULL;
+    header.shm_length       = 0;
+    header.json_length      = 0;
+
+    const char * end = message + length;
+    const char * p = message;
+
+    skipWhiteSpace(p, end);
+    if ((p >= end) || (*p != '{')) return false;
+    ++p;
+    skipWhiteSpace(p, end);
+
+    if ((p < end) && (*p == '}'))
+    {
+        header.json_length = p + 1 - message;
+        return true;
+    }
+
+    while (p < end)
+    {
+        if (*p != '"') return false;
+
+        const char * key = p + 1;
+        bool key_has_escape;
+        if (!skipString(p, end, key_has_escape)) return false;
+        const std::size_t key_length = p - 1 - key;
+
+        skipWhiteSpace(p, end);
+        if ((p >= end) || (*p != ':')) return false;
+        ++p;
+        skipWhiteSpace(p, end);
+
+        const char * value = p;
+        if (!skipValue(p, end, 1)) return false;
+        const std::size_t value_length = p - value;
+
+        if ((!key_has_escape) && (key_length <= 3))
+        {
+            if (isKey(key, key_length, INTERMODULE_ROUTING_TYPE))
+            {
+                header.has_routing_type = readString(value, value_length, header.routing_type);
+            }
+            else if (isKey(key, key_length, ANDRUAV_PROTOCOL_MESSAGE_TYPE))
+            {
+                header.message_type = readUnsigned(value, value_length);
+            }
+            else if (isKey(key, key_length, ANDRUAV_PROTOCOL_TARGET_ID))
+            {
+                header.has_target_id = readString(value, value_length, header.target_id);
+            }
+            else if (isKey(key, key_length, INTERMODULE_MODULE_KEY))
+            {
+                header.has_module_key = readString(value, value_length, header.module_key);
+            }
+            else if (isKey(key, key_length, ANDRUAV_PROTOCOL_MESSAGE_CMD))
+            {
+                header.ms = value;
+                header.ms_length = value_length;
+            }
+            else if (isKey(key, key_length, INTERMODULE_SHM_DESCRIPTOR))
+            {
+                header.shm = value;
+                header.shm_length = value_length;
+            }
+        }
+
+        skipWhiteSpace(p, end);
+        if (p >= end) return false;
+
+        if (*p == '}')
+        {
+            header.json_length = p + 1 - message;
+            return true;
+        }
+
+        if (*p != ',') return false;
+        ++p;
+        skipWhiteSpace(p, end);
+    }
+
+    return false;
+}
@@ -0,0 +1,80 @@
+#ifndef UAVOS_MESSAGE_SCANNER_H_
+#define UAVOS_MESSAGE_SCANNER_H_
+
+#include <cstddef>
+#include <string>
+
+#include "../messages.hpp"
+
+
+namespace uavos
+{
+
+/**
+ * @brief routing fields of an intermodule message.
+ * @details ms & shm are not parsed. they point to their JSON text inside the scanned message.
+ *
+ */
+typedef struct
+{
+    // "ty" if it is a string.
+    bool has_routing_type;
+    std::string routing_type;
+    // "mt" if it is an unsigned integer otherwise -1.
+    int message_type;
+    // "tg" if it is a string.
+    bool has_target_id;
+    std::string target_id;
+    // "GU" if it is a string.
+    bool has_module_key;
+    std::string module_key;
+    // "ms" JSON text. NULL if not found.
+    const char * ms;
+    std::size_t ms_length;
+    // "shm" JSON text. NULL if not found.
+    const char * shm;
+    std::size_t shm_length;
+    // length of JSON part. binary part if exists starts after it and its zero delimiter.
+    std::size_t json_length;
+} INTERMODULE_MESSAGE_HEADER;
+
+
+/**
+ * @brief read routing fields of a message without building a JSON DOM.
+ * @details other fields & nested values are validated and skipped without allocation
+ * so a message forwarded as text is always valid JSON.
+ * scan stops at the end of the top-level object so a binary part is never read.
+ *
+ * @param message
+ * @param length
+ * @param header
+ * @return false if message is not a well-formed JSON object.
+ */
+bool scanIntermoduleHeader (const char * message, const std::size_t length, INTERMODULE_MESSAGE_HEADER& header);
+
+
+/**
+ * @brief true for messages interpreted by communicator itself. other messages are only routed.
+ *
+ * @param message_type
+ */
+inline bool needsFullParse (const int message_type)
+{
+    switch (message_type)
+    {
+        case TYPE_AndruavModule_ID:
+        case TYPE_AndruavModule_RemoteExecute:
+        case TYPE_AndruavModule_Location_Info:
+        case TYPE_AndruavModule_Statistics:
+        case TYPE_AndruavMessage_ID:
+        case TYPE_AndruavMessage_IMG:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,310 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+#include <plog/Log.h>
+#include "plog/Initializers/RollingFileInitializer.h"
+
+#include "../helpers/colors.hpp"
+#include "uavos_module_dispatcher.hpp"
+
+
+using namespace uavos;
+
+
+CModuleOutboundQueue::CModuleOutboundQueue(const std::string& module_id, const SOCKET_ADDRESS& module_address, const std::size_t max_size, const ENUM_QUEUE_POLICY policy)
+    : m_module_id(module_id)
+    , m_module_address(module_address)
+    , m_max_size(max_size)
+    , m_policy(policy)
+{
+}
+
+
+bool CModuleOutboundQueue::push (std::shared_ptr<const std::string> message, const bool may_block)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    if (m_messages.size() >= m_max_size)
+    {
+        switch (m_policy)
+        {
+            case QUEUE_DROP_OLDEST:
+                m_messages.pop_front();
+                m_counters.dropped++;
+            break;
+
+            case QUEUE_DROP_NEWEST:
+                m_counters.dropped++;
+                return false;
+
+            case QUEUE_BLOCK:
+                if (!may_block)
+                {
+                    // caller holds a lock that other threads need.
+                    m_counters.dropped++;
+                    return false;
+                }
+                if (!m_space_available.wait_for(lock, std::chrono::milliseconds(MODULE_QUEUE_BLOCK_TIMEOUT_MS),
+                                    [this]{ return m_messages.size() < m_max_size; }))
+                {
+                    // module is not reading. do not hold caller forever.
+                    m_counters.dropped++;
+                    return false;
+                }
+            break;
+        }
+    }
+
+    m_messages.push_back(message);
+    m_counters.queued++;
+    if (m_messages.size() > m_counters.max_depth) m_counters.max_depth = m_messages.size();
+
+    return true;
+}
+
+
+void CModuleOutboundQueue::peek (std::vector<std::shared_ptr<const std::string>>& messages, const std::size_t max_count)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    const std::size_t count = std::min(max_count, m_messages.size());
+    for (std::size_t i=0; i<count; ++i)
+    {
+        messages.push_back(m_messages[i]);
+    }
+}
+
+
+void CModuleOutboundQueue::pop (const std::shared_ptr<const std::string> * messages, const std::size_t count, const std::size_t sent)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+
+        for (std::size_t i=0; i<count; ++i)
+        {
+            if ((!m_messages.empty()) && (m_messages.front() == messages[i]))
+            {
+                m_messages.pop_front();
+            }
+        }
+        m_counters.sent += sent;
+        m_counters.dropped += count - sent;
+    }
+
+    m_space_available.notify_all();
+}
+
+
+MODULE_QUEUE_COUNTERS CModuleOutboundQueue::getCounters ()
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    return m_counters;
+}
+
+
+CUavosModuleDispatcher::~CUavosModuleDispatcher ()
+{
+    if (m_stopped_called == false)
+    {
+        stop();
+    }
+}
+
+
+void CUavosModuleDispatcher::setQueueLimits (const std::size_t max_size, const ENUM_QUEUE_POLICY policy)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    m_queue_size = (max_size == 0) ? 1 : max_size;
+    m_queue_policy = policy;
+}
+
+
+std::shared_ptr<CModuleOutboundQueue> CUavosModuleDispatcher::createQueue (const std::string& module_id, const SOCKET_ADDRESS& module_address)
+{
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    std::shared_ptr<CModuleOutboundQueue> queue = std::make_shared<CModuleOutboundQueue>(module_id, module_address, m_queue_size, m_queue_policy);
+    m_queues.push_back(queue);
+
+    return queue;
+}
+
+
+void CUavosModuleDispatcher::removeQueue (const std::shared_ptr<CModuleOutboundQueue>& queue)
+{
+    if (!queue) return ;
+
+    const std::lock_guard<std::mutex> lock(m_lock);
+
+    auto queue_item = std::find(m_queues.begin(), m_queues.end(), queue);
+    if (queue_item == m_queues.end()) return ;
+
+    m_queues.erase(queue_item);
+
+    const MODULE_QUEUE_COUNTERS counters = queue->getCounters();
+    PLOG(plog::info) << "Module " << queue->getModuleId() << " queue removed queued:" << counters.queued
+                    << " sent:" << counters.sent << " dropped:" << counters.dropped
+                    << " max depth:" << counters.max_depth;
+}
+
+
+void CUavosModuleDispatcher::enqueue (const std::shared_ptr<CModuleOutboundQueue>& queue, std::shared_ptr<const std::string> message, const bool may_block)
+{
+    if (!queue) return ;
+
+    if (!queue->push(message, may_block)) return ;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        m_pending = true;
+    }
+
+    m_wakeup.notify_one();
+}
+
+
+void CUavosModuleDispatcher::start ()
+{
+    if (m_started) return ;
+
+    m_started = true;
+    m_thread = std::thread {[&](){ dispatcherEntry(); }};
+}
+
+
+void CUavosModuleDispatcher::stop ()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        m_stopped_called = true;
+    }
+    m_wakeup.notify_one();
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    const std::lock_guard<std::mutex> lock(m_lock);
+    for (const std::shared_ptr<CModuleOutboundQueue>& queue : m_queues)
+    {
+        const MODULE_QUEUE_COUNTERS counters = queue->getCounters();
+        PLOG(plog::info) << "Module " << queue->getModuleId() << " queue queued:" << counters.queued
+                        << " sent:" << counters.sent << " dropped:" << counters.dropped
+                        << " max depth:" << counters.max_depth;
+    }
+}
+
+
+/**
+ * @brief dispatcher thread.
+ * @details each round takes up to MODULE_QUEUE_BURST messages from head of every queue
+ * and sends them in one batch. messages that could not be sent stay at head so order is kept.
+ *
+ */
+void CUavosModuleDispatcher::dispatcherEntry ()
+{
+    #ifdef DEBUG
+        std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: dispatcherEntry" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    #endif
+
+    comm::CUDPCommunicator& udp_communicator = comm::CUDPCommunicator::getInstance();
+
+    std::vector<std::shared_ptr<CModuleOutboundQueue>> queues;
+    std::vector<std::shared_ptr<const std::string>> messages;
+    std::vector<std::size_t> queue_message_count;
+    std::vector<comm::OUTBOUND_DATAGRAM> datagrams;
+    bool busy = false;
+
+    while (!m_stopped_called)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            if (busy)
+            {
+                // sockets are full. retry soon even if nothing new is queued.
+                m_wakeup.wait_for(lock, std::chrono::milliseconds(MODULE_QUEUE_RETRY_MS));
+            }
+            else
+            {
+                m_wakeup.wait(lock, [this]{ return m_pending || m_stopped_called; });
+            }
+
+            m_pending = false;
+            queues = m_queues;
+        }
+
+        if (m_stopped_called) break;
+
+        messages.clear();
+        queue_message_count.clear();
+        for (const std::shared_ptr<CModuleOutboundQueue>& queue : queues)
+        {
+            const std::size_t before = messages.size();
+            queue->peek(messages, MODULE_QUEUE_BURST);
+            queue_message_count.push_back(messages.size() - before);
+        }
+
+        if (messages.empty())
+        {
+            busy = false;
+            continue;
+        }
+
+        datagrams.clear();
+        std::size_t index = 0;
+        for (std::size_t q=0; q<queues.size(); ++q)
+        {
+            for (std::size_t i=0; i<queue_message_count[q]; ++i)
+            {
+                const std::string& message = *messages[index++];
+                datagrams.push_back({message.c_str(), message.length(), queues[q]->getAddress(), 0});
+            }
+        }
+
+        udp_communicator.TrySendMany(datagrams);
+
+        // remove what has been handled. a message with result 0 stops its queue to keep order.
+        bool left_over = false;
+        busy = false;
+        index = 0;
+        for (std::size_t q=0; q<queues.size(); ++q)
+        {
+            const std::size_t first = index;
+            std::size_t handled = 0;
+            std::size_t sent = 0;
+            bool blocked = false;
+            for (std::size_t i=0; i<queue_message_count[q]; ++i)
+            {
+                const int result = datagrams[index++].result;
+                if (blocked) continue;
+                if (result == 0)
+                {
+                    blocked = true;
+                    continue;
+                }
+
+                handled++;
+                if (result == 1) sent++;
+            }
+
+            if (handled != 0) queues[q]->pop(&messages[first], handled, sent);
+            if (blocked) busy = true;
+            if (queue_message_count[q] == MODULE_QUEUE_BURST) left_over = true;
+        }
+
+        if ((left_over) && (!busy))
+        {
+            // more messages may be waiting behind the burst.
+            const std::lock_guard<std::mutex> lock(m_lock);
+            m_pending = true;
+        }
+    }
+
+    #ifdef DEBUG
+	std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: dispatcherEntry EXIT" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    #endif
+}
@@ -0,0 +1,191 @@
+#ifndef UAVOS_MODULE_DISPATCHER_H_
+#define UAVOS_MODULE_DISPATCHER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../udpCommunicator.hpp"
+
+
+// default max messages waiting for one module.
+#define DEFAULT_MODULE_QUEUE_SIZE       256
+
+// max messages taken from one queue per send round.
+#define MODULE_QUEUE_BURST              8
+
+// producer waits at most this time for space when policy is QUEUE_BLOCK then message is dropped.
+#define MODULE_QUEUE_BLOCK_TIMEOUT_MS   100
+
+// dispatcher retry interval when sockets are busy.
+#define MODULE_QUEUE_RETRY_MS           1
+
+
+enum ENUM_QUEUE_POLICY
+{
+    // remove oldest waiting message to make space for new one.
+    QUEUE_DROP_OLDEST   = 0,
+    // reject new message.
+    QUEUE_DROP_NEWEST   = 1,
+    // wait for space. wait is bounded by MODULE_QUEUE_BLOCK_TIMEOUT_MS.
+    // callers holding a lock do not wait and drop new message instead.
+    QUEUE_BLOCK         = 2
+};
+
+
+typedef struct
+{
+    uint64_t queued;
+    uint64_t sent;
+    uint64_t dropped;
+    uint64_t max_depth;
+} MODULE_QUEUE_COUNTERS;
+
+
+namespace uavos
+{
+    /**
+     * @brief Bounded queue of messages waiting to be sent to one module.
+     * @details messages are shared between queues when the same message is sent to many modules.
+     *
+     */
+    class CModuleOutboundQueue
+    {
+        public:
+
+            CModuleOutboundQueue(const std::string& module_id, const SOCKET_ADDRESS& module_address, const std::size_t max_size, const ENUM_QUEUE_POLICY policy);
+
+            CModuleOutboundQueue(CModuleOutboundQueue const&)       = delete;
+            void operator=(CModuleOutboundQueue const&)             = delete;
+
+        public:
+
+            /**
+             * @brief add message according to overflow policy.
+             *
+             * @param message
+             * @param may_block false if caller holds a lock. QUEUE_BLOCK then acts as QUEUE_DROP_NEWEST.
+             * @return true if message is queued.
+             */
+            bool push (std::shared_ptr<const std::string> message, const bool may_block = true);
+
+            /**
+             * @brief copy up to max_count messages from head without removing them.
+             *
+             * @param messages
+             * @param max_count
+             */
+            void peek (std::vector<std::shared_ptr<const std::string>>& messages, const std::size_t max_count);
+
+            /**
+             * @brief remove messages from head after being sent or failed.
+             * @details messages already dropped by QUEUE_DROP_OLDEST meanwhile are skipped.
+             *
+             * @param messages handled messages as returned by @link peek @endlink.
+             * @param count
+             * @param sent number of them that has been sent.
+             */
+            void pop (const std::shared_ptr<const std::string> * messages, const std::size_t count, const std::size_t sent);
+
+            const SOCKET_ADDRESS * getAddress () const { return &m_module_address; }
+            const std::string& getModuleId () const { return m_module_id; }
+            MODULE_QUEUE_COUNTERS getCounters ();
+
+        private:
+
+            const std::string m_module_id;
+            const SOCKET_ADDRESS m_module_address;
+            const std::size_t m_max_size;
+            const ENUM_QUEUE_POLICY m_policy;
+
+            std::deque<std::shared_ptr<const std::string>> m_messages;
+            MODULE_QUEUE_COUNTERS m_counters = {0, 0, 0, 0};
+            std::mutex m_lock;
+            std::condition_variable m_space_available;
+    };
+
+
+    /**
+     * @brief Sends queued messages to modules from a dedicated thread.
+     * @details callers only enqueue so a slow or stalled module cannot delay other modules
+     * or the websocket read path. Heads of all queues are sent together using @link CUDPCommunicator::TrySendMany @endlink.
+     *
+     */
+    class CUavosModuleDispatcher
+    {
+        public:
+            //https://stackoverflow.com/questions/1008019/c-singleton-design-pattern
+            static CUavosModuleDispatcher& getInstance()
+            {
+                static CUavosModuleDispatcher instance;
+
+                return instance;
+            }
+
+            CUavosModuleDispatcher(CUavosModuleDispatcher const&)           = delete;
+            void operator=(CUavosModuleDispatcher const&)                   = delete;
+
+        private:
+
+            CUavosModuleDispatcher() {};
+
+        public:
+
+            ~CUavosModuleDispatcher ();
+
+            /**
+             * @brief Set size & overflow policy of queues created after this call.
+             *
+             * @param max_size
+             * @param policy
+             */
+            void setQueueLimits (const std::size_t max_size, const ENUM_QUEUE_POLICY policy);
+
+            std::shared_ptr<CModuleOutboundQueue> createQueue (const std::string& module_id, const SOCKET_ADDRESS& module_address);
+
+            /**
+             * @brief stop serving a queue of a dead module, an old module address or an unused multicast group.
+             * @details messages still waiting in queue are dropped.
+             *
+             * @param queue
+             */
+            void removeQueue (const std::shared_ptr<CModuleOutboundQueue>& queue);
+
+            /**
+             * @brief add message to queue of a module and wake dispatcher thread.
+             *
+             * @param queue
+             * @param message
+             * @param may_block false if caller holds a lock e.g. g_i_mutex of modules manager. @see CModuleOutboundQueue::push
+             */
+            void enqueue (const std::shared_ptr<CModuleOutboundQueue>& queue, std::shared_ptr<const std::string> message, const bool may_block = true);
+
+            void start ();
+            void stop ();
+
+        private:
+
+            void dispatcherEntry ();
+
+        private:
+
+            std::size_t m_queue_size = DEFAULT_MODULE_QUEUE_SIZE;
+            ENUM_QUEUE_POLICY m_queue_policy = QUEUE_DROP_OLDEST;
+
+            std::vector<std::shared_ptr<CModuleOutboundQueue>> m_queues;
+            std::mutex m_lock;
+            std::condition_variable m_wakeup;
+            bool m_pending = false;
+
+            std::thread m_thread;
+            std::atomic<bool> m_started = {false};
+            std::atomic<bool> m_stopped_called = {false};
+    };
+}
+
+#endif
@@ -2,8 +2,10 @@
 
 
 #include <exception>
+#include <algorithm>
 #include <typeinfo>
 #include <stdexcept>
+#include <limits>
 
 
 #include <sys/socket.h> 
@@ -19,21 +21,29 @@
 
 #include "../messages.hpp"
 #include "../udpCommunicator.hpp"
+#include "../messageLatency.hpp"
+#include "../messageFrame.hpp"
+#include "../messageStatistics.hpp"
 #include "../configFile.hpp"
 #include "../localConfigFile.hpp"
 #include "../comm_server/andruav_unit.hpp"
 #include "../comm_server/andruav_comm_server.hpp"
 #include "../comm_server/andruav_facade.hpp"
 #include "../comm_server/andruav_auth.hpp"
+#include "../comm_server/andruav_uplink_coalescer.hpp"
 #include "../uavos/uavos_modules_manager.hpp"
+#include "../uavos/uavos_message_scanner.hpp"
+#include "../uavos/uavos_license_verifier.hpp"
+#include "../uavos/uavos_license_cache.hpp"
 
 
 
 
 using namespace uavos;
 
+// protects modules & camera lists. readers use published snapshots instead.
 static std::mutex g_i_mutex; 
-static std::mutex g_i_mutex_process; 
+static std::mutex g_i_mutex_shm; 
 
 CUavosModulesManager::~CUavosModulesManager()
 {
@@ -63,7 +73,12 @@ Json CUavosModulesManager::createJSONID (const bool& reSend)
         const Json& jsonConfig = cConfigFile.GetConfigJSON();
         CLocalConfigFile& cLocalConfigFile = uavos::CLocalConfigFile::getInstance();
         std::string module_key = cLocalConfigFile.getStringField("module_key");
-        uavos::ANDRUAV_UNIT_INFO&  unit_info = uavos::CAndruavUnitMe::getInstance().getUnitInfo();
+        std::string party_id;
+        {
+            uavos::CAndruavUnitMe& andruav_unit_me = uavos::CAndruavUnitMe::getInstance();
+            const std::lock_guard<std::mutex> unit_lock(andruav_unit_me.getLock());
+            party_id = andruav_unit_me.getUnitInfo().party_id;
+        }
     
         Json jsonID;        
         
@@ -78,13 +93,28 @@ Json CUavosModulesManager::createJSONID (const bool& reSend)
         ms[JSON_INTERMODULE_MODULE_KEY] = module_key; 
         ms[JSON_INTERMODULE_PARTY_RECORD] = 
         {
-            {"sd",unit_info.party_id},
+            {"sd",party_id},
             {"gr", jsonConfig["groupID"]}
         };
         
         // this is NEW in communicator and could be ignored by current UAVOS modules.
         ms[JSON_INTERMODULE_SOCKET_STATUS] = andruav_servers::CAndruavCommServer::getInstance().getStatus();
         ms[JSON_INTERMODULE_RESEND] = reSend;
+        // modules may send framed messages and ask for them.
+        ms[JSON_INTERMODULE_FRAME_VERSION] = FRAME_VERSION;
+        if (!m_multicast_groups.empty())
+        {
+            Json groups = Json::array();
+            for (const auto& group : m_multicast_groups)
+            {
+                groups.push_back({
+                    {"mt", group.first},
+                    {"a", group.second.group_address},
+                    {"p", group.second.port}
+                });
+            }
+            ms[JSON_INTERMODULE_MULTICAST_GROUPS] = groups;
+        }
 
         jsonID[ANDRUAV_PROTOCOL_MESSAGE_CMD] = ms;
         
@@ -114,6 +144,7 @@ Json CUavosModulesManager::createJSONID (const bool& reSend)
 bool CUavosModulesManager::updateUavosPermission (const Json& module_permissions)
 {
     CAndruavUnitMe& andruav_unit_me = CAndruavUnitMe::getInstance();
+    const std::lock_guard<std::mutex> unit_lock(andruav_unit_me.getLock());
     bool updated = false;
     //const int&  len = module_permissions.size();
     for (const auto permission : module_permissions)
@@ -147,6 +178,11 @@ bool CUavosModulesManager::updateUavosPermission (const Json& module_permissions
         
     }
 
+    if (updated)
+    {
+        andruav_unit_me.touchUnitInfo();
+    }
+
     return updated;
 }
 
@@ -159,33 +195,19 @@ bool CUavosModulesManager::updateUavosPermission (const Json& module_permissions
 * 
 * @param module_id 
 */
-void CUavosModulesManager::cleanOrphanCameraEntries (const std::string& module_id, const uint64_t& time_now)
+bool CUavosModulesManager::cleanOrphanCameraEntries (const std::string& module_id, const uint64_t& time_now)
 {
-    auto camera_module = m_camera_list.find(module_id);
-    if (camera_module == m_camera_list.end()) return ;
-
-    std::map <std::string, std::unique_ptr<MODULE_CAMERA_ENTRY>> *camera_entry_list= camera_module->second.get();
-
-    std::map <std::string, std::unique_ptr<MODULE_CAMERA_ENTRY>>::iterator camera_entry_itrator;
-    std::vector <std::string> orphan_list;
-    for (camera_entry_itrator = camera_entry_list->begin(); camera_entry_itrator != camera_entry_list->end(); camera_entry_itrator++)
-    {   
-            const MODULE_CAMERA_ENTRY * camera_entry= camera_entry_itrator->second.get();
-
-            if (camera_entry->module_last_access_time < time_now)
-            {
-                // old and should be removed
-                orphan_list.push_back (camera_entry->global_index);
-            }
-    }
+    const std::size_t count = m_camera_list.size();
 
-
-    //TODO: NOT TESTED
     // remove orphans 
-    for(auto const& value: orphan_list) {
-        camera_entry_list->erase(value);
-    }
+    m_camera_list.erase(std::remove_if(m_camera_list.begin(), m_camera_list.end(), 
+        [&](const MODULE_CAMERA_ENTRY& camera_entry)
+        {
+            // old and should be removed
+            return (camera_entry.module_id == module_id) && (camera_entry.module_last_access_time < time_now);
+        }), m_camera_list.end());
     
+    return (m_camera_list.size() != count);
 }
 
 
@@ -250,27 +272,10 @@ void CUavosModulesManager::updateCameraList(const std::string& module_id, const
         std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: updateCameraList " << _NORMAL_CONSOLE_TEXT_ << std::endl;
     #endif
 
-    // Check if Module "Camera_ModuleName" is listed.
-    auto camera_module = m_camera_list.find(module_id);
-    if (camera_module == m_camera_list.end()) 
-    {
-        // Module Not found in camera list
-        #ifdef DEBUG
-            std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: updateCameraList // Module Not found in camera list" << _NORMAL_CONSOLE_TEXT_ << std::endl;
-        #endif
-
-        std::map <std::string, std::unique_ptr<MODULE_CAMERA_ENTRY>> *pcamera_entries = new std::map <std::string, std::unique_ptr<MODULE_CAMERA_ENTRY>>();
-        m_camera_list.insert(std::make_pair(module_id, std::unique_ptr<std::map <std::string, std::unique_ptr<MODULE_CAMERA_ENTRY>>>(pcamera_entries)));
-    }
-
-
-    // Retrieve list of camera entries of this module.
-    camera_module = m_camera_list.find(module_id);
-
-    std::map <std::string, std::unique_ptr<MODULE_CAMERA_ENTRY>> *camera_entry_list= camera_module->second.get();
-
     // List of camera devices in a camera module recieved by intermodule message.
-    Json camera_array = msg_cmd["m"];
+    const Json& camera_array = msg_cmd["m"];
+
+    bool changed = false;
 
     // iterate over camera devices in recieved json message.
     const int messages_length = camera_array.size(); 
@@ -278,86 +283,130 @@ void CUavosModulesManager::updateCameraList(const std::string& module_id, const
     for (int i=0; i< messages_length; ++i)
     {
         
-        Json jcamera_entry = camera_array[i];
+        const Json& jcamera_entry = camera_array[i];
         // camera device id
         const std::string& camera_entry_id = jcamera_entry["id"].get<std::string>();
         
-        
-        auto camera_entry_record = camera_entry_list->find(camera_entry_id);
-        if (camera_entry_record == camera_entry_list->end()) 
+        // entries are sorted by module then camera id.
+        auto camera_entry_record = std::lower_bound(m_camera_list.begin(), m_camera_list.end(), std::make_pair(&module_id, &camera_entry_id),
+            [](const MODULE_CAMERA_ENTRY& camera_entry, const std::pair<const std::string*, const std::string*>& key)
+            {
+                const int order = camera_entry.module_id.compare(*key.first);
+                return (order < 0) || ((order == 0) && (camera_entry.global_index < *key.second));
+            });
+
+        const bool is_new = (camera_entry_record == m_camera_list.end()) 
+            || (camera_entry_record->module_id != module_id) 
+            || (camera_entry_record->global_index != camera_entry_id);
+        if (is_new) 
         {
             // camera entry not listed in cameras list of submodule
-            MODULE_CAMERA_ENTRY * camera_entry = new MODULE_CAMERA_ENTRY();
-            camera_entry->module_id  = module_id;
-            camera_entry->global_index = camera_entry_id;
-            camera_entry->logical_name = jcamera_entry["ln"].get<std::string>();
-            camera_entry->is_recording = jcamera_entry["r"].get<bool>();
-            camera_entry->is_camera_avail = jcamera_entry["v"].get<bool>();
-            camera_entry->is_camera_streaming = jcamera_entry["active"].get<int>();
-            camera_entry->camera_type = jcamera_entry["p"].get<int>();
-            
-            camera_entry->module_last_access_time = now_time;
-            camera_entry->updates = true;
-            camera_entry_list->insert(std::make_pair(camera_entry_id, std::unique_ptr<MODULE_CAMERA_ENTRY> (camera_entry) ));
-        
+            camera_entry_record = m_camera_list.insert(camera_entry_record, MODULE_CAMERA_ENTRY());
+            camera_entry_record->module_id  = module_id;
+            camera_entry_record->global_index = camera_entry_id;
         }
-        else
+        
+        MODULE_CAMERA_ENTRY& camera_entry = *camera_entry_record;
+        const std::string& logical_name = jcamera_entry["ln"].get_ref<const std::string&>();
+        const bool is_recording = jcamera_entry["r"].get<bool>();
+        const bool is_camera_avail = jcamera_entry["v"].get<bool>();
+        const int is_camera_streaming = jcamera_entry["active"].get<int>();
+        const int camera_type = jcamera_entry["p"].get<int>();
+
+        if ((is_new) 
+            || (camera_entry.logical_name != logical_name)
+            || (camera_entry.is_recording != is_recording)
+            || (camera_entry.is_camera_avail != is_camera_avail)
+            || (camera_entry.is_camera_streaming != is_camera_streaming)
+            || (camera_entry.camera_type != camera_type))
         {
-            //camera listed
-            
-            MODULE_CAMERA_ENTRY * camera_entry = camera_entry_record->second.get();
-            camera_entry->module_id  = module_id;
-            camera_entry->global_index = camera_entry_id;
-            camera_entry->logical_name = jcamera_entry["ln"].get<std::string>();
-            camera_entry->is_recording = jcamera_entry["r"].get<bool>();
-            camera_entry->is_camera_avail = jcamera_entry["v"].get<bool>();
-            camera_entry->is_camera_streaming = jcamera_entry["active"].get<int>();
-            camera_entry->camera_type = jcamera_entry["p"].get<int>();
+            camera_entry.logical_name = logical_name;
+            camera_entry.is_recording = is_recording;
+            camera_entry.is_camera_avail = is_camera_avail;
+            camera_entry.is_camera_streaming = is_camera_streaming;
+            camera_entry.camera_type = camera_type;
+            camera_entry.updates = true;
+            changed = true;
+        }
             
-            camera_entry->module_last_access_time = now_time;
-            camera_entry->updates = true;
+        camera_entry.module_last_access_time = now_time;
+    }
 
-        }
+    changed |= cleanOrphanCameraEntries(module_id, now_time);
+
+    if (changed)
+    {
+        publishCameraList();
     }
+}
 
-    cleanOrphanCameraEntries(module_id, now_time);
+
+std::shared_ptr<const CAMERA_LIST_SNAPSHOT> CUavosModulesManager::getCameraList() const
+{
+    return m_camera_list_snapshot.acquire();
 }
 
 
-Json CUavosModulesManager::getCameraList()
+void CUavosModulesManager::publishCameraList()
 {
     Json camera_list = Json::array();
 
-    MODULE_CAMERA_LIST::iterator camera_module;
-    for (camera_module = m_camera_list.begin(); camera_module != m_camera_list.end(); camera_module++)
+    for (const MODULE_CAMERA_ENTRY& camera_entry : m_camera_list)
     {   
-        std::map <std::string, std::unique_ptr<MODULE_CAMERA_ENTRY>> * camera_entry_list = camera_module->second.get();
-        
-        std::map <std::string, std::unique_ptr<MODULE_CAMERA_ENTRY>>::iterator camera_entry_itrator;
+        Json json_camera_entry =
+        {
+            // check uavos_camera_plugin
+            {"v", camera_entry.is_camera_avail},
+            {"ln", camera_entry.logical_name},
+            {"id", camera_entry.global_index},
+            {"active", camera_entry.is_camera_streaming},
+            {"r", camera_entry.is_recording},
+            {"p", camera_entry.camera_type}
 
-        for (camera_entry_itrator = camera_entry_list->begin(); camera_entry_itrator != camera_entry_list->end(); camera_entry_itrator++)
-        {   
-            const MODULE_CAMERA_ENTRY * camera_entry= camera_entry_itrator->second.get();
-    
-            
-            
-            Json json_camera_entry =
-            {
-                // check uavos_camera_plugin
-                {"v", camera_entry->is_camera_avail},
-                {"ln", camera_entry->logical_name},
-                {"id", camera_entry->global_index},
-                {"active", camera_entry->is_camera_streaming},
-                {"r", camera_entry->is_recording},
-                {"p", camera_entry->camera_type}
+        };
+        camera_list.push_back(json_camera_entry);
+    }
 
-            };
-            camera_list.push_back(json_camera_entry);
-        }
+    std::shared_ptr<CAMERA_LIST_SNAPSHOT> snapshot = std::make_shared<CAMERA_LIST_SNAPSHOT>();
+    snapshot->version = m_camera_list_snapshot.getVersion() + 1;
+    snapshot->camera_list_text = camera_list.dump();
+
+    m_camera_list_snapshot.publish(snapshot);
+}
+
+
+/**
+ * @brief parse a subscription entry that is not a single message type.
+ * 
+ * @param entry "*" or "first-last"
+ * @param first 
+ * @param last 
+ * @return false if entry is not a valid range.
+ */
+static bool parseMessageRange (const std::string& entry, int& first, int& last)
+{
+    if (entry == INTERMODULE_MESSAGES_WILDCARD)
+    {
+        first = 0;
+        last = std::numeric_limits<int>::max();
+        return true;
     }
 
-    return camera_list;
+    const std::size_t separator = entry.find(INTERMODULE_MESSAGES_RANGE_SEPARATOR, 1);
+    if (separator == std::string::npos) return false;
 
+    try
+    {
+        std::size_t first_length, last_length;
+        first = std::stoi(entry.substr(0, separator), &first_length);
+        last = std::stoi(entry.substr(separator + 1), &last_length);
+        
+        return (first_length == separator) && (last_length == entry.length() - separator - 1) && (first <= last);
+    }
+    catch (...)
+    {
+        return false;
+    }
 }
 
 
@@ -368,6 +417,24 @@ bool CUavosModulesManager::updateModuleSubscribedMessages (const std::string& mo
     const int messages_length = message_array.size(); 
     for (int i=0; i< messages_length; ++i)
     {
+        if (message_array[i].is_string())
+        {
+            int first, last;
+            if (!parseMessageRange(message_array[i].get<std::string>(), first, last))
+            {
+                PLOG(plog::warning) << "Module " << module_id << " has invalid message subscription " << message_array[i].dump();
+                continue;
+            }
+
+            std::vector<std::string> &v = m_module_message_ranges[std::make_pair(first, last)];
+            if (std::find(v.begin(), v.end(), module_id) == v.end())
+            {
+                v.push_back(module_id);
+                new_module = true;
+            }
+            continue;
+        }
+
         /**
         * @brief 
         * select list of a given message id.
@@ -392,7 +459,9 @@ bool CUavosModulesManager::updateModuleSubscribedMessages (const std::string& mo
 
 
 /**
- * @brief  Communicate with @link andruav_servers::CAndruavAuthenticator @endlink to validate hardware status
+ * @brief  Ask @link CModuleLicenseVerifier @endlink to validate hardware status with @link andruav_servers::CAndruavAuthenticator @endlink
+ * @details an accepted license in @link CLicenseVerdictCache @endlink is applied at once. a rejection always comes from auth server.
+ * otherwise module stays LICENSE_NOT_VERIFIED till @link handleLicenseVerified @endlink is called.
  * 
  * @param module_item 
  */
@@ -400,42 +469,220 @@ void CUavosModulesManager::checkLicenseStatus (MODULE_ITEM_TYPE * module_item)
 {
     andruav_servers::CAndruavAuthenticator &auth = andruav_servers::CAndruavAuthenticator::getInstance();
 
-    if (auth.isAuthenticationOK())
+    if (!module_item->licence_revalidate)
     {
-        if (auth.doValidateHardware(module_item->hardware_serial, module_item->hardware_type))
+        bool stale;
+        if (CLicenseVerdictCache::getInstance().getVerdict(module_item->hardware_serial, module_item->hardware_type, stale))
         {
-            std::cout << std::endl << _SUCCESS_CONSOLE_BOLD_TEXT_ << "Module License OK: " << _SUCCESS_CONSOLE_TEXT_ << module_item->module_id << _NORMAL_CONSOLE_TEXT_ << std::endl;
-            PLOG(plog::info)<< "Module License OK: " << module_item->module_id ;
-
-            module_item->licence_status = ENUM_LICENCE::LICENSE_VERIFIED_OK;
+            applyLicenseVerdict(module_item, true);
+            module_item->licence_revalidate = stale;
+            
+            if (!stale) return ;
         }
         else
         {
-            std::cout << std::endl << _ERROR_CONSOLE_BOLD_TEXT_ << "Module License Invalid: " << _ERROR_CONSOLE_TEXT_ << module_item->module_id<< _NORMAL_CONSOLE_TEXT_ << std::endl;
-            PLOG(plog::error)<< "Module License Invalid: " << module_item->module_id ;
-
-            module_item->licence_status = ENUM_LICENCE::LICENSE_VERIFIED_BAD;
-            andruav_servers::CAndruavFacade::getInstance().API_sendErrorMessage(std::string(), 0, ERROR_TYPE_ERROR_MODULE, NOTIFICATION_TYPE_ALERT, std::string("Module " + module_item->module_id + " is not allowed to run."));
+            module_item->licence_status = ENUM_LICENCE::LICENSE_NOT_VERIFIED;
         }
     }
+
+    if (auth.isAuthenticationOK())
+    {
+        CModuleLicenseVerifier::getInstance().requestVerification(module_item->hardware_serial, module_item->hardware_type);
+    }
     else
     {
         PLOG(plog::warning)<< "Module License " << module_item->module_id << " could not been verified";
-        
-        module_item->licence_status = ENUM_LICENCE::LICENSE_NOT_VERIFIED;
     }
 }
 
+
+bool CUavosModulesManager::applyLicenseVerdict (MODULE_ITEM_TYPE * module_item, const bool valid)
+{
+    const ENUM_LICENCE licence_status = valid ? ENUM_LICENCE::LICENSE_VERIFIED_OK : ENUM_LICENCE::LICENSE_VERIFIED_BAD;
+    if (module_item->licence_status == licence_status) return false;
+
+    module_item->licence_status = licence_status;
+
+    if (valid)
+    {
+        std::cout << std::endl << _SUCCESS_CONSOLE_BOLD_TEXT_ << "Module License OK: " << _SUCCESS_CONSOLE_TEXT_ << module_item->module_id << _NORMAL_CONSOLE_TEXT_ << std::endl;
+        PLOG(plog::info)<< "Module License OK: " << module_item->module_id ;
+    }
+    else
+    {
+        std::cout << std::endl << _ERROR_CONSOLE_BOLD_TEXT_ << "Module License Invalid: " << _ERROR_CONSOLE_TEXT_ << module_item->module_id<< _NORMAL_CONSOLE_TEXT_ << std::endl;
+        PLOG(plog::error)<< "Module License Invalid: " << module_item->module_id ;
+
+        andruav_servers::CAndruavFacade::getInstance().API_sendErrorMessage(std::string(), 0, ERROR_TYPE_ERROR_MODULE, NOTIFICATION_TYPE_ALERT, std::string("Module " + module_item->module_id + " is not allowed to run."));
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Called from @link CModuleLicenseVerifier @endlink thread with result of a hardware serial verification.
+ * @details accepted verdict of auth server is cached then all modules with this serial that are not verified or 
+ * use an old cached verdict are updated.
+ * when auth server is not reachable not verified modules are rejected as before while cached verdicts are kept.
+ * 
+ * @param hardware_serial 
+ * @param hardware_type 
+ * @param valid 
+ * @param replied false if auth server could not be reached.
+ */
+void CUavosModulesManager::handleLicenseVerified (const std::string& hardware_serial, const int hardware_type, const bool valid, const bool replied)
+{
+    if (replied)
+    {
+        CLicenseVerdictCache::getInstance().setVerdict(hardware_serial, hardware_type, valid);
+    }
+
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+    bool registry_changed = false;
+
+    for (const auto& uavos_module : m_modules_list)
+    {
+        MODULE_ITEM_TYPE * module_item = uavos_module.second.get();
+        if ((module_item->hardware_serial != hardware_serial) || (module_item->hardware_type != hardware_type)) continue;
+        if ((module_item->licence_status != ENUM_LICENCE::LICENSE_NOT_VERIFIED) && (!module_item->licence_revalidate)) continue;
+        // keep cached verdict & try again later.
+        if ((!replied) && (module_item->licence_revalidate)) continue;
+
+        module_item->licence_revalidate = false;
+        registry_changed |= applyLicenseVerdict(module_item, valid);
+    }
+
+    if (registry_changed)
+    {
+        publishRegistry();
+    }
+}
+
+
+/**
+ * @brief key of a module address in MODULE_REGISTRY_SNAPSHOT::address_index.
+ */
+static uint64_t hashModuleAddress (const SOCKET_ADDRESS& address)
+{
+    return hash_fnv1a_64((const char *) &address.address, address.length);
+}
+
+
+void CUavosModulesManager::publishRegistry ()
+{
+    std::shared_ptr<MODULE_REGISTRY_SNAPSHOT> registry = std::make_shared<MODULE_REGISTRY_SNAPSHOT>();
+
+    for (const auto& message_modules : m_module_messages)
+    {
+        for (const std::string& module_id : message_modules.second)
+        {
+            auto uavos_module = m_modules_list.find(module_id);
+            if (uavos_module == m_modules_list.end()) 
+            {
+                std::cout << _ERROR_CONSOLE_BOLD_TEXT_ << "Module " << module_id  << " for message " << message_modules.first << " is not available" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+                continue;
+            }
+
+            const MODULE_ITEM_TYPE * module_item = uavos_module->second.get();
+            const bool licence_bad = (module_item->licence_status == LICENSE_VERIFIED_BAD);
+            if ((module_item->is_dead) && (!licence_bad)) continue;
+
+            registry->routing_table.addRoute(message_modules.first, MODULE_ROUTE{module_item->module_id, module_item->module_key, module_item->m_outbound_queue, licence_bad, (module_item->frame_version != 0), module_item->stats_index, false});
+        }
+    }
+
+    for (const auto& range_modules : m_module_message_ranges)
+    {
+        for (const std::string& module_id : range_modules.second)
+        {
+            auto uavos_module = m_modules_list.find(module_id);
+            if (uavos_module == m_modules_list.end()) continue;
+
+            const MODULE_ITEM_TYPE * module_item = uavos_module->second.get();
+            const bool licence_bad = (module_item->licence_status == LICENSE_VERIFIED_BAD);
+            if ((module_item->is_dead) && (!licence_bad)) continue;
+
+            registry->routing_table.addRangeRoute(range_modules.first.first, range_modules.first.second, MODULE_ROUTE{module_item->module_id, module_item->module_key, module_item->m_outbound_queue, licence_bad, (module_item->frame_version != 0), module_item->stats_index, false});
+        }
+    }
+
+    registry->routing_table.compile();
+
+    for (auto& multicast_group : m_multicast_groups)
+    {
+        MODULE_MULTICAST_GROUP& group = multicast_group.second;
+
+        std::set<std::string> members;
+        for (const MODULE_ROUTE& route : registry->routing_table.getRoutes(group.message_type))
+        {
+            if (route.licence_bad) continue;
+
+            const MODULE_ITEM_TYPE * module_item = m_modules_list.find(route.module_id)->second.get();
+            if (module_item->multicast_joined.find(group.message_type) == module_item->multicast_joined.end()) continue;
+
+            members.insert(route.module_id);
+        }
+
+        if (members.size() < m_multicast_min_subscribers)
+        {
+            // group is not used. dispatcher does not need to check its queue.
+            CUavosModuleDispatcher::getInstance().removeQueue(group.outbound_queue);
+            group.outbound_queue.reset();
+            continue;
+        }
+
+        if (!group.outbound_queue)
+        {
+            group.outbound_queue = CUavosModuleDispatcher::getInstance().createQueue("multicast:" + std::to_string(group.message_type), group.address);
+        }
+
+        registry->routing_table.setMulticast(group.message_type, members);
+        registry->multicast_queues[group.message_type] = group.outbound_queue;
+    }
+
+    for (const auto& uavos_module : m_modules_list)
+    {
+        const MODULE_ITEM_TYPE * module_item = uavos_module.second.get();
+
+        Json json_module_entry =
+        {
+            // check uavos_camera_plugin
+            {"v", module_item->version},
+            {"i", module_item->module_id},
+            {"c", module_item->module_class},
+            {"t", module_item->time_stamp},
+        };
+        registry->module_list.push_back(json_module_entry);
+
+        if (module_item->m_module_address)
+        {
+            registry->address_index.insert(std::make_pair(hashModuleAddress(*module_item->m_module_address), registry->module_addresses.size()));
+            registry->module_addresses.push_back(MODULE_ADDRESS_ENTRY{*module_item->m_module_address, module_item->module_id, module_item->module_key, module_item->stats_index});
+        }
+    }
+
+    #ifdef DEBUG
+        std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: publishRegistry " << _NORMAL_CONSOLE_TEXT_ << std::endl;
+    #endif
+
+    registry->version = m_registry.getVersion() + 1;
+
+    m_registry.publish(registry);
+}
+
 /**
 * @brief handle TYPE_AndruavModule_ID messages.
 * Add/Update module definitions.
 * @param msg_cmd 
 * @param ssock 
+* @param ms_fingerprint hash of msg_cmd text. @see refreshModuleRegistration
 * 
 * @return true module has been added.
 * @return false no new modules.
 */
-bool CUavosModulesManager::handleModuleRegistration (const Json& msg_cmd, const struct sockaddr_in* ssock)
+bool CUavosModulesManager::handleModuleRegistration (const Json& msg_cmd, const SOCKET_ADDRESS* ssock, const uint64_t ms_fingerprint)
 {
 
     #ifdef DEBUG
@@ -443,8 +690,10 @@ bool CUavosModulesManager::handleModuleRegistration (const Json& msg_cmd, const
     #endif
     
     bool updated = false;
+    // registry snapshot should be published.
+    bool registry_changed = false;
 
-    const uint64_t &now = get_time_usec();
+    const uint64_t &now = get_monotonic_time_usec();
             
     // array of message IDs
     
@@ -466,6 +715,7 @@ bool CUavosModulesManager::handleModuleRegistration (const Json& msg_cmd, const
         module_item->module_id          = module_id;
         module_item->module_class       = msg_cmd[JSON_INTERMODULE_MODULE_CLASS].get<std::string>(); // fcb, video, ...etc.
         module_item->modules_features   = msg_cmd[JSON_INTERMODULE_MODULE_FEATURES];
+        module_item->module_timeout     = getModuleTimeout(module_item->module_class);
         if (msg_cmd.contains(JSON_INTERMODULE_TIMESTAMP_INSTANCE))
         {   
             module_item->time_stamp         = msg_cmd[JSON_INTERMODULE_TIMESTAMP_INSTANCE].get<std::time_t>();
@@ -491,20 +741,40 @@ bool CUavosModulesManager::handleModuleRegistration (const Json& msg_cmd, const
             module_item->version = std::string("na");
         }
 
-        struct sockaddr_in * module_address = new (struct sockaddr_in)();  
-        memcpy(module_address, ssock, sizeof(struct sockaddr_in)); 
+        SOCKET_ADDRESS * module_address = new (SOCKET_ADDRESS)();  
+        memcpy(module_address, ssock, sizeof(SOCKET_ADDRESS)); 
                 
-        module_item->m_module_address = std::unique_ptr<struct sockaddr_in>(module_address);
+        module_item->m_module_address = std::unique_ptr<SOCKET_ADDRESS>(module_address);
+        module_item->m_outbound_queue = CUavosModuleDispatcher::getInstance().createQueue(module_item->module_id, *module_address);
+        module_item->stats_index = comm::CMessageStatistics::getInstance().registerModule(module_item->module_id);
                 
         m_modules_list.insert(std::make_pair(module_item->module_id, std::unique_ptr<MODULE_ITEM_TYPE>(module_item)));
         
         PLOG(plog::info)<<"Module Adding: " << module_item->module_id ; 
         
+        registry_changed = true;
     }
     else
     {
         module_item = module_entry->second.get();
+        if (module_item->is_dead)
+        {
+            registry_changed = true;
+        }
         module_item->is_dead = false;
+
+        if ((module_item->m_module_address->length != ssock->length)
+            || (memcmp(&module_item->m_module_address->address, &ssock->address, ssock->length) != 0))
+        {
+            // module restarted on another port or moved to Unix socket. old queue is no longer reachable.
+            CUavosModuleDispatcher::getInstance().removeQueue(module_item->m_outbound_queue);
+            module_item->m_outbound_queue.reset();
+            memcpy(module_item->m_module_address.get(), ssock, sizeof(SOCKET_ADDRESS));
+            registry_changed = true;
+
+            PLOG(plog::warning)<<"Module address has changed: " << module_item->module_id ;
+        }
+
                 
         // Update Module Info
 
@@ -513,24 +783,77 @@ bool CUavosModulesManager::handleModuleRegistration (const Json& msg_cmd, const
             // module restarted
             //MODULE HAS BEEN RESTARTED
             module_item->time_stamp = msg_cmd[JSON_INTERMODULE_TIMESTAMP_INSTANCE].get<std::time_t>();
+            registry_changed = true;
             andruav_servers::CAndruavFacade::getInstance().API_sendErrorMessage(std::string(), 0, ERROR_TYPE_ERROR_MODULE, NOTIFICATION_TYPE_ALERT, std::string("Module " + module_item->module_id + " has been restarted."));
         
             PLOG(plog::warning)<<"Module has been restarted: " << module_item->module_id ;
+
+            // restarted producer creates its rings again.
+            closeModuleShmRings(module_item->module_id);
+            // messages queued for old instance are dropped.
+            CUavosModuleDispatcher::getInstance().removeQueue(module_item->m_outbound_queue);
+            module_item->m_outbound_queue.reset();
+        }
+
+        // queue is removed when module dies, restarts or changes its address.
+        if (!module_item->m_outbound_queue)
+        {
+            module_item->m_outbound_queue = CUavosModuleDispatcher::getInstance().createQueue(module_item->module_id, *module_item->m_module_address);
+            registry_changed = true;
         }
         
-        if (module_item->licence_status == ENUM_LICENCE::LICENSE_NOT_VERIFIED)
+        if ((module_item->licence_status == ENUM_LICENCE::LICENSE_NOT_VERIFIED) || (module_item->licence_revalidate))
         {  // module has not been tested last time maybe because Auth was not ready
+            const ENUM_LICENCE licence_status = module_item->licence_status;
             checkLicenseStatus(module_item);
+            registry_changed |= (module_item->licence_status != licence_status);
+        }
+    }
+
+    // module asks for framed messages.
+    int frame_version = 0;
+    if (validateField(msg_cmd, JSON_INTERMODULE_FRAME_VERSION, Json::value_t::number_unsigned))
+    {
+        frame_version = std::min(msg_cmd[JSON_INTERMODULE_FRAME_VERSION].get<int>(), FRAME_VERSION);
+    }
+    if (module_item->frame_version != frame_version)
+    {
+        module_item->frame_version = frame_version;
+        registry_changed = true;
+    }
+
+    // multicast groups joined by module.
+    std::set<int> multicast_joined;
+    if (validateField(msg_cmd, JSON_INTERMODULE_MULTICAST_JOINED, Json::value_t::array))
+    {
+        for (const auto& message_type : msg_cmd[JSON_INTERMODULE_MULTICAST_JOINED])
+        {
+            if (message_type.is_number_integer()) multicast_joined.insert(message_type.get<int>());
         }
     }
+    if (module_item->multicast_joined != multicast_joined)
+    {
+        module_item->multicast_joined.swap(multicast_joined);
+        registry_changed = true;
+    }
 
     module_item->module_last_access_time = now;
+    scheduleLiveness(module_item);
 
             
     // insert message callback
     
     const Json& message_array = msg_cmd[JSON_INTERMODULE_MODULE_MESSAGES_LIST]; 
-    updated |= updateModuleSubscribedMessages(module_id, message_array);
+    if (updateModuleSubscribedMessages(module_id, message_array))
+    {
+        updated = true;
+        registry_changed = true;
+    }
+
+    if (registry_changed)
+    {
+        publishRegistry();
+    }
 
     const std::string module_class = module_item->module_class; //msg_cmd[JSON_INTERMODULE_MODULE_CLASS].get<std::string>(); 
     if (module_class.find("camera")==0)
@@ -542,21 +865,36 @@ bool CUavosModulesManager::handleModuleRegistration (const Json& msg_cmd, const
     else if (module_class.find("fcb")==0)
     {
         CAndruavUnitMe& andruav_unit_me = CAndruavUnitMe::getInstance();
+        const std::lock_guard<std::mutex> unit_lock(andruav_unit_me.getLock());
         ANDRUAV_UNIT_INFO& andruav_unit_info = andruav_unit_me.getUnitInfo();
         andruav_unit_info.use_fcb = true;
+        andruav_unit_me.touchUnitInfo();
         m_status.is_fcb_module_connected (true); 
     } 
 
     updated |= updateUavosPermission(module_item->modules_features); //msg_cmd["d"]);
 
     // reply with identification if required by module
+    module_item->resend_requested = false;
     if (validateField(msg_cmd, "z", Json::value_t::boolean))
     {
         if (msg_cmd["z"].get<bool>() == true)
         {
+            module_item->resend_requested = true;
             const Json &msg = createJSONID(false);
             std::string msg_dump = msg.dump();    
-            forwardMessageToModule(msg_dump.c_str(), msg_dump.length(),module_item);
+            forwardMessageToModule(msg_dump.c_str(), msg_dump.length(),module_item, TYPE_AndruavModule_ID);
+        }
+    }
+
+    // next identical message is handled by refreshModuleRegistration
+    if (module_item->registration_fingerprint != ms_fingerprint)
+    {
+        m_registration_fingerprints.erase(module_item->registration_fingerprint);
+        module_item->registration_fingerprint = ms_fingerprint;
+        if (ms_fingerprint != 0)
+        {
+            m_registration_fingerprints[ms_fingerprint] = module_item;
         }
     }
 
@@ -564,67 +902,239 @@ bool CUavosModulesManager::handleModuleRegistration (const Json& msg_cmd, const
 }
 
 
+bool CUavosModulesManager::refreshModuleRegistration (const uint64_t ms_fingerprint, const SOCKET_ADDRESS* ssock)
+{
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+    auto entry = m_registration_fingerprints.find(ms_fingerprint);
+    if (entry == m_registration_fingerprints.end()) return false;
+
+    MODULE_ITEM_TYPE * module_item = entry->second;
+
+    // module coming back, waiting for license or without a queue needs full processing.
+    if ((module_item->is_dead) 
+        || (module_item->licence_status == ENUM_LICENCE::LICENSE_NOT_VERIFIED)
+        || (module_item->licence_revalidate)
+        || (!module_item->m_outbound_queue))
+    {
+        return false;
+    }
+
+    // module restarted at another address needs a new queue.
+    if ((module_item->m_module_address->length != ssock->length)
+        || (memcmp(&module_item->m_module_address->address, &ssock->address, ssock->length) != 0))
+    {
+        return false;
+    }
+
+    // deadline is extended. module is already in liveness wheel.
+    module_item->module_last_access_time = get_monotonic_time_usec();
+
+    if (module_item->resend_requested)
+    {
+        const Json &msg = createJSONID(false);
+        std::string msg_dump = msg.dump();    
+        forwardMessageToModule(msg_dump.c_str(), msg_dump.length(),module_item, TYPE_AndruavModule_ID);
+    }
+
+    return true;
+}
+
+
 /**
  * @brief 
  * Process messages recieved from module and may forward to Andruav ommunication server.
  * @details 
- * @param full_message 
+ * @param full_message framed message @see FRAME_HEADER or legacy message [JSON][0][binary]
  * @param full_message_length 
- * @param ssock sender module ip & port
+ * @param ssock sender module address (ip & port or unix path)
+ * @param ingress_nsec kernel receive time of message.
  */
-void CUavosModulesManager::parseIntermoduleMessage (const char * full_message, const std::size_t full_message_length, const struct sockaddr_in* ssock)
+void CUavosModulesManager::parseIntermoduleMessage (const char * full_message, const std::size_t full_message_length, const SOCKET_ADDRESS* ssock, const uint64_t ingress_nsec)
 {
-    Json jsonMessage;
-    try
+    // websocket write of this message in this thread is measured against ingress_nsec.
+    comm::CMessageLatency::CScope latency_scope(ingress_nsec);
+
+    // sender is identified by its address as GU is optional.
+    const std::shared_ptr<const MODULE_REGISTRY_SNAPSHOT> registry = m_registry.acquire();
+    const MODULE_ADDRESS_ENTRY * sender_module = findSenderModule(*registry, ssock);
+
+    comm::CMessageStatistics& statistics = comm::CMessageStatistics::getInstance();
+    const int stats_index = (sender_module != NULL) ? sender_module->stats_index : 0;
+
+    comm::MESSAGE_FRAME frame;
+    if (comm::isFramed(full_message, full_message_length))
+    {
+        // binary part is located from header.
+        if (!comm::decodeFrame(full_message, full_message_length, frame))
+        {
+            // unsupported version or corrupted message.
+            statistics.countParseError(stats_index);
+            return ;
+        }
+    }
+    else
     {
-        jsonMessage = Json::parse(full_message);
+        comm::decodeLegacyMessage(full_message, full_message_length, frame);
     }
-    catch (...)
+
+    // routing fields only. most messages are forwarded as they are without building a JSON DOM.
+    INTERMODULE_MESSAGE_HEADER header;
+    if (!scanIntermoduleHeader(frame.json, frame.json_length, header))
     {
         // corrupted message.
+        statistics.countParseError(stats_index);
         return ;
     }
 
-    const bool is_binary =  !(full_message[full_message_length-1]==125 || (full_message[full_message_length-2]==125));
+    const bool is_binary = frame.is_binary;
     
     #ifdef DEBUG
-        std::cout<< jsonMessage[ANDRUAV_PROTOCOL_MESSAGE_TYPE] << std::endl;
+        std::cout<< header.message_type << std::endl;
     #endif
 
-    if ((!validateField(jsonMessage, INTERMODULE_ROUTING_TYPE, Json::value_t::string))
-        || (!validateField(jsonMessage, ANDRUAV_PROTOCOL_MESSAGE_TYPE, Json::value_t::number_unsigned))
-        )
+    if ((!header.has_routing_type) || (header.message_type < 0))
     {
         // bad message format
+        statistics.countParseError(stats_index);
         return ;
     }
     
     std::string target_id = std::string();
-    std::string msg_routing_type = jsonMessage[INTERMODULE_ROUTING_TYPE].get<std::string>();
+    const std::string& msg_routing_type = header.routing_type;
     
     const bool is_system = (msg_routing_type.find(CMD_COMM_SYSTEM) != std::string::npos);
     
     if ((msg_routing_type.find(CMD_COMM_GROUP) == std::string::npos)
         && (!is_system)
-        && jsonMessage.contains(ANDRUAV_PROTOCOL_TARGET_ID)
+        && header.has_target_id
         )
     {   //CMD_COMM_GROUP  does not exist and a single target id is mentioned.
-        target_id =jsonMessage[ANDRUAV_PROTOCOL_TARGET_ID].get<std::string>();
+        target_id = header.target_id;
     }
 
     // Intermodule Message
-    const bool intermodule_msg = (jsonMessage[INTERMODULE_ROUTING_TYPE].get<std::string>().find(CMD_TYPE_INTERMODULE) != std::string::npos);
+    const bool intermodule_msg = (msg_routing_type.find(CMD_TYPE_INTERMODULE) != std::string::npos);
 
-    const int mt = jsonMessage[ANDRUAV_PROTOCOL_MESSAGE_TYPE].get<int>();
-    const Json ms = jsonMessage[ANDRUAV_PROTOCOL_MESSAGE_CMD];
-                
-    switch (mt)
+    const int mt = header.message_type;
+    latency_scope.setMessageType(mt);
+
+    // websocket writes of this message in this thread are counted against sender module.
+    statistics.countReceived(mt, stats_index, full_message_length);
+    comm::CMessageStatistics::CScope stats_scope(mt, stats_index);
+
+    // hash of ms identifies a module heartbeat that has not changed.
+    uint64_t ms_fingerprint = 0;
+    if ((mt == TYPE_AndruavModule_ID) && (header.ms != NULL))
     {
-        case TYPE_AndruavModule_ID:
+        ms_fingerprint = hash_fnv1a_64(header.ms, header.ms_length);
+        if (refreshModuleRegistration(ms_fingerprint, ssock)) return ;
+    }
+
+    if (needsFullParse(mt))
+    {
+        Json jsonMessage;
+        try
         {
-            const bool updated = handleModuleRegistration (ms, ssock);
-            
-            if (updated == true)
+            jsonMessage = Json::parse(frame.json, frame.json + header.json_length);
+        }
+        catch (...)
+        {
+            // corrupted message.
+            statistics.countParseError(stats_index);
+            return ;
+        }
+
+        processCommunicatorMessage(jsonMessage, mt, target_id, intermodule_msg, frame, ssock, ms_fingerprint);
+        return ;
+    }
+
+    if (header.has_module_key) // backward compatibility
+    {
+        processIncommingServerMessage (target_id, mt, full_message, full_message_length, header.module_key, &frame);
+    }
+    else if (intermodule_msg)
+    {
+        // local bus: delivered to subscribed modules except sender without a server round trip.
+        processIncommingServerMessage (target_id, mt, full_message, full_message_length, (sender_module != NULL) ? sender_module->module_key : std::string(), &frame);
+    }
+
+    if (intermodule_msg)
+    {   //CMD_TYPE_INTERMODULE exists then this message should be processed by other modules only. 
+        return ;
+    }
+
+    if (header.shm != NULL)
+    {
+        Json shm_descriptor;
+        try
+        {
+            shm_descriptor = Json::parse(header.shm, header.shm + header.shm_length);
+        }
+        catch (...)
+        {
+            statistics.countParseError(stats_index);
+            return ;
+        }
+        sendShmBinaryCMD(target_id, mt, shm_descriptor, Json(), true, (sender_module != NULL) ? sender_module->module_id : std::string());
+    }
+    else if (is_binary)
+    {    
+        // state-like messages are sent by coalescer keeping only the newest.
+        if (andruav_servers::CAndruavUplinkCoalescer::getInstance().offer(target_id, mt, frame.payload, frame.payload_length, true, stats_index, ingress_nsec)) return ;
+
+        andruav_servers::CAndruavCommServer::getInstance().API_sendBinaryCMD(target_id, mt, frame.payload, frame.payload_length, Json());            
+    }
+    else if (is_system)
+    {
+        Json ms;
+        if (header.ms != NULL)
+        {
+            try
+            {
+                ms = Json::parse(header.ms, header.ms + header.ms_length);
+            }
+            catch (...)
+            {
+                statistics.countParseError(stats_index);
+                return ;
+            }
+        }
+        andruav_servers::CAndruavCommServer::getInstance().API_sendSystemMessage(mt, ms);    
+    }
+    else 
+    {
+        // ms is forwarded as received.
+        if (andruav_servers::CAndruavUplinkCoalescer::getInstance().offer(target_id, mt, header.ms, header.ms_length, false, stats_index, ingress_nsec)) return ;
+
+        andruav_servers::CAndruavCommServer::getInstance().API_sendRawCMD(target_id, mt, header.ms, header.ms_length);            
+    }
+}
+
+
+/**
+ * @brief handle messages that communicator interprets itself. 
+ * @see needsFullParse
+ * 
+ * @param jsonMessage whole JSON part of message.
+ * @param mt 
+ * @param target_id 
+ * @param intermodule_msg 
+ * @param frame json & binary parts of message.
+ * @param ssock sender module address
+ * @param ms_fingerprint hash of "ms" text of TYPE_AndruavModule_ID.
+ */
+void CUavosModulesManager::processCommunicatorMessage (Json& jsonMessage, const int mt, const std::string& target_id, const bool intermodule_msg, const comm::MESSAGE_FRAME& frame, const SOCKET_ADDRESS* ssock, const uint64_t ms_fingerprint)
+{
+    const Json& ms = jsonMessage[ANDRUAV_PROTOCOL_MESSAGE_CMD];
+
+    switch (mt)
+    {
+        case TYPE_AndruavModule_ID:
+        {
+            const bool updated = handleModuleRegistration (ms, ssock, ms_fingerprint);
+            
+            if (updated == true)
             {
                 andruav_servers::CAndruavFacade::getInstance().API_sendID(target_id);
             }
@@ -634,7 +1144,26 @@ void CUavosModulesManager::parseIntermoduleMessage (const char * full_message, c
 
         case TYPE_AndruavModule_RemoteExecute:
         {   // this is an inter-module message.
-            processModuleRemoteExecute(ms);
+            const Json& correlation_id = jsonMessage.contains(JSON_INTERMODULE_CORRELATION_ID) ? jsonMessage[JSON_INTERMODULE_CORRELATION_ID] : Json();
+            processModuleRemoteExecute(ms, correlation_id, ssock);
+        }
+        break;
+
+        case TYPE_AndruavModule_Statistics:
+        {   // this is an inter-module message. reply is sent to asking module only.
+            const std::shared_ptr<const MODULE_REGISTRY_SNAPSHOT> registry = m_registry.acquire();
+            const MODULE_ADDRESS_ENTRY * sender_module = findSenderModule(*registry, ssock);
+            if (sender_module == NULL) break;
+            const std::string module_id = sender_module->module_id;
+
+            const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+            auto module_entry = m_modules_list.find(module_id);
+            if (module_entry == m_modules_list.end()) break;
+
+            const Json &msg = createJSONStatistics();
+            std::string msg_dump = msg.dump();
+            forwardMessageToModule(msg_dump.c_str(), msg_dump.length(), module_entry->second.get(), TYPE_AndruavModule_Statistics);
         }
         break;
 
@@ -646,6 +1175,8 @@ void CUavosModulesManager::parseIntermoduleMessage (const char * full_message, c
             */
             
             CAndruavUnitMe& m_andruavMe = CAndruavUnitMe::getInstance();
+            // modules can be served by different receiver threads.
+            const std::lock_guard<std::mutex> unit_lock(m_andruavMe.getLock());
             ANDRUAV_UNIT_LOCATION&  location_info = m_andruavMe.getUnitLocationInfo();
 
             location_info.latitude                      = ms["la"].get<int>();
@@ -668,23 +1199,28 @@ void CUavosModulesManager::parseIntermoduleMessage (const char * full_message, c
                 forwards a complete copy to Andruav-Server.
             */
             CAndruavUnitMe& m_andruavMe = CAndruavUnitMe::getInstance();
-            ANDRUAV_UNIT_INFO&  unit_info = m_andruavMe.getUnitInfo();
+            {
+                // modules can be served by different receiver threads.
+                const std::lock_guard<std::mutex> unit_lock(m_andruavMe.getLock());
+                ANDRUAV_UNIT_INFO&  unit_info = m_andruavMe.getUnitInfo();
             
-            unit_info.vehicle_type                  = ms["VT"].get<int>();
-            unit_info.flying_mode                   = ms["FM"].get<int>();
-            unit_info.gps_mode                      = ms["GM"].get<int>();
-            unit_info.use_fcb                       = ms["FI"].get<bool>();
-            unit_info.autopilot                     = ms["AP"].get<int>();
-            unit_info.is_armed                      = ms["AR"].get<bool>();
-            unit_info.is_flying                     = ms["FL"].get<bool>();
-            unit_info.telemetry_protocol            = ms["TP"].get<int>();
-            unit_info.flying_last_start_time        = ms["z"].get<long long>();
-            unit_info.flying_total_duration         = ms["a"].get<long long>();
-            unit_info.is_tracking_mode              = ms["b"].get<bool>();
-            unit_info.manual_TX_blocked_mode        = ms["C"].get<int>();
-            unit_info.is_gcs_blocked                = ms["B"].get<bool>();
-            unit_info.swarm_leader_formation        = ms["o"].get<int>();
-            unit_info.swarm_leader_I_am_following   = ms["q"].get<std::string>();
+                unit_info.vehicle_type                  = ms["VT"].get<int>();
+                unit_info.flying_mode                   = ms["FM"].get<int>();
+                unit_info.gps_mode                      = ms["GM"].get<int>();
+                unit_info.use_fcb                       = ms["FI"].get<bool>();
+                unit_info.autopilot                     = ms["AP"].get<int>();
+                unit_info.is_armed                      = ms["AR"].get<bool>();
+                unit_info.is_flying                     = ms["FL"].get<bool>();
+                unit_info.telemetry_protocol            = ms["TP"].get<int>();
+                unit_info.flying_last_start_time        = ms["z"].get<long long>();
+                unit_info.flying_total_duration         = ms["a"].get<long long>();
+                unit_info.is_tracking_mode              = ms["b"].get<bool>();
+                unit_info.manual_TX_blocked_mode        = ms["C"].get<int>();
+                unit_info.is_gcs_blocked                = ms["B"].get<bool>();
+                unit_info.swarm_leader_formation        = ms["o"].get<int>();
+                unit_info.swarm_leader_I_am_following   = ms["q"].get<std::string>();
+                m_andruavMe.touchUnitInfo();
+            }
 
             andruav_servers::CAndruavFacade::getInstance().API_sendID(std::string());
         }
@@ -692,17 +1228,31 @@ void CUavosModulesManager::parseIntermoduleMessage (const char * full_message, c
 
         case TYPE_AndruavMessage_IMG:
         { 
+            // shared memory rings are owned by the module sending their descriptors.
+            const std::shared_ptr<const MODULE_REGISTRY_SNAPSHOT> registry = m_registry.acquire();
+            const MODULE_ADDRESS_ENTRY * sender_module = findSenderModule(*registry, ssock);
+            const std::string producer_id = (sender_module != NULL) ? sender_module->module_id : std::string();
+
             if (!intermodule_msg)
             {
-                const char * binary_message = (char *)(memchr (full_message, 0x0, full_message_length));
-                int binary_length = binary_message==0?0:(full_message_length - (binary_message - full_message +1));
-                andruav_servers::CAndruavCommServer::getInstance().API_sendBinaryCMD(target_id, mt, &binary_message[1], binary_length, Json());   
+                if (jsonMessage.contains(INTERMODULE_SHM_DESCRIPTOR))
+                {
+                    sendShmBinaryCMD(target_id, mt, jsonMessage[INTERMODULE_SHM_DESCRIPTOR], Json(), true, producer_id);
+                    break;
+                }
+
+                andruav_servers::CAndruavCommServer::getInstance().API_sendBinaryCMD(target_id, mt, frame.payload, frame.payload_length, Json());   
 
                 break;
             }
             
             CAndruavUnitMe& m_andruavMe = CAndruavUnitMe::getInstance();
-            ANDRUAV_UNIT_LOCATION&  location_info = m_andruavMe.getUnitLocationInfo();
+            ANDRUAV_UNIT_LOCATION location_info;
+            {
+                // copied as it can be updated by another receiver thread.
+                const std::lock_guard<std::mutex> unit_lock(m_andruavMe.getLock());
+                location_info = m_andruavMe.getUnitLocationInfo();
+            }
 
             if (location_info.is_valid)
             {
@@ -714,9 +1264,15 @@ void CUavosModulesManager::parseIntermoduleMessage (const char * full_message, c
                 ms["alt"] = location_info.altitude;
                 ms["tim"] = get_time_usec();
                 
-                // binary_message is the image if exists.
-                const char * binary_message = (char *)(memchr (full_message, 0x0, full_message_length));
-                int binary_length = binary_message==0?0:(full_message_length - (binary_message - full_message +1));
+                if (jsonMessage.contains(INTERMODULE_SHM_DESCRIPTOR))
+                {
+                    sendShmBinaryCMD(target_id, mt, jsonMessage[INTERMODULE_SHM_DESCRIPTOR], ms, true, producer_id);
+                    break;
+                }
+
+                // binary_message is the image if exists. it starts after zero delimiter of legacy messages.
+                const char * binary_message = frame.payload;
+                int binary_length = frame.payload_length;
                 
                 // prepare an array for the whole message [text part length + delimiter 0 + binary length]
                 // const int string_length = json_msg.length();
@@ -740,59 +1296,162 @@ void CUavosModulesManager::parseIntermoduleMessage (const char * full_message, c
 
                 // binary_message_new.release();
             }
+            else if (jsonMessage.contains(INTERMODULE_SHM_DESCRIPTOR))
+            {
+                // image is dropped but its space in ring should be released.
+                sendShmBinaryCMD(target_id, mt, jsonMessage[INTERMODULE_SHM_DESCRIPTOR], Json(), false, producer_id);
+            }
         }
         break;
 
         default:
+        break;
+    }
+
+}
+
+void CUavosModulesManager::sendShmBinaryCMD (const std::string& target_id, const int mt, const Json& shm_descriptor, const Json& ms, const bool forward, const std::string& module_id)
+{
+    if ((!validateField(shm_descriptor, SHM_DESCRIPTOR_RING_NAME, Json::value_t::string))
+        || (!validateField(shm_descriptor, SHM_DESCRIPTOR_POSITION, Json::value_t::number_unsigned))
+        || (!validateField(shm_descriptor, SHM_DESCRIPTOR_LENGTH, Json::value_t::number_unsigned))
+        )
+    {
+        // bad descriptor format
+        return ;
+    }
+
+    const std::string ring_name = shm_descriptor[SHM_DESCRIPTOR_RING_NAME].get<std::string>();
+    const uint64_t position = shm_descriptor[SHM_DESCRIPTOR_POSITION].get<uint64_t>();
+    const uint64_t length = shm_descriptor[SHM_DESCRIPTOR_LENGTH].get<uint64_t>();
+
+    const std::lock_guard<std::mutex> lock(g_i_mutex_shm);
+
+    auto ring_item = m_shm_rings.find(ring_name);
+    if (ring_item == m_shm_rings.end())
+    {
+        std::unique_ptr<comm::CShmRing> ring = std::unique_ptr<comm::CShmRing>(new comm::CShmRing());
+        if (!ring->open(ring_name)) return ;
+        
+        ring_item = m_shm_rings.insert(std::make_pair(ring_name, MODULE_SHM_RING{module_id, std::move(ring)})).first;
+    }
+    else if (ring_item->second.module_id.empty())
+    {
+        ring_item->second.module_id = module_id;
+    }
+
+    comm::CShmRing * ring = ring_item->second.ring.get();
+
+    // producer has shrunk ring. reading old mapping would raise SIGBUS.
+    if (ring->isTruncated())
+    {
+        ring = reopenShmRing(ring_name);
+        if (ring == nullptr) return ;
+    }
+
+    if (validateField(shm_descriptor, SHM_DESCRIPTOR_SEQUENCE, Json::value_t::number_unsigned))
+    {
+        const uint64_t missed = ring->checkSequence(shm_descriptor[SHM_DESCRIPTOR_SEQUENCE].get<uint64_t>());
+        if (missed != 0)
         {
-            
-            if (jsonMessage.contains(INTERMODULE_MODULE_KEY)!=false) // backward compatibility
-            {
-                processIncommingServerMessage (target_id, mt, full_message, full_message_length, jsonMessage[INTERMODULE_MODULE_KEY].get<std::string>());
-            }
+            PLOG(plog::warning) << "Shared memory ring " << ring_name << " missed descriptors:" << missed;
+        }
+    }
 
-            if (intermodule_msg)
-            {   //CMD_TYPE_INTERMODULE exists then this message should be processed by other modules only. 
-                return ;
-            }
+    if (!forward)
+    {
+        ring->release(position, length);
+        return ;
+    }
 
-            if (is_binary)
-            {    
-                // search for char '0' and then binary message is the next byte after it.
-                const char * binary_message = (char *)(memchr (full_message, 0x0, full_message_length));
-                int binary_length = binary_message==0?0:(full_message_length - (binary_message - full_message +1));
-    
-                andruav_servers::CAndruavCommServer::getInstance().API_sendBinaryCMD(target_id, mt, &binary_message[1], binary_length, Json());            
-            }
-            else if (is_system)
-            {
-               andruav_servers::CAndruavCommServer::getInstance().API_sendSystemMessage(mt, ms);    
-            }
-            else 
-            {
-                andruav_servers::CAndruavCommServer::getInstance().API_sendCMD(target_id, mt, ms);            
-            }
-            
+    const char * payload = ring->acquire(position, length);
+    if ((payload == NULL) && (ring->isReplaced()))
+    {
+        // producer has recreated ring. descriptor refers to new one.
+        ring = reopenShmRing(ring_name);
+        if (ring == nullptr) return ;
+
+        payload = ring->acquire(position, length);
+    }
+
+    if (payload == NULL)
+    {
+        #ifdef DEBUG
+            std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: invalid shared memory descriptor " << shm_descriptor.dump() << _NORMAL_CONSOLE_TEXT_ << std::endl;
+        #endif
+        return ;
+    }
+
+    andruav_servers::CAndruavCommServer::getInstance().API_sendBinaryCMD(target_id, mt, payload, length, ms); 
+
+    ring->release(position, length);
+}
+
+
+comm::CShmRing * CUavosModulesManager::reopenShmRing (const std::string& ring_name)
+{
+    auto ring_item = m_shm_rings.find(ring_name);
+    if (ring_item == m_shm_rings.end()) return nullptr;
+
+    PLOG(plog::warning) << "Shared memory ring " << ring_name << " has been recreated by producer. mapping again.";
+
+    comm::CShmRing * ring = ring_item->second.ring.get();
+    if (!ring->open(ring_name))
+    {
+        m_shm_rings.erase(ring_item);
+        return nullptr;
+    }
+
+    return ring;
+}
+
+
+void CUavosModulesManager::closeModuleShmRings (const std::string& module_id)
+{
+    const std::lock_guard<std::mutex> lock(g_i_mutex_shm);
+
+    for (auto ring_item = m_shm_rings.begin(); ring_item != m_shm_rings.end();)
+    {
+        if (ring_item->second.module_id == module_id)
+        {
+            PLOG(plog::info) << "Shared memory ring " << ring_item->first << " of module " << module_id << " is closed.";
+            ring_item = m_shm_rings.erase(ring_item);
+        }
+        else
+        {
+            ++ring_item;
         }
-        break;
     }
-    
 }
 
+
 /**
  * @brief process requests from module to comm module.
+ * @details replies of a request from an unknown module are forwarded to all subscribed modules.
  * 
  * @param ms 
+ * @param correlation_id 
+ * @param ssock 
  */
-void CUavosModulesManager::processModuleRemoteExecute (const Json ms)
+void CUavosModulesManager::processModuleRemoteExecute (const Json& ms, const Json& correlation_id, const SOCKET_ADDRESS* ssock)
 {
     if (!validateField(ms, "C", Json::value_t::number_unsigned)) return ;
     const int cmd = ms["C"].get<int>();
+
+    const std::shared_ptr<const MODULE_REGISTRY_SNAPSHOT> registry = m_registry.acquire();
+    const MODULE_ADDRESS_ENTRY * sender_module = findSenderModule(*registry, ssock);
     
     switch (cmd)
     {
         case TYPE_AndruavSystem_LoadTasks:
         {
+            if ((sender_module != NULL) 
+                && (!addPendingRequest(sender_module->module_id, correlation_id, {TYPE_AndruavMessage_ExternalGeoFence, TYPE_AndruavMessage_UploadWayPoints})))
+            {
+                sendRequestRejection(sender_module->module_id, cmd, correlation_id, "too many requests waiting for replies");
+                break;
+            }
+
             andruav_servers::CAndruavFacade::getInstance().API_loadTasksByScope(andruav_servers::ENUM_TASK_SCOPE::SCOPE_GROUP, TYPE_AndruavMessage_ExternalGeoFence);
             andruav_servers::CAndruavFacade::getInstance().API_loadTasksByScope(andruav_servers::ENUM_TASK_SCOPE::SCOPE_GROUP, TYPE_AndruavMessage_UploadWayPoints);
         }
@@ -802,6 +1461,176 @@ void CUavosModulesManager::processModuleRemoteExecute (const Json ms)
 }
 
 
+bool CUavosModulesManager::addPendingRequest (const std::string& module_id, const Json& correlation_id, const std::set<int>& reply_message_types)
+{
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+    const uint64_t now = get_time_usec();
+    
+    std::size_t module_requests = 0;
+    for (const MODULE_PENDING_REQUEST& request : m_pending_requests)
+    {
+        if ((request.module_id == module_id) && (request.deadline > now)) module_requests++;
+    }
+
+    if (module_requests >= m_max_pending_requests)
+    {
+        PLOG(plog::warning) << "Request of module " << module_id << " is rejected. pending requests:" << module_requests;
+        
+        #ifdef DEBUG
+            std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _ERROR_CONSOLE_TEXT_ << "Request of module " << module_id << " is rejected" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+        #endif
+
+        return false;
+    }
+
+    MODULE_PENDING_REQUEST request;
+    request.module_id = module_id;
+    // only numbers & strings can be copied to replies.
+    if (correlation_id.is_number_integer() || correlation_id.is_string())
+    {
+        request.correlation_id = correlation_id.dump();
+    }
+    request.reply_message_types = reply_message_types;
+    request.deadline = now + m_request_timeout;
+
+    m_pending_requests.push_back(request);
+    m_pending_request_count.store(m_pending_requests.size());
+
+    return true;
+}
+
+
+void CUavosModulesManager::sendRequestRejection (const std::string& module_id, const int cmd, const Json& correlation_id, const std::string& description)
+{
+    Json jsonRejection;
+    jsonRejection[INTERMODULE_ROUTING_TYPE] = CMD_TYPE_INTERMODULE;
+    jsonRejection[ANDRUAV_PROTOCOL_MESSAGE_TYPE] = TYPE_AndruavMessage_Error;
+    if (correlation_id.is_number_integer() || correlation_id.is_string())
+    {
+        jsonRejection[JSON_INTERMODULE_CORRELATION_ID] = correlation_id;
+    }
+    // same fields as CAndruavFacade::API_sendErrorMessage. C is command of rejected request.
+    jsonRejection[ANDRUAV_PROTOCOL_MESSAGE_CMD] =
+    {
+        {"EN", 0},
+        {"IT", ERROR_TYPE_ERROR_MODULE},
+        {"NT", NOTIFICATION_TYPE_WARNING},
+        {"DS", description},
+        {"C", cmd}
+    };
+
+    const std::string msg_dump = jsonRejection.dump();
+
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+    auto module_entry = m_modules_list.find(module_id);
+    if (module_entry == m_modules_list.end()) return ;
+
+    forwardMessageToModule(msg_dump.c_str(), msg_dump.length(), module_entry->second.get(), TYPE_AndruavMessage_Error);
+}
+
+
+/**
+ * @brief copy of a legacy format message with JSON_INTERMODULE_CORRELATION_ID as its first field.
+ * 
+ * @param message 
+ * @param datalength 
+ * @param correlation_id JSON text of id.
+ * @param reply 
+ */
+static void insertCorrelationId (const char * message, const std::size_t datalength, const std::string& correlation_id, std::string& reply)
+{
+    const char * json_start = (const char *) memchr(message, '{', datalength);
+    if (json_start == NULL)
+    {
+        reply.assign(message, datalength);
+        return ;
+    }
+
+    const std::size_t position = json_start - message + 1;
+    const bool is_empty = (position < datalength) && (message[position] == '}');
+    
+    reply.clear();
+    reply.reserve(datalength + correlation_id.length() + 8);
+    reply.append(message, position);
+    reply.append("\"" JSON_INTERMODULE_CORRELATION_ID "\":");
+    reply.append(correlation_id);
+    if (!is_empty) reply.push_back(',');
+    reply.append(message + position, datalength - position);
+}
+
+
+void CUavosModulesManager::deliverRequestReply (const int message_type, const char * message, const std::size_t datalength, std::set<std::string>& replied_modules)
+{
+    if (m_pending_request_count.load(std::memory_order_relaxed) == 0) return ;
+
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+    const uint64_t now = get_time_usec();
+
+    // latest request of each module is used as replies are the same.
+    std::map<std::string, const MODULE_PENDING_REQUEST *> requests;
+    for (const MODULE_PENDING_REQUEST& request : m_pending_requests)
+    {
+        if (request.deadline <= now) continue;
+        if (request.reply_message_types.find(message_type) == request.reply_message_types.end()) continue;
+
+        requests[request.module_id] = &request;
+    }
+
+    std::string reply;
+    for (const auto& request : requests)
+    {
+        auto module_entry = m_modules_list.find(request.first);
+        if (module_entry == m_modules_list.end()) continue;
+
+        const MODULE_ITEM_TYPE * module_item = module_entry->second.get();
+        if ((module_item->is_dead) || (module_item->licence_status == ENUM_LICENCE::LICENSE_VERIFIED_BAD)) continue;
+
+        if (request.second->correlation_id.empty())
+        {
+            forwardMessageToModule(message, datalength, module_item, message_type);
+        }
+        else
+        {
+            insertCorrelationId(message, datalength, request.second->correlation_id, reply);
+            forwardMessageToModule(reply.c_str(), reply.length(), module_item, message_type);
+        }
+        
+        // if requesting module is gone it receives message as any other subscriber.
+        replied_modules.insert(module_item->module_id);
+    }
+}
+
+
+void CUavosModulesManager::handlePendingRequests ()
+{
+    if (m_pending_request_count.load(std::memory_order_relaxed) == 0) return ;
+
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+    const uint64_t now = get_time_usec();
+
+    m_pending_requests.erase(std::remove_if(m_pending_requests.begin(), m_pending_requests.end(), 
+        [now](const MODULE_PENDING_REQUEST& request)
+        {
+            return request.deadline <= now;
+        }), m_pending_requests.end());
+
+    m_pending_request_count.store(m_pending_requests.size());
+}
+
+
+void CUavosModulesManager::setRequestLimits (const uint64_t timeout_usec, const std::size_t max_pending)
+{
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+    m_request_timeout = timeout_usec;
+    m_max_pending_requests = max_pending;
+}
+
+
 /**
  * @brief Process messages comming from AndruavServer and forward it to subscribed modules.
  * 
@@ -809,41 +1638,118 @@ void CUavosModulesManager::processModuleRemoteExecute (const Json ms)
  * @param command_type 
  * @param jsonMessage 
  * @param sender_module_key when message is forwarded from another module then it is necessary not to send message back to the sender module. e.g. messages such as TYPE_AndruavMessage_RemoteExecute
+ * @param frame
+ * @param replied_modules modules that received message as a reply of their requests. they are skipped.
  */
-void CUavosModulesManager::processIncommingServerMessage (const std::string& sender_party_id, const int& message_type, const char * message, const std::size_t datalength, const std::string& sender_module_key)
+void CUavosModulesManager::processIncommingServerMessage (const std::string& sender_party_id, const int& message_type, const char * message, const std::size_t datalength, const std::string& sender_module_key, const comm::MESSAGE_FRAME * frame, const std::set<std::string> * replied_modules)
 {
-    const std::lock_guard<std::mutex> lock(g_i_mutex_process);
     #ifdef DEBUG
         std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: processIncommingServerMessage " << _NORMAL_CONSOLE_TEXT_ << std::endl;
     #endif
 
-    std::vector<std::string> &v = m_module_messages[message_type];
-    for(std::vector<std::string>::iterator it = v.begin(); it != v.end(); ++it) 
+    // snapshot is kept alive by this reference even if a new one is published meanwhile.
+    const std::shared_ptr<const MODULE_REGISTRY_SNAPSHOT> registry = m_registry.acquire();
+
+    // one copy of message in each format is shared by queues of all modules that receive it.
+    std::shared_ptr<const std::string> legacy_message;
+    std::shared_ptr<const std::string> framed_message;
+    
+    comm::MESSAGE_FRAME legacy_frame;
+    const bool is_framed = (frame != NULL) && (frame->is_framed);
+
+    comm::CMessageStatistics& statistics = comm::CMessageStatistics::getInstance();
+
+    const MODULE_ROUTE_LIST& routes = registry->routing_table.getRoutes(message_type);
+
+    // one send to multicast group reaches all modules that joined it.
+    std::shared_ptr<CModuleOutboundQueue> multicast_queue;
+    if (!registry->multicast_queues.empty())
+    {
+        const auto multicast_group = registry->multicast_queues.find(message_type);
+        if (multicast_group != registry->multicast_queues.end())
+        {
+            multicast_queue = multicast_group->second;
+            
+            // sender or a replied module is a member and should not receive message again so members are sent to one by one.
+            for (const MODULE_ROUTE& route : routes)
+            {
+                if ((route.multicast) && ((isSenderModule(route, sender_module_key)) || (isRepliedModule(route, replied_modules))))
+                {
+                    multicast_queue.reset();
+                    break;
+                }
+            }
+        }
+    }
+    bool multicast_sent = false;
+
+    for (const MODULE_ROUTE& route : routes) 
     {
         #ifdef DEBUG
-            std::cout << *it << std::endl;
+            std::cout << route.module_id << std::endl;
         #endif
         
-        auto uavos_module = m_modules_list.find(*it);
-        if (uavos_module == m_modules_list.end()) 
+        // alert is sent once by applyLicenseVerdict when licence turns bad. other subscribers still receive message.
+        if (route.licence_bad) continue;
+        
+        if (isSenderModule(route, sender_module_key)) continue;
+        if (isRepliedModule(route, replied_modules)) continue;
+
+        // clear to send
+        // multicast groups carry legacy format only.
+        const bool via_multicast = (route.multicast) && (multicast_queue);
+        if ((route.framed) && (!via_multicast))
         {
-            // no module is registered for this message.
-            std::cout << _ERROR_CONSOLE_BOLD_TEXT_ << "Module " << *it  << " for message " << message_type << " is not available" << _NORMAL_CONSOLE_TEXT_ << std::endl;
-            
-            continue;
+            if (!framed_message)
+            {
+                if (is_framed)
+                {
+                    framed_message = std::make_shared<const std::string>(message, datalength);
+                }
+                else
+                {
+                    if (frame == NULL)
+                    {
+                        comm::decodeLegacyMessage(message, datalength, legacy_frame);
+                        frame = &legacy_frame;
+                    }
+                    std::shared_ptr<std::string> encoded = std::make_shared<std::string>();
+                    comm::encodeFrame(*frame, *encoded);
+                    framed_message = encoded;
+                }
+            }
+            statistics.countSent(message_type, route.stats_index, framed_message->length());
+            CUavosModuleDispatcher::getInstance().enqueue(route.outbound_queue, framed_message);
         }
         else
         {
-            
-            MODULE_ITEM_TYPE * module_item = uavos_module->second.get();        
-            if  (module_item->licence_status == LICENSE_VERIFIED_BAD)
+            if (!legacy_message)
             {
-                andruav_servers::CAndruavFacade::getInstance().API_sendErrorMessage(std::string(), 0, ERROR_TYPE_ERROR_MODULE, NOTIFICATION_TYPE_ALERT, std::string("Module " + module_item->module_id + " is not allowed to run."));
-                break;
-            } else if ((module_item->is_dead == false) && ((sender_module_key.empty()) || (module_item->module_key.find(sender_module_key)==std::string::npos)))
+                if (is_framed)
+                {
+                    std::shared_ptr<std::string> encoded = std::make_shared<std::string>();
+                    comm::encodeLegacyMessage(*frame, *encoded);
+                    legacy_message = encoded;
+                }
+                else
+                {
+                    legacy_message = std::make_shared<const std::string>(message, datalength);
+                }
+            }
+            if (via_multicast)
+            {
+                if (!multicast_sent)
+                {
+                    // one datagram for all members. counted against communicator as it is not sent to a single module.
+                    statistics.countSent(message_type, 0, legacy_message->length());
+                    CUavosModuleDispatcher::getInstance().enqueue(multicast_queue, legacy_message);
+                    multicast_sent = true;
+                }
+            }
+            else
             {
-                // clear to send
-                forwardMessageToModule (message, datalength, module_item);
+                statistics.countSent(message_type, route.stats_index, legacy_message->length());
+                CUavosModuleDispatcher::getInstance().enqueue(route.outbound_queue, legacy_message);
             }
         }
     }
@@ -856,28 +1762,232 @@ void CUavosModulesManager::processIncommingServerMessage (const std::string& sen
  * @brief forward a message from Andruav Serveror inter-module to a module.
  * Normally this module is subscribed in this message id.
  * 
- * @param jsonMessage 
+ * @param message legacy format message.
  * @param module_item 
+ * @param message_type counted in traffic statistics.
  */
-void CUavosModulesManager::forwardMessageToModule ( const char * message, const std::size_t datalength, const MODULE_ITEM_TYPE * module_item)
+void CUavosModulesManager::forwardMessageToModule ( const char * message, const std::size_t datalength, const MODULE_ITEM_TYPE * module_item, const int message_type)
 {
     #ifdef DEBUG
         std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: forwardMessageToModule: " << message << _NORMAL_CONSOLE_TEXT_ << std::endl;
     #endif
 
+    std::shared_ptr<std::string> module_message;
+    if (module_item->frame_version != 0)
+    {
+        comm::MESSAGE_FRAME frame;
+        comm::decodeLegacyMessage(message, datalength, frame);
+        module_message = std::make_shared<std::string>();
+        comm::encodeFrame(frame, *module_message);
+    }
+    else
+    {
+        module_message = std::make_shared<std::string>(message, datalength);
+    }
+
+    comm::CMessageStatistics::getInstance().countSent(message_type, module_item->stats_index, module_message->length());
     
-    //const Json &msg = createJSONID(false);
-    struct sockaddr_in module_address = *module_item->m_module_address.get();  
-                
-    comm::CUDPCommunicator::getInstance().SendMsg(message, datalength, &module_address);
+    // queued so a slow module cannot delay the caller. never waits for space as g_i_mutex is held.
+    CUavosModuleDispatcher::getInstance().enqueue(module_item->m_outbound_queue, module_message, false);
 
     return ;
 }
 
 /**
-* @brief Check m_modules_list for dead modules that recieved no data.
+ * @brief module timeout based on its class. the longest matching class prefix is used.
+ * 
+ * @param module_class 
+ * @return uint64_t usec
+ */
+uint64_t CUavosModulesManager::getModuleTimeout (const std::string& module_class) const
+{
+    uint64_t timeout = MODULE_TIME_OUT;
+    std::size_t matched_length = 0;
+    for (const auto& class_timeout : m_module_class_timeouts)
+    {
+        if ((module_class.find(class_timeout.first)==0) && (class_timeout.first.length() >= matched_length))
+        {
+            timeout = class_timeout.second;
+            matched_length = class_timeout.first.length();
+        }
+    }
+
+    return timeout;
+}
+
+
+const MODULE_ADDRESS_ENTRY * CUavosModulesManager::findSenderModule (const MODULE_REGISTRY_SNAPSHOT& registry, const SOCKET_ADDRESS* ssock)
+{
+    if (ssock == NULL) return NULL;
+
+    const auto candidates = registry.address_index.equal_range(hashModuleAddress(*ssock));
+    for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+    {
+        const MODULE_ADDRESS_ENTRY& module_address = registry.module_addresses[candidate->second];
+        if ((module_address.address.length == ssock->length)
+            && (memcmp(&module_address.address.address, &ssock->address, ssock->length) == 0))
+        {
+            return &module_address;
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief counters of a module or message type and their rates per second since previous snapshot.
+ * 
+ */
+static Json createJSONTrafficCounters (const comm::TRAFFIC_COUNTERS& counters, const comm::TRAFFIC_COUNTERS * previous, const uint64_t interval_usec)
+{
+    const auto rate = [&](const int counter) -> uint64_t
+    {
+        if ((previous == NULL) || (interval_usec == 0)) return 0;
+        return (counters.counters[counter] - previous->counters[counter]) * 1000000 / interval_usec;
+    };
+
+    return
+    {
+        {"rx", counters.counters[comm::STATS_RX_MESSAGES]},
+        {"rb", counters.counters[comm::STATS_RX_BYTES]},
+        {"tx", counters.counters[comm::STATS_TX_MESSAGES]},
+        {"tb", counters.counters[comm::STATS_TX_BYTES]},
+        {"ux", counters.counters[comm::STATS_UPLINK_MESSAGES]},
+        {"ub", counters.counters[comm::STATS_UPLINK_BYTES]},
+        {"pe", counters.counters[comm::STATS_PARSE_ERRORS]},
+        // per second
+        {"rr", rate(comm::STATS_RX_BYTES)},
+        {"tr", rate(comm::STATS_TX_BYTES)},
+        {"ur", rate(comm::STATS_UPLINK_BYTES)}
+    };
+}
+
+
+Json CUavosModulesManager::createJSONStatistics ()
+{
+    comm::CMessageStatistics& statistics = comm::CMessageStatistics::getInstance();
+    
+    std::shared_ptr<const comm::TRAFFIC_SNAPSHOT> snapshot = statistics.getSnapshot();
+    if (!snapshot)
+    {
+        // no periodic snapshot yet.
+        statistics.takeSnapshot();
+        snapshot = statistics.getSnapshot();
+    }
+    const std::shared_ptr<const comm::TRAFFIC_SNAPSHOT> previous = statistics.getPreviousSnapshot();
+    const uint64_t interval_usec = previous ? (snapshot->time_usec - previous->time_usec) : 0;
+
+    Json modules = Json::array();
+    for (const auto& uavos_module : m_modules_list)
+    {
+        const MODULE_ITEM_TYPE * module_item = uavos_module.second.get();
+        const int index = module_item->stats_index;
+
+        Json module_counters = createJSONTrafficCounters(snapshot->modules[index], previous ? &previous->modules[index] : NULL, interval_usec);
+        module_counters["i"] = module_item->module_id;
+        if (index == 0)
+        {
+            // counted with communicator as statistics limit is reached.
+            module_counters["s"] = true;
+        }
+        if (module_item->m_outbound_queue)
+        {
+            module_counters["qd"] = module_item->m_outbound_queue->getCounters().dropped;
+        }
+        modules.push_back(module_counters);
+    }
+
+    Json message_types = Json::array();
+    for (const auto& message_type : snapshot->message_types)
+    {
+        const comm::TRAFFIC_COUNTERS * previous_counters = NULL;
+        if (previous)
+        {
+            auto previous_entry = previous->message_types.find(message_type.first);
+            if (previous_entry != previous->message_types.end()) previous_counters = &previous_entry->second;
+        }
+
+        Json message_type_counters = createJSONTrafficCounters(message_type.second, previous_counters, interval_usec);
+        message_type_counters["mt"] = message_type.first;
+        message_types.push_back(message_type_counters);
+    }
+
+    Json jsonStatistics;
+    jsonStatistics[INTERMODULE_ROUTING_TYPE] = CMD_TYPE_INTERMODULE;
+    jsonStatistics[ANDRUAV_PROTOCOL_MESSAGE_TYPE] = TYPE_AndruavModule_Statistics;
+    jsonStatistics[ANDRUAV_PROTOCOL_MESSAGE_CMD] =
+    {
+        {"t", snapshot->time_usec},
+        {"d", interval_usec},
+        {"m", modules},
+        // communicator itself & unknown senders.
+        {"c", createJSONTrafficCounters(snapshot->modules[0], previous ? &previous->modules[0] : NULL, interval_usec)},
+        {"y", message_types},
+        {"e", snapshot->uplink_write_errors}
+    };
+
+    return jsonStatistics;
+}
+
+
+void CUavosModulesManager::setMulticastGroups (const std::string& group_address, const int port, const std::vector<int>& message_types, const std::size_t min_subscribers)
+{
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+    m_multicast_min_subscribers = std::max<std::size_t>(min_subscribers, 1);
+
+    int group_port = port;
+    for (const int message_type : message_types)
+    {
+        if (m_multicast_groups.find(message_type) != m_multicast_groups.end()) continue;
+
+        MODULE_MULTICAST_GROUP group;
+        group.message_type  = message_type;
+        group.group_address = group_address;
+        group.port          = group_port++;
+        
+        struct sockaddr_in * address = (struct sockaddr_in *) &group.address.address;
+        memset(&group.address, 0, sizeof(SOCKET_ADDRESS));
+        address->sin_family         = AF_INET;
+        address->sin_port           = htons(group.port);
+        address->sin_addr.s_addr    = inet_addr(group_address.c_str());
+        group.address.length        = sizeof(struct sockaddr_in);
+
+        m_multicast_groups.insert(std::make_pair(message_type, group));
+    }
+}
+
+
+void CUavosModulesManager::setModuleClassTimeout (const std::string& module_class, const uint64_t timeout_usec)
+{
+    const std::lock_guard<std::mutex> lock(g_i_mutex);
+
+    m_module_class_timeouts[module_class] = timeout_usec;
+}
+
+
+/**
+ * @brief add module to liveness wheel at its deadline if not already there.
+ * @details called under g_i_mutex.
+ * 
+ * @param module_item 
+ */
+void CUavosModulesManager::scheduleLiveness (MODULE_ITEM_TYPE * module_item)
+{
+    if (module_item->liveness_scheduled) return ;
+
+    module_item->liveness_scheduled = true;
+    m_liveness_wheel.schedule(module_item, module_item->module_last_access_time + module_item->module_timeout);
+}
+
+
+/**
+* @brief Check modules whose liveness deadline is reached for dead modules that recieved no data.
 * *Note: that restarted modules have the same ID not the same Key.... 
 * * so restarted modules does overwrite old instances..
+* @details modules that sent TYPE_AndruavModule_ID meanwhile are scheduled again at their new deadline.
+* dead modules are back online when they register again.
 * 
 * @return true found new dead modules.... already dead modules are not counted.
 * @return false no dead modules.
@@ -889,61 +1999,62 @@ bool CUavosModulesManager::handleDeadModules ()
     
     bool dead_found = false;
 
-    const uint64_t &now = get_time_usec();
+    const uint64_t &now = get_monotonic_time_usec();
     
-    MODULE_ITEM_LIST::iterator it;
+    m_liveness_due.clear();
+    m_liveness_wheel.advance(now, m_liveness_due);
     
-    for (it = m_modules_list.begin(); it != m_modules_list.end(); it++)
+    for (MODULE_ITEM_TYPE * module_item : m_liveness_due)
     {
-        MODULE_ITEM_TYPE * module_item = it->second.get();
-        const uint64_t diff =  (now - module_item->module_last_access_time);
+        const uint64_t deadline = module_item->module_last_access_time + module_item->module_timeout;
 
-        if (diff > MODULE_TIME_OUT)
+        if (deadline > now)
         {
-            
-            if (!module_item->is_dead)
-            {
-                //TODO Event Module Warning
-                module_item->is_dead = true;
-                dead_found = true;
-                if (m_status.is_online())
-                {
-                    andruav_servers::CAndruavFacade::getInstance().API_sendErrorMessage(std::string(), 0, ERROR_TYPE_ERROR_MODULE, NOTIFICATION_TYPE_EMERGENCY, std::string("Module " + module_item->module_id + " is not responding."));
-                }
-
-                if (module_item->module_class.find("fcb")==0)
-                {
-                    CAndruavUnitMe& andruav_unit_me = CAndruavUnitMe::getInstance();
-                    ANDRUAV_UNIT_INFO& andruav_unit_info = andruav_unit_me.getUnitInfo();
-                    andruav_unit_info.use_fcb = false;
-                    m_status.is_fcb_module_connected (false); //TODO: fix when offline
-                }
-                else if (module_item->module_class.find("camera")==0)
-                {
-                    CAndruavUnitMe& andruav_unit_me = CAndruavUnitMe::getInstance();
-                    ANDRUAV_UNIT_INFO& andruav_unit_info = andruav_unit_me.getUnitInfo();
-                    andruav_unit_info.use_fcb = false;
-                    m_status.is_camera_module_connected (false); //TODO: fix when offline
-                }
-            }
+            m_liveness_wheel.schedule(module_item, deadline);
+            continue;
         }
-        else
+
+        module_item->liveness_scheduled = false;
+        
+        if (module_item->is_dead) continue;
+
+        //TODO Event Module Warning
+        module_item->is_dead = true;
+        dead_found = true;
+        closeModuleShmRings(module_item->module_id);
+        // created again when module registers again.
+        CUavosModuleDispatcher::getInstance().removeQueue(module_item->m_outbound_queue);
+        module_item->m_outbound_queue.reset();
+        if (m_status.is_online())
         {
-            if (module_item->is_dead)
-            {
-                //This should not happen as is_dead = false is done when receiving any message from a module. 
-                //because you dont want running consequence operation on a dead module.
-                module_item->is_dead = false;
-                if (m_status.is_online())
-                {
-                    andruav_servers::CAndruavFacade::getInstance().API_sendErrorMessage(std::string(), 0, ERROR_TYPE_ERROR_MODULE, NOTIFICATION_TYPE_NOTICE, std::string("Module " + module_item->module_id + " is back online."));
-                }
-            }
-            
+            andruav_servers::CAndruavFacade::getInstance().API_sendErrorMessage(std::string(), 0, ERROR_TYPE_ERROR_MODULE, NOTIFICATION_TYPE_EMERGENCY, std::string("Module " + module_item->module_id + " is not responding."));
         }
 
+        if (module_item->module_class.find("fcb")==0)
+        {
+            CAndruavUnitMe& andruav_unit_me = CAndruavUnitMe::getInstance();
+            const std::lock_guard<std::mutex> unit_lock(andruav_unit_me.getLock());
+            ANDRUAV_UNIT_INFO& andruav_unit_info = andruav_unit_me.getUnitInfo();
+            andruav_unit_info.use_fcb = false;
+            andruav_unit_me.touchUnitInfo();
+            m_status.is_fcb_module_connected (false); //TODO: fix when offline
+        }
+        else if (module_item->module_class.find("camera")==0)
+        {
+            CAndruavUnitMe& andruav_unit_me = CAndruavUnitMe::getInstance();
+            const std::lock_guard<std::mutex> unit_lock(andruav_unit_me.getLock());
+            ANDRUAV_UNIT_INFO& andruav_unit_info = andruav_unit_me.getUnitInfo();
+            andruav_unit_info.use_fcb = false;
+            andruav_unit_me.touchUnitInfo();
+            m_status.is_camera_module_connected (false); //TODO: fix when offline
+        }
     }
     
+    if (dead_found)
+    {
+        publishRegistry();
+    }
+
     return dead_found;
 }
 
@@ -966,32 +2077,18 @@ void CUavosModulesManager::handleOnAndruavServerConnection (const int status)
         MODULE_ITEM_TYPE * module_item = it->second.get();
 
 
-        forwardMessageToModule(msg_dump.c_str(), msg_dump.length(),module_item);
+        forwardMessageToModule(msg_dump.c_str(), msg_dump.length(),module_item, TYPE_AndruavModule_ID);
     }
 }
 
 
 Json CUavosModulesManager::getModuleListAsJSON ()
 {
-    Json modules = Json::array();
-    
-    MODULE_ITEM_LIST::iterator it;
-    const std::lock_guard<std::mutex> lock(g_i_mutex);
-    
-    for (it = m_modules_list.begin(); it != m_modules_list.end(); it++)
-    {
-        MODULE_ITEM_TYPE * module_item = it->second.get();
+    return m_registry.acquire()->module_list;
+}
 
-        Json json_module_entry =
-        {
-            // check uavos_camera_plugin
-            {"v", module_item->version},
-            {"i", module_item->module_id},
-            {"c", module_item->module_class},
-            {"t", module_item->time_stamp},
-        };
-        modules.push_back(json_module_entry);
-    }
 
-    return modules;
+uint64_t CUavosModulesManager::getRegistryVersion () const
+{
+    return m_registry.getVersion();
 }
\ No newline at end of file
@@ -2,25 +2,47 @@
 #define UAVOS_MODULES_MANAGER_H_
 
 #include <iostream>
+#include <atomic>
 #include <sys/socket.h> 
 #include <arpa/inet.h> 
 #include <netinet/in.h> 
 #include <ctime>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <memory> 
 #include <vector> 
 #include <sys/socket.h>
 
 
 #include "../helpers/json.hpp"
+#include "../helpers/helpers.hpp"
 using Json = nlohmann::json;
 
 #include "../global.hpp"
+#include "../udpCommunicator.hpp"
+#include "../shmRing.hpp"
+#include "../messageFrame.hpp"
+#include "../messageStatistics.hpp"
+#include "uavos_module_dispatcher.hpp"
+#include "uavos_routing_table.hpp"
+#include "uavos_timing_wheel.hpp"
+#include "uavos_snapshot_handoff.hpp"
 #include "../status.hpp"
 
-// 5 seconds
+// 5 seconds. default time without TYPE_AndruavModule_ID before a module is dead.
 #define MODULE_TIME_OUT  5000000
 
+// liveness is checked with this resolution. death is detected at most one tick after timeout.
+#define MODULE_LIVENESS_TICK_USEC       100000
+// wheel covers 12.8 seconds per turn.
+#define MODULE_LIVENESS_WHEEL_SLOTS     128
+
+// 3 seconds. default time server messages of reply types are sent to requesting module with its correlation id.
+#define MODULE_REQUEST_TIME_OUT         3000000
+// default requests of a module waiting for replies. more requests are rejected.
+#define MODULE_MAX_PENDING_REQUESTS     4
+
 enum ENUM_LICENCE 
 {
     // licence exists and verified
@@ -46,10 +68,29 @@ typedef struct
     std::string hardware_serial;
     std::string version;
     int hardware_type;
+    // monotonic time of last TYPE_AndruavModule_ID. @see get_monotonic_time_usec
     uint64_t module_last_access_time = 0;
+    // time allowed between TYPE_AndruavModule_ID based on module class.
+    uint64_t module_timeout = MODULE_TIME_OUT;
+    // module is in liveness wheel.
+    bool liveness_scheduled = false;
     bool is_dead = false;
     ENUM_LICENCE licence_status = ENUM_LICENCE::LICENSE_NO_DATA;
-    std::unique_ptr<struct sockaddr_in> m_module_address;
+    // licence_status is taken from an old cached verdict and should be verified again.
+    bool licence_revalidate = false;
+    std::unique_ptr<SOCKET_ADDRESS> m_module_address;
+    // messages waiting to be sent to this module.
+    std::shared_ptr<uavos::CModuleOutboundQueue> m_outbound_queue;
+    // hash of "ms" text of last TYPE_AndruavModule_ID. same hash means nothing has changed.
+    uint64_t registration_fingerprint = 0;
+    // highest frame version module accepts. 0 means legacy messages only.
+    int frame_version = 0;
+    // last TYPE_AndruavModule_ID asked for communicator ID.
+    bool resend_requested = false;
+    // traffic counters of this module. @see CMessageStatistics::registerModule
+    int stats_index = 0;
+    // message types whose multicast groups module has joined.
+    std::set<int> multicast_joined;
     std::time_t time_stamp = 0;
 } MODULE_ITEM_TYPE;
 
@@ -57,7 +98,6 @@ typedef struct
 typedef struct 
 {
     std::string module_id;
-    Json camera_entry;      //[Active, id, ln, p, r , v]
     std::string global_index;  // id
     std::string logical_name;
     bool is_recording;
@@ -76,9 +116,105 @@ typedef struct
 typedef std::map <std::string, std::unique_ptr<MODULE_ITEM_TYPE>> MODULE_ITEM_LIST;
 
 
-typedef std::map <std::string, std::unique_ptr<std::map 
-                              <std::string,std::unique_ptr
-                              <MODULE_CAMERA_ENTRY>>>> MODULE_CAMERA_LIST;
+/**
+ * @brief camera devices of all camera modules stored contiguously.
+ * @details sorted by module_id then global_index.
+ * 
+ */
+typedef std::vector <MODULE_CAMERA_ENTRY> MODULE_CAMERA_LIST;
+
+
+/**
+ * @brief read-only camera list ready to be sent.
+ * 
+ */
+typedef struct
+{
+    // incremented whenever a camera is added, removed or changed.
+    uint64_t version = 0;
+    // JSON text of camera array [{active, id, ln, p, r, v}, ...]
+    std::string camera_list_text = "[]";
+} CAMERA_LIST_SNAPSHOT;
+
+
+/**
+ * @brief loopback multicast group of a message type.
+ * @details group carries legacy format messages. @see CUavosModulesManager::setMulticastGroups
+ * 
+ */
+typedef struct
+{
+    int message_type;
+    std::string group_address;
+    int port;
+    SOCKET_ADDRESS address;
+    // created when group is used for first time.
+    std::shared_ptr<uavos::CModuleOutboundQueue> outbound_queue;
+} MODULE_MULTICAST_GROUP;
+
+
+/**
+ * @brief shared memory ring mapped for a producer module.
+ * 
+ */
+typedef struct
+{
+    // module that sent descriptors of this ring. ring is closed when module dies.
+    std::string module_id;
+    std::unique_ptr<uavos::comm::CShmRing> ring;
+} MODULE_SHM_RING;
+
+
+/**
+ * @brief address of a module used to identify sender of a message.
+ * 
+ */
+typedef struct
+{
+    SOCKET_ADDRESS address;
+    std::string module_id;
+    std::string module_key;
+    // @see CMessageStatistics::registerModule
+    int stats_index;
+} MODULE_ADDRESS_ENTRY;
+
+
+/**
+ * @brief request executed by communicator on behalf of a module e.g. TYPE_AndruavSystem_LoadTasks.
+ * @details server messages of reply_message_types are sent to requesting module with its correlation id till deadline.
+ * other subscribed modules receive them as usual.
+ * 
+ */
+typedef struct
+{
+    std::string module_id;
+    // JSON text of JSON_INTERMODULE_CORRELATION_ID of request. empty if module has not sent one.
+    std::string correlation_id;
+    std::set<int> reply_message_types;
+    uint64_t deadline;
+} MODULE_PENDING_REQUEST;
+
+
+/**
+ * @brief read-only copy of registered modules.
+ * @details a new copy is published whenever modules change. @see CSnapshotHandoff
+ * 
+ */
+typedef struct
+{
+    // live subscribers of each message type.
+    uavos::CModuleRoutingTable routing_table;
+    // @see CUavosModulesManager::getModuleListAsJSON
+    Json module_list = Json::array();
+    // all modules including dead ones. used to find sender of a message.
+    std::vector<MODULE_ADDRESS_ENTRY> module_addresses;
+    // index of module_addresses by hash of address.
+    std::unordered_multimap<uint64_t, std::size_t> address_index;
+    // queues of multicast groups in use mapped by message type.
+    std::unordered_map<int, std::shared_ptr<uavos::CModuleOutboundQueue>> multicast_queues;
+    // incremented with each published snapshot.
+    uint64_t version = 0;
+} MODULE_REGISTRY_SNAPSHOT;
 
 namespace uavos
 {
@@ -109,35 +245,182 @@ namespace uavos
             
             ~CUavosModulesManager ();
            
-            void parseIntermoduleMessage (const char * full_mesage, const std::size_t full_message_length, const struct sockaddr_in* ssock);
+            /**
+             * @brief handle a message received from a module.
+             * 
+             * @param full_mesage 
+             * @param full_message_length 
+             * @param ssock sender module address (ip & port or unix path)
+             * @param ingress_nsec kernel receive time. latency till written to server is recorded per message type.
+             */
+            void parseIntermoduleMessage (const char * full_mesage, const std::size_t full_message_length, const SOCKET_ADDRESS* ssock, const uint64_t ingress_nsec);
             Json createJSONID (const bool& reSend);
             
-            void processModuleRemoteExecute (const Json ms);
-            void processIncommingServerMessage (const std::string& sender_party_id, const int& message_type, const char * message, const std::size_t datalength, const std::string& sender_module_key);
-            void forwardMessageToModule (const char * message, const std::size_t datalength, const MODULE_ITEM_TYPE * module_item);
+            /**
+             * @brief execute a request of a module. replies are sent to requesting module with its correlation id.
+             * @details a module that has too many requests waiting for replies receives TYPE_AndruavMessage_Error instead.
+             * 
+             * @param ms 
+             * @param correlation_id JSON_INTERMODULE_CORRELATION_ID of request. null if not sent.
+             * @param ssock requesting module address
+             */
+            void processModuleRemoteExecute (const Json& ms, const Json& correlation_id, const SOCKET_ADDRESS* ssock);
+
+            /**
+             * @brief send a server message to modules waiting for it as a reply of their requests.
+             * @details JSON_INTERMODULE_CORRELATION_ID of each request is added to its copy of message.
+             * server does not echo correlation ids so any message of a reply type within request timeout is a reply.
+             * message should still be forwarded to subscribed modules except replied_modules.
+             * 
+             * @param message_type 
+             * @param message legacy format message.
+             * @param datalength 
+             * @param replied_modules ids of modules that received message as a reply.
+             */
+            void deliverRequestReply (const int message_type, const char * message, const std::size_t datalength, std::set<std::string>& replied_modules);
+
+            /**
+             * @brief remove requests whose replies are no longer expected. should be called every MODULE_LIVENESS_TICK_USEC.
+             * 
+             */
+            void handlePendingRequests();
+
+            /**
+             * @brief how long replies are expected and how many requests a module can have waiting for replies.
+             * 
+             * @param timeout_usec 
+             * @param max_pending 
+             */
+            void setRequestLimits (const uint64_t timeout_usec, const std::size_t max_pending);
+            /**
+             * @brief forward a message to modules subscribed to its type.
+             * 
+             * @param sender_party_id 
+             * @param message_type 
+             * @param message 
+             * @param datalength 
+             * @param sender_module_key 
+             * @param frame parts of message if already located. message is legacy format if NULL.
+             * @param replied_modules modules that already received message. @see deliverRequestReply
+             */
+            void processIncommingServerMessage (const std::string& sender_party_id, const int& message_type, const char * message, const std::size_t datalength, const std::string& sender_module_key, const comm::MESSAGE_FRAME * frame = NULL, const std::set<std::string> * replied_modules = NULL);
+            void forwardMessageToModule (const char * message, const std::size_t datalength, const MODULE_ITEM_TYPE * module_item, const int message_type);
             
             /**
-             * @brief Get the Camera List object that defines all camera devices attached to all camera modules.
+             * @brief Get the Camera List that defines all camera devices attached to all camera modules.
+             * @details list is serialized once per change so it can be sent without locking or rebuilding.
              * 
-             * @return Json 
+             * @return std::shared_ptr<const CAMERA_LIST_SNAPSHOT> 
              */
-            Json getCameraList();
+            std::shared_ptr<const CAMERA_LIST_SNAPSHOT> getCameraList() const;
 
+            /**
+             * @brief mark modules that have not sent TYPE_AndruavModule_ID within their timeout as dead.
+             * @details should be called every MODULE_LIVENESS_TICK_USEC. only modules whose deadline is reached are checked.
+             * 
+             * @return true found new dead modules.
+             */
             bool handleDeadModules();
 
+            /**
+             * @brief timeout of modules whose class starts with module_class. e.g. "fcb"
+             * @details applied to modules registered after this call.
+             * 
+             * @param module_class 
+             * @param timeout_usec 
+             */
+            void setModuleClassTimeout (const std::string& module_class, const uint64_t timeout_usec);
+
+            /**
+             * @brief message types sent once to a loopback multicast group instead of once per subscriber.
+             * @details groups are announced in TYPE_AndruavModule_ID. a message type is multicast when at least 
+             * min_subscribers of its subscribers joined its group. others still receive it by unicast.
+             * groups carry legacy format messages even to modules that asked for framed messages.
+             * should be called before modules register. 
+             * 
+             * @param group_address first group address. each message type uses next port.
+             * @param port port of first message type.
+             * @param message_types 
+             * @param min_subscribers 
+             */
+            void setMulticastGroups (const std::string& group_address, const int port, const std::vector<int>& message_types, const std::size_t min_subscribers);
+
             void handleOnAndruavServerConnection (const int status);
             
             Json getModuleListAsJSON();
 
+            /**
+             * @brief changes whenever a new registry snapshot is published.
+             * @details used to know if @link getModuleListAsJSON @endlink has changed.
+             * 
+             * @return uint64_t 
+             */
+            uint64_t getRegistryVersion () const;
+
+            void handleLicenseVerified (const std::string& hardware_serial, const int hardware_type, const bool valid, const bool replied);
+
         private:
 
-            bool handleModuleRegistration (const Json& msg_cmd, const struct sockaddr_in* ssock);
+            /**
+             * @brief messages that communicator interprets itself. @see needsFullParse
+             * 
+             */
+            void processCommunicatorMessage (Json& jsonMessage, const int mt, const std::string& target_id, const bool intermodule_msg, const comm::MESSAGE_FRAME& frame, const SOCKET_ADDRESS* ssock, const uint64_t ms_fingerprint);
+
+            bool handleModuleRegistration (const Json& msg_cmd, const SOCKET_ADDRESS* ssock, const uint64_t ms_fingerprint);
+
+            /**
+             * @brief handle a TYPE_AndruavModule_ID that is the same as last one of a module.
+             * @details only access time is updated and ID is sent if requested.
+             * 
+             * @param ms_fingerprint hash of "ms" text.
+             * @param ssock sender module address
+             * @return false if message is not a repeated one and should be processed by @link handleModuleRegistration @endlink
+             */
+            bool refreshModuleRegistration (const uint64_t ms_fingerprint, const SOCKET_ADDRESS* ssock);
+
+            uint64_t getModuleTimeout (const std::string& module_class) const;
+
+            /**
+             * @brief registered module that sent a message.
+             * 
+             * @param registry
+             * @param ssock sender module address
+             * @return NULL if sender is not a registered module.
+             */
+            static const MODULE_ADDRESS_ENTRY * findSenderModule (const MODULE_REGISTRY_SNAPSHOT& registry, const SOCKET_ADDRESS* ssock);
+
+            /**
+             * @brief TYPE_AndruavModule_Statistics reply built from latest traffic snapshot.
+             * @details called with g_i_mutex locked.
+             * 
+             */
+            Json createJSONStatistics ();
+
+            void scheduleLiveness (MODULE_ITEM_TYPE * module_item);
+
+            /**
+             * @brief add a request whose replies should be delivered to its module only.
+             * 
+             * @return false if module has reached its limit of pending requests.
+             */
+            bool addPendingRequest (const std::string& module_id, const Json& correlation_id, const std::set<int>& reply_message_types);
+
+            /**
+             * @brief tell a module its request has not been executed.
+             * 
+             * @param module_id 
+             * @param cmd command of rejected request.
+             * @param correlation_id JSON_INTERMODULE_CORRELATION_ID of request. null if not sent.
+             * @param description 
+             */
+            void sendRequestRejection (const std::string& module_id, const int cmd, const Json& correlation_id, const std::string& description);
 
             /**
              * @brief called by handleModuleRegistration to update subscribed messages for a module.
              * 
              * @param module_id 
-             * @param message_array 
+             * @param message_array message types, ranges "first-last" or "*" for all types.
              * 
              * @return true module has been added.
              * @return false no new modules.
@@ -152,11 +435,61 @@ namespace uavos
             void updateCameraList(const std::string& module_id, const Json& msg_cmd);
 
             
-            void cleanOrphanCameraEntries (const std::string& module_id, const uint64_t& time_now);
+            /**
+             * @return true if entries have been removed.
+             */
+            bool cleanOrphanCameraEntries (const std::string& module_id, const uint64_t& time_now);
 
             
             void checkLicenseStatus(MODULE_ITEM_TYPE * module_item);
 
+            /**
+             * @brief set licence status of a module to OK or BAD and notify if it has changed.
+             * 
+             * @return true if status has changed.
+             */
+            bool applyLicenseVerdict(MODULE_ITEM_TYPE * module_item, const bool valid);
+
+            /**
+             * @brief compile @param m_module_messages, @param m_module_message_ranges & @param m_modules_list into a new registry snapshot.
+             * @details called with g_i_mutex locked whenever modules, subscriptions, liveness or licence of a module change.
+             * 
+             */
+            void publishRegistry();
+
+            /**
+             * @brief publish a new camera list snapshot from @param m_camera_list
+             * @details called with g_i_mutex locked when camera list has changed.
+             * 
+             */
+            void publishCameraList();
+
+            /**
+             * @brief send a binary message whose binary part is stored in a shared memory ring.
+             * @details payload is written to websocket directly from the ring then released.
+             * 
+             * @param target_id 
+             * @param mt 
+             * @param shm_descriptor @link INTERMODULE_SHM_DESCRIPTOR @endlink
+             * @param ms 
+             * @param forward false to release payload without sending it.
+             * @param module_id producer module. empty if unknown.
+             */
+            void sendShmBinaryCMD (const std::string& target_id, const int mt, const Json& shm_descriptor, const Json& ms, const bool forward, const std::string& module_id);
+
+            /**
+             * @brief map a ring again as producer has recreated or truncated it.
+             * 
+             * @return NULL if ring cannot be opened. ring is removed then.
+             */
+            comm::CShmRing * reopenShmRing (const std::string& ring_name);
+
+            /**
+             * @brief unmap rings of a module that died or restarted. they are mapped again on next descriptor.
+             * 
+             */
+            void closeModuleShmRings (const std::string& module_id);
+
         private:
 
             /**
@@ -166,6 +499,30 @@ namespace uavos
              */
             MODULE_ITEM_LIST  m_modules_list ;
 
+
+            /**
+             * @brief modules mapped by @param MODULE_ITEM_TYPE::registration_fingerprint
+             * 
+             */
+            std::unordered_map <uint64_t, MODULE_ITEM_TYPE *> m_registration_fingerprints;
+
+
+            /**
+             * @brief live modules ordered by deadline of their next TYPE_AndruavModule_ID.
+             * 
+             */
+            CTimingWheel<MODULE_ITEM_TYPE *> m_liveness_wheel = CTimingWheel<MODULE_ITEM_TYPE *>(MODULE_LIVENESS_TICK_USEC, MODULE_LIVENESS_WHEEL_SLOTS, get_monotonic_time_usec());
+
+
+            /**
+             * @brief module timeout mapped by module class prefix.
+             * 
+             */
+            std::map <std::string, uint64_t> m_module_class_timeouts;
+
+            // modules returned by m_liveness_wheel. reused to avoid allocation every tick.
+            std::vector<MODULE_ITEM_TYPE *> m_liveness_due;
+
             
             /**
              * @brief map (message number, List of subscribed modules)
@@ -178,8 +535,55 @@ namespace uavos
             std::map <int, std::vector<std::string>> m_module_messages;
 
 
+            /**
+             * @brief map (message range first & last, List of subscribed modules)
+             * @details subscriptions such as "1000-1099" or "*" in JSON_INTERMODULE_MODULE_MESSAGES_LIST.
+             */
+            std::map <std::pair<int, int>, std::vector<std::string>> m_module_message_ranges;
+
+
+            /**
+             * @brief multicast groups mapped by message type. not changed after modules register.
+             * 
+             */
+            std::map <int, MODULE_MULTICAST_GROUP> m_multicast_groups;
+            std::size_t m_multicast_min_subscribers = 2;
+
+
+            /**
+             * @brief requests waiting for replies ordered by time of request. guarded by g_i_mutex.
+             * 
+             */
+            std::vector<MODULE_PENDING_REQUEST> m_pending_requests;
+            // size of m_pending_requests. checked without lock for each server message.
+            std::atomic<std::size_t> m_pending_request_count = {0};
+            uint64_t m_request_timeout = MODULE_REQUEST_TIME_OUT;
+            std::size_t m_max_pending_requests = MODULE_MAX_PENDING_REQUESTS;
+
+
+            /**
+             * @brief modules as seen by readers. @see publishRegistry
+             * 
+             */
+            CSnapshotHandoff<MODULE_REGISTRY_SNAPSHOT> m_registry;
+
+
             MODULE_CAMERA_LIST m_camera_list;
 
+
+            /**
+             * @brief camera list as seen by readers. @see publishCameraList
+             * 
+             */
+            CSnapshotHandoff<CAMERA_LIST_SNAPSHOT> m_camera_list_snapshot;
+
+
+            /**
+             * @brief shared memory rings of producer modules mapped by ring name.
+             * 
+             */
+            std::map <std::string, MODULE_SHM_RING> m_shm_rings;
+
             
             uavos::STATUS &m_status = uavos::STATUS::getInstance();
             
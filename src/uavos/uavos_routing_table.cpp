@@ -0,0 +1,108 @@
+#include <limits>
+
+#include "uavos_routing_table.hpp"
+
+
+using namespace uavos;
+
+
+MODULE_ROUTE_LIST& CModuleRoutingTable::getExactRoutes (const int message_type)
+{
+    if ((message_type >= 0) && (message_type < ROUTING_TABLE_DENSE_MESSAGE_TYPES))
+    {
+        if (message_type >= (int) m_dense_routes.size())
+        {
+            m_dense_routes.resize(message_type + 1);
+        }
+
+        return m_dense_routes[message_type];
+    }
+
+    return m_sparse_routes[message_type];
+}
+
+
+void CModuleRoutingTable::addRoute (const int message_type, const MODULE_ROUTE& route)
+{
+    getExactRoutes(message_type).push_back(route);
+}
+
+
+void CModuleRoutingTable::addRangeRoute (const int first, const int last, const MODULE_ROUTE& route)
+{
+    if (first > last) return ;
+
+    m_range_routes.push_back(MODULE_RANGE_ROUTE{first, last, route});
+}
+
+
+/**
+ * @brief append range routes covering message_type whose modules are not already in routes.
+ *
+ */
+void CModuleRoutingTable::mergeRangeRoutes (const int message_type, MODULE_ROUTE_LIST& routes) const
+{
+    for (const MODULE_RANGE_ROUTE& range_route : m_range_routes)
+    {
+        if ((message_type < range_route.first) || (message_type > range_route.last)) continue;
+
+        const bool exists = std::any_of(routes.begin(), routes.end(), [&](const MODULE_ROUTE& route)
+        {
+            return route.module_id == range_route.route.module_id;
+        });
+
+        if (!exists) routes.push_back(range_route.route);
+    }
+}
+
+
+void CModuleRoutingTable::compile ()
+{
+    m_segment_starts.clear();
+    m_segment_routes.clear();
+
+    if (m_range_routes.empty()) return ;
+
+    for (std::size_t message_type=0; message_type<m_dense_routes.size(); ++message_type)
+    {
+        if (m_dense_routes[message_type].empty()) continue;
+        mergeRangeRoutes(message_type, m_dense_routes[message_type]);
+    }
+
+    for (auto& routes : m_sparse_routes)
+    {
+        mergeRangeRoutes(routes.first, routes.second);
+    }
+
+    // segments start where any range starts or ends.
+    for (const MODULE_RANGE_ROUTE& range_route : m_range_routes)
+    {
+        m_segment_starts.push_back(range_route.first);
+        if (range_route.last != std::numeric_limits<int>::max())
+        {
+            m_segment_starts.push_back(range_route.last + 1);
+        }
+    }
+
+    std::sort(m_segment_starts.begin(), m_segment_starts.end());
+    m_segment_starts.erase(std::unique(m_segment_starts.begin(), m_segment_starts.end()), m_segment_starts.end());
+
+    m_segment_routes.resize(m_segment_starts.size());
+    for (std::size_t i=0; i<m_segment_starts.size(); ++i)
+    {
+        mergeRangeRoutes(m_segment_starts[i], m_segment_routes[i]);
+    }
+}
+
+
+void CModuleRoutingTable::setMulticast (const int message_type, const std::set<std::string>& module_ids)
+{
+    // range subscribers are shared by all types of a segment so message type gets its own list.
+    MODULE_ROUTE_LIST routes = getRoutes(message_type);
+    for (MODULE_ROUTE& route : routes)
+    {
+        route.multicast = (module_ids.find(route.module_id) != module_ids.end());
+    }
+
+    getExactRoutes(message_type) = std::move(routes);
+}
@@ -0,0 +1,173 @@
+#ifndef UAVOS_ROUTING_TABLE_H_
+#define UAVOS_ROUTING_TABLE_H_
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "uavos_module_dispatcher.hpp"
+
+
+// message types below this value are indexed directly. others are hashed.
+#define ROUTING_TABLE_DENSE_MESSAGE_TYPES   10000
+
+
+namespace uavos
+{
+
+/**
+ * @brief a module that receives a message type.
+ * @details queue holds module address so no module lookup is needed when forwarding.
+ *
+ */
+typedef struct
+{
+    std::string module_id;
+    std::string module_key;
+    std::shared_ptr<CModuleOutboundQueue> outbound_queue;
+    // module licence is rejected. module is skipped and other modules still receive message.
+    bool licence_bad;
+    // module receives messages framed. @see FRAME_HEADER
+    bool framed;
+    // traffic counters of module. @see CMessageStatistics
+    int stats_index;
+    // module receives this message type from its multicast group.
+    bool multicast;
+} MODULE_ROUTE;
+
+
+typedef std::vector<MODULE_ROUTE> MODULE_ROUTE_LIST;
+
+
+/**
+ * @brief modules subscribed to each message type compiled from modules list.
+ * @details table is rebuilt when modules are added, die, come back or licence changes.
+ * dead modules are not listed.
+ * modules subscribed to a range of message types are added to lists of exact types within range
+ * and to range segments used for types that no module subscribed to exactly.
+ *
+ */
+class CModuleRoutingTable
+{
+    public:
+
+        void addRoute (const int message_type, const MODULE_ROUTE& route);
+
+        /**
+         * @brief module subscribed to message types from first to last inclusive.
+         *
+         * @param first
+         * @param last
+         * @param route
+         */
+        void addRangeRoute (const int first, const int last, const MODULE_ROUTE& route);
+
+        /**
+         * @brief merge range routes. should be called once after all routes are added.
+         *
+         */
+        void compile ();
+
+        /**
+         * @brief mark modules that receive message_type from its multicast group.
+         * @details should be called after @link compile @endlink.
+         *
+         * @param message_type
+         * @param module_ids
+         */
+        void setMulticast (const int message_type, const std::set<std::string>& module_ids);
+
+        /**
+         * @brief modules subscribed to message_type in subscription order.
+         * @details exact subscribers come first then range subscribers.
+         *
+         * @param message_type
+         */
+        inline const MODULE_ROUTE_LIST& getRoutes (const int message_type) const
+        {
+            if ((message_type >= 0) && (message_type < (int) m_dense_routes.size()))
+            {
+                const MODULE_ROUTE_LIST& routes = m_dense_routes[message_type];
+                if (!routes.empty()) return routes;
+            }
+            else
+            {
+                const auto routes = m_sparse_routes.find(message_type);
+                if (routes != m_sparse_routes.end()) return routes->second;
+            }
+
+            if (m_segment_starts.empty()) return m_no_routes;
+
+            // last segment starting at or before message_type.
+            const auto segment = std::upper_bound(m_segment_starts.begin(), m_segment_starts.end(), message_type);
+            if (segment == m_segment_starts.begin()) return m_no_routes;
+
+            return m_segment_routes[segment - m_segment_starts.begin() - 1];
+        }
+
+    private:
+
+        typedef struct
+        {
+            int first;
+            int last;
+            MODULE_ROUTE route;
+        } MODULE_RANGE_ROUTE;
+
+        void mergeRangeRoutes (const int message_type, MODULE_ROUTE_LIST& routes) const;
+
+        MODULE_ROUTE_LIST& getExactRoutes (const int message_type);
+
+    private:
+
+        std::vector<MODULE_ROUTE_LIST> m_dense_routes;
+        std::unordered_map<int, MODULE_ROUTE_LIST> m_sparse_routes;
+
+        std::vector<MODULE_RANGE_ROUTE> m_range_routes;
+        // sorted. segment i covers message types from m_segment_starts[i] till next start.
+        std::vector<int> m_segment_starts;
+        std::vector<MODULE_ROUTE_LIST> m_segment_routes;
+
+        const MODULE_ROUTE_LIST m_no_routes;
+};
+
+
+/**
+ * @brief true if route module is the one that sent the message.
+ * @details same as module_key.find(sender_module_key) != npos without searching keys that cannot contain sender key.
+ *
+ * @param route
+ * @param sender_module_key
+ */
+inline bool isSenderModule (const MODULE_ROUTE& route, const std::string& sender_module_key)
+{
+    if (sender_module_key.empty()) return false;
+
+    const std::size_t key_length = route.module_key.length();
+    const std::size_t sender_key_length = sender_module_key.length();
+    if (sender_key_length > key_length) return false;
+    if (sender_key_length == key_length) return route.module_key == sender_module_key;
+
+    return route.module_key.find(sender_module_key) != std::string::npos;
+}
+
+
+/**
+ * @brief true if route module has already received the message as a reply of its request.
+ *
+ * @param route
+ * @param replied_modules ids of replied modules. may be NULL.
+ */
+inline bool isRepliedModule (const MODULE_ROUTE& route, const std::set<std::string> * replied_modules)
+{
+    if ((replied_modules == NULL) || (replied_modules->empty())) return false;
+
+    return replied_modules->find(route.module_id) != replied_modules->end();
+}
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef UAVOS_SNAPSHOT_HANDOFF_H_
+#define UAVOS_SNAPSHOT_HANDOFF_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+
+namespace uavos
+{
+
+/**
+ * @brief Hands immutable snapshots from a writer to many reader threads.
+ * @details std::atomic_load of a shared_ptr takes a lock from a global pool in libstdc++.
+ * each reader thread keeps its own reference to latest snapshot and reloads it only when version changes
+ * so readers take no lock between publishes. a reader costs one atomic load and one reference count increment.
+ * an old snapshot is freed once every thread that used it acquires again or exits.
+ * publish calls should be serialized by caller.
+ *
+ */
+template <typename T>
+class CSnapshotHandoff
+{
+    public:
+
+        CSnapshotHandoff ()
+            : m_id(nextId())
+            , m_snapshot(std::make_shared<const T>())
+        {
+        }
+
+        CSnapshotHandoff(CSnapshotHandoff const&)       = delete;
+        void operator=(CSnapshotHandoff const&)         = delete;
+
+    public:
+
+        /**
+         * @brief replace snapshot seen by readers.
+         *
+         * @param snapshot
+         */
+        void publish (const std::shared_ptr<const T>& snapshot)
+        {
+            std::atomic_store(&m_snapshot, snapshot);
+            m_version.fetch_add(1, std::memory_order_release);
+        }
+
+        /**
+         * @brief latest published snapshot. it stays valid as long as returned reference is kept.
+         *
+         */
+        std::shared_ptr<const T> acquire () const
+        {
+            // one cache per thread & snapshot type. another instance of same type just reloads it.
+            thread_local HANDOFF_CACHE cache;
+
+            const uint64_t version = m_version.load(std::memory_order_acquire);
+            if ((cache.owner_id != m_id) || (cache.version != version) || (!cache.snapshot))
+            {
+                cache.snapshot = std::atomic_load(&m_snapshot);
+                cache.owner_id = m_id;
+                cache.version = version;
+            }
+
+            return cache.snapshot;
+        }
+
+        /**
+         * @brief number of publish calls.
+         *
+         */
+        uint64_t getVersion () const
+        {
+            return m_version.load(std::memory_order_acquire);
+        }
+
+    private:
+
+        typedef struct
+        {
+            uint64_t owner_id = 0;
+            uint64_t version = 0;
+            std::shared_ptr<const T> snapshot;
+        } HANDOFF_CACHE;
+
+        static uint64_t nextId ()
+        {
+            static std::atomic<uint64_t> next_id = {1};
+            return next_id.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const uint64_t m_id;
+        std::atomic<uint64_t> m_version = {0};
+        // only accessed by std::atomic_load & std::atomic_store.
+        std::shared_ptr<const T> m_snapshot;
+};
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef UAVOS_TIMING_WHEEL_H_
+#define UAVOS_TIMING_WHEEL_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+namespace uavos
+{
+
+/**
+ * @brief Hashed timing wheel of keys waiting for a deadline.
+ * @details slot of a deadline is (deadline / tick) % slots. deadlines beyond one turn wait in their slot
+ * for more turns. scheduling & expiring cost O(1) per key.
+ * keys are not cancelled. owner checks the real deadline of a due key and schedules it again if it was extended.
+ * not thread safe.
+ *
+ */
+template <typename KEY>
+class CTimingWheel
+{
+    public:
+
+        /**
+         * @param tick_usec
+         * @param slot_count
+         * @param start_usec current time. deadlines before it are due on first @link advance @endlink.
+         */
+        CTimingWheel (const uint64_t tick_usec, const std::size_t slot_count, const uint64_t start_usec)
+            : m_tick_usec(tick_usec)
+            , m_slots(slot_count)
+            , m_current_tick(start_usec / tick_usec)
+        {
+        }
+
+    public:
+
+        /**
+         * @brief add key to be returned by @link advance @endlink once deadline_usec is reached.
+         *
+         * @param key
+         * @param deadline_usec
+         */
+        void schedule (const KEY& key, const uint64_t deadline_usec)
+        {
+            uint64_t tick = deadline_usec / m_tick_usec;
+            if (tick < m_current_tick) tick = m_current_tick;
+
+            m_slots[tick % m_slots.size()].push_back({tick, key});
+            m_count++;
+        }
+
+        /**
+         * @brief move wheel to now_usec.
+         *
+         * @param now_usec
+         * @param due keys whose deadline has been reached are appended here.
+         */
+        void advance (const uint64_t now_usec, std::vector<KEY>& due)
+        {
+            const uint64_t now_tick = now_usec / m_tick_usec;
+            if (now_tick < m_current_tick) return ;
+
+            // after a long pause one turn visits every slot.
+            const uint64_t last_tick = std::min<uint64_t>(now_tick, m_current_tick + m_slots.size() - 1);
+            for (; m_current_tick <= last_tick; ++m_current_tick)
+            {
+                std::vector<WHEEL_ENTRY>& slot = m_slots[m_current_tick % m_slots.size()];
+                std::size_t kept = 0;
+                for (std::size_t i=0; i<slot.size(); ++i)
+                {
+                    if (slot[i].tick <= now_tick)
+                    {
+                        due.push_back(slot[i].key);
+                        m_count--;
+                    }
+                    else
+                    {
+                        // waits for another turn.
+                        slot[kept++] = slot[i];
+                    }
+                }
+                slot.resize(kept);
+            }
+
+            m_current_tick = now_tick + 1;
+        }
+
+        std::size_t size () const { return m_count; }
+
+    private:
+
+        typedef struct
+        {
+            uint64_t tick;
+            KEY key;
+        } WHEEL_ENTRY;
+
+        const uint64_t m_tick_usec;
+        std::vector<std::vector<WHEEL_ENTRY>> m_slots;
+        uint64_t m_current_tick;
+        std::size_t m_count = 0;
+};
+
+}
+
+#endif
@@ -3,20 +3,27 @@
 #include <sys/socket.h> 
 #include <arpa/inet.h> 
 #include <netinet/in.h> 
+#include <sys/un.h>
+#include <cstddef>
 #include <unistd.h>
+#include <algorithm>
+#include <poll.h>
+#include <time.h>
 
 #include "./helpers/colors.hpp"
 #include "./helpers/json.hpp"
+#include "./helpers/helpers.hpp"
 using Json = nlohmann::json;
 
+#include "epollReactor.hpp"
 #include "udpCommunicator.hpp"
+#include "messageFragments.hpp"
+#include "messageLatency.hpp"
 
 #include <plog/Log.h> 
 #include "plog/Initializers/RollingFileInitializer.h"
 
-#define MAXLINE 65507 
-char buffer[MAXLINE]; 
-    
+
 uavos::comm::CUDPCommunicator::~CUDPCommunicator ()
 {
     
@@ -60,13 +67,6 @@ void uavos::comm::CUDPCommunicator::init (const char * host, int listenningPort)
 	pthread_setschedprio(m_thread, SCHED_FIFO); // setting priority
 
 
-    // Creating socket file descriptor 
-    if ( (m_SocketFD = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ) { 
-        perror("socket creation failed"); 
-        PLOG(plog::error) << "socket creation failed" ; 
-        exit(EXIT_FAILURE); 
-    }
-
     m_CommunicatorModuleAddress = new (struct sockaddr_in)();
     memset(m_CommunicatorModuleAddress, 0, sizeof(struct sockaddr_in)); 
      
@@ -75,16 +75,134 @@ void uavos::comm::CUDPCommunicator::init (const char * host, int listenningPort)
     m_CommunicatorModuleAddress->sin_port = htons(listenningPort); 
     m_CommunicatorModuleAddress->sin_addr.s_addr = inet_addr(host);//INADDR_ANY; 
     
+    // ids of fragmented messages differ after a restart so modules do not take them for duplicates.
+    m_fragment_message_id = (uint32_t) get_time_usec();
+
+    // one socket per receiver thread all bound to the same port.
+    // kernel distributes datagrams by hashing sender address so messages of a module are always 
+    // received by the same thread in order.
+    for (unsigned int i=0; i<m_receiver_threads; ++i)
+    {
+        const int fd = createSocket(host, listenningPort);
+        m_ReceiverSocketFDs.push_back(fd);
+        m_reactors.push_back(std::unique_ptr<CEpollReactor>(new CEpollReactor()));
+    }
+
+    // first socket is used for sending.
+    m_SocketFD = m_ReceiverSocketFDs[0];
+}
+
+
+int uavos::comm::CUDPCommunicator::createSocket (const char * host, int listenningPort)
+{
+    int fd;
+    
+    // Creating socket file descriptor 
+    if ( (fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ) { 
+        perror("socket creation failed"); 
+        PLOG(plog::error) << "socket creation failed" ; 
+        exit(EXIT_FAILURE); 
+    }
+
+    // room for a burst of fragments of a large message. kernel caps it to rmem_max.
+    const int buffer_size = UDP_RECEIVE_BUFFER_SIZE;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+    // kernel receive time of each datagram is used for latency accounting.
+    const int timestamp = 1;
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &timestamp, sizeof(timestamp));
+
+    if (m_loopback_multicast)
+    {
+        // group datagrams never leave the host. sender socket does not join groups so it never receives them.
+        struct in_addr loopback;
+        loopback.s_addr = htonl(INADDR_LOOPBACK);
+        const unsigned char ttl = 0;
+        const unsigned char loop = 1;
+        if ((setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback)) < 0)
+            || (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+            || (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0))
+        {
+            PLOG(plog::error) << "UDP Listener multicast options failed errno:" << errno ; 
+        }
+    }
+
+    if (m_receiver_threads > 1)
+    {
+        const int enable = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+        {
+            PLOG(plog::error) << "UDP Listener SO_REUSEPORT failed errno:" << errno ; 
+            exit(EXIT_FAILURE); 
+        }
+    }
     
     // Bind the socket with the server address 
-    if (bind(m_SocketFD, (const struct sockaddr *)m_CommunicatorModuleAddress, sizeof(struct sockaddr_in)) < 0 ) 
+    if (bind(fd, (const struct sockaddr *)m_CommunicatorModuleAddress, sizeof(struct sockaddr_in)) < 0 ) 
     { 
         std::cout << "UDP Listener  " << _ERROR_CONSOLE_TEXT_ << " BAD BIND: " << host << ":" << listenningPort << _NORMAL_CONSOLE_TEXT_ << std::endl;
         PLOG(plog::error) << "UDP Listener BAD BIND: " << host << ":" << listenningPort ; 
         exit(-1) ;
     } 
+
+    return fd;
 }
 
+void uavos::comm::CUDPCommunicator::initUnix (const char * socket_path)
+{
+    struct sockaddr_un unix_address;
+    memset(&unix_address, 0, sizeof(struct sockaddr_un)); 
+    unix_address.sun_family = AF_UNIX;
+
+    const std::size_t path_length = strlen(socket_path);
+    if ((path_length == 0) || (path_length >= sizeof(unix_address.sun_path)))
+    {
+        std::cout << "Unix Listener  " << _ERROR_CONSOLE_TEXT_ << " BAD PATH: " << socket_path << _NORMAL_CONSOLE_TEXT_ << std::endl;
+        PLOG(plog::error) << "Unix Listener BAD PATH: " << socket_path ; 
+        exit(-1) ;
+    }
+    
+    memcpy(unix_address.sun_path, socket_path, path_length);
+    socklen_t address_length = offsetof(struct sockaddr_un, sun_path) + path_length;
+    if (socket_path[0] == '@')
+    {
+        // abstract namespace. no file is created.
+        unix_address.sun_path[0] = 0;
+    }
+    else
+    {
+        // remove stale socket file of a previous run.
+        unlink(socket_path);
+        address_length += 1;
+    }
+
+    if ( (m_UnixSocketFD = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0 ) { 
+        perror("unix socket creation failed"); 
+        PLOG(plog::error) << "unix socket creation failed" ; 
+        exit(EXIT_FAILURE); 
+    }
+
+    // allow large datagrams in both directions.
+    const int buffer_size = 2 * MAXLINE_UNIX;
+    setsockopt(m_UnixSocketFD, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+    setsockopt(m_UnixSocketFD, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+
+    const int timestamp = 1;
+    setsockopt(m_UnixSocketFD, SOL_SOCKET, SO_TIMESTAMPNS, &timestamp, sizeof(timestamp));
+
+    if (bind(m_UnixSocketFD, (const struct sockaddr *)&unix_address, address_length) < 0 ) 
+    { 
+        std::cout << "Unix Listener  " << _ERROR_CONSOLE_TEXT_ << " BAD BIND: " << socket_path << _NORMAL_CONSOLE_TEXT_ << std::endl;
+        PLOG(plog::error) << "Unix Listener BAD BIND: " << socket_path ; 
+        exit(-1) ;
+    } 
+
+    m_UnixSocketPath = std::string(socket_path);
+
+    std::cout << _LOG_CONSOLE_TEXT_BOLD_ << "Unix Listener " << _INFO_CONSOLE_TEXT << socket_path << _NORMAL_CONSOLE_TEXT_ << std::endl;
+}
+
+
 void uavos::comm::CUDPCommunicator::start()
 {
     #ifdef DEBUG        
@@ -95,6 +213,18 @@ void uavos::comm::CUDPCommunicator::start()
     if (m_starrted == true)
         throw "Starrted called twice";
 
+    if (m_io_backend == IO_BACKEND_IO_URING)
+    {
+        m_send_ring = std::unique_ptr<CIOUring>(new CIOUring());
+        if (!m_send_ring->init(IO_URING_SEND_ENTRIES))
+        {
+            m_send_ring.reset();
+            m_io_backend = IO_BACKEND_EPOLL;
+            std::cout << _LOG_CONSOLE_TEXT_BOLD_ << "io_uring is not available. " << _INFO_CONSOLE_TEXT << "using epoll" << _NORMAL_CONSOLE_TEXT_ << std::endl;
+            PLOG(plog::warning) << "io_uring is not available. using epoll"; 
+        }
+    }
+
     startReceiver ();
 
     m_starrted = true;
@@ -103,7 +233,11 @@ void uavos::comm::CUDPCommunicator::start()
 
 void uavos::comm::CUDPCommunicator::startReceiver ()
 {
-    m_threadCreateUDPSocket = std::thread {[&](){ InternalReceiverEntry(); }};
+    for (unsigned int i=0; i<m_ReceiverSocketFDs.size(); ++i)
+    {
+        const int fd = m_ReceiverSocketFDs[i];
+        m_threadReceivers.push_back(std::thread {[this, fd, i](){ InternalReceiverEntry(fd, i); }});
+    }
 };
 
 void uavos::comm::CUDPCommunicator::stop()
@@ -114,8 +248,25 @@ void uavos::comm::CUDPCommunicator::stop()
     
     m_stopped_called = true;
 
-    if (m_SocketFD != -1)
-        shutdown(m_SocketFD, SHUT_RDWR);
+    // wake up receiver threads immediately.
+    for (auto& reactor : m_reactors)
+    {
+        reactor->stop();
+    }
+
+    for (const int fd : m_ReceiverSocketFDs)
+    {
+        shutdown(fd, SHUT_RDWR);
+    }
+
+    if (m_UnixSocketFD != -1)
+    {
+        shutdown(m_UnixSocketFD, SHUT_RDWR);
+        if ((!m_UnixSocketPath.empty()) && (m_UnixSocketPath[0] != '@'))
+        {
+            unlink(m_UnixSocketPath.c_str());
+        }
+    }
     
     #ifdef DEBUG
 	std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: Stop Socket Closed" << _NORMAL_CONSOLE_TEXT_ << std::endl;
@@ -123,7 +274,10 @@ void uavos::comm::CUDPCommunicator::stop()
 
     try
     {
-        m_threadCreateUDPSocket.join();
+        for (std::thread& receiver : m_threadReceivers)
+        {
+            receiver.join();
+        }
         delete m_CommunicatorModuleAddress;
 
         #ifdef DEBUG
@@ -136,45 +290,306 @@ void uavos::comm::CUDPCommunicator::stop()
         PLOG(plog::error) << "CUDPCommunicator::stop() exception" ; 
     }
 
+    const UDP_IO_COUNTERS counters = getIOCounters();
+    PLOG(plog::info) << "CUDPCommunicator rx: " << counters.rx_messages << " msgs in " << counters.rx_syscalls << " syscalls"
+                     << " tx: " << counters.tx_messages << " msgs in " << counters.tx_syscalls << " syscalls"; 
+
     #ifdef DEBUG
 	std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: Stop out" << _NORMAL_CONSOLE_TEXT_ << std::endl;
     #endif
 }
 
 
-void uavos::comm::CUDPCommunicator::InternalReceiverEntry()
+void uavos::comm::CUDPCommunicator::initReceiveBatch (RECEIVE_BATCH& batch, const unsigned int batch_size, const std::size_t slot_size)
+{
+    batch.batch_size = batch_size;
+    batch.slot_size  = slot_size;
+    // one extra byte per slot to zero-terminate a full size datagram.
+    batch.buffers.resize(batch_size * (slot_size + 1));
+    batch.addresses.resize(batch_size);
+    batch.iovecs.resize(batch_size);
+    batch.msgs.resize(batch_size);
+    batch.controls.resize(batch_size * RECEIVE_CONTROL_SIZE);
+}
+
+
+/**
+ * @brief receive all queued datagrams of a readable socket and pass them to @link m_OnReceive @endlink.
+ * 
+ * @param socket_fd 
+ * @param batch buffers owned by calling thread.
+ * @param reassembler fragments of large messages received by calling thread.
+ */
+void uavos::comm::CUDPCommunicator::drainSocket (const int socket_fd, RECEIVE_BATCH& batch, CFragmentReassembler& reassembler)
+{
+    const unsigned int batch_size = batch.batch_size;
+
+    int count;
+    do
+    {
+        for (unsigned int i=0; i<batch_size; ++i)
+        {
+            prepareReceiveSlot(batch, i);
+        }
+
+        // socket is readable so drain whatever is already queued up to batch_size without blocking.
+        count = recvmmsg(socket_fd, batch.msgs.data(), batch_size, MSG_DONTWAIT, NULL);
+        m_rx_syscalls++;
+
+        if (count <= 0) return ;
+        
+        m_rx_messages += count;
+
+        for (int i=0; i<count; ++i)
+        {
+            deliverDatagram(batch, i, batch.msgs[i].msg_len, reassembler);
+        }
+    } while ((count == (int) batch_size) && (!m_stopped_called));
+}
+
+
+void uavos::comm::CUDPCommunicator::prepareReceiveSlot (RECEIVE_BATCH& batch, const unsigned int index)
+{
+    batch.iovecs[index].iov_base              = &batch.buffers[index * (batch.slot_size + 1)];
+    batch.iovecs[index].iov_len               = batch.slot_size;
+    batch.msgs[index].msg_hdr.msg_name        = &batch.addresses[index].address;
+    batch.msgs[index].msg_hdr.msg_namelen     = sizeof (struct sockaddr_storage);
+    batch.msgs[index].msg_hdr.msg_iov         = &batch.iovecs[index];
+    batch.msgs[index].msg_hdr.msg_iovlen      = 1;
+    batch.msgs[index].msg_hdr.msg_control     = &batch.controls[index * RECEIVE_CONTROL_SIZE];
+    batch.msgs[index].msg_hdr.msg_controllen  = RECEIVE_CONTROL_SIZE;
+    batch.msgs[index].msg_hdr.msg_flags       = 0;
+    batch.msgs[index].msg_len                 = 0;
+}
+
+
+/**
+ * @brief kernel receive time of datagram in slot index.
+ * 
+ * @return uint64_t CLOCK_REALTIME nanoseconds. current time if kernel did not provide it.
+ */
+uint64_t uavos::comm::CUDPCommunicator::getIngressTime (const RECEIVE_BATCH& batch, const unsigned int index) const
+{
+    const struct msghdr * header = &batch.msgs[index].msg_hdr;
+    for (const struct cmsghdr * cmsg = CMSG_FIRSTHDR(header); cmsg != NULL; cmsg = CMSG_NXTHDR((struct msghdr *) header, (struct cmsghdr *) cmsg))
+    {
+        if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_TIMESTAMPNS))
+        {
+            struct timespec timestamp;
+            memcpy(&timestamp, CMSG_DATA(cmsg), sizeof(timestamp));
+            return (uint64_t) timestamp.tv_sec * 1000000000ull + timestamp.tv_nsec;
+        }
+    }
+
+    return get_time_realtime_nsec();
+}
+
+
+/**
+ * @brief pass a received datagram to @link m_OnReceive @endlink.
+ * 
+ * @param batch 
+ * @param index slot of datagram.
+ * @param length 
+ * @param reassembler 
+ */
+void uavos::comm::CUDPCommunicator::deliverDatagram (RECEIVE_BATCH& batch, const unsigned int index, const int length, CFragmentReassembler& reassembler)
+{
+    if (length <= 0) return ;
+
+    batch.addresses[index].length = batch.msgs[index].msg_hdr.msg_namelen;
+    char * buffer = &batch.buffers[index * (batch.slot_size + 1)];
+    uint64_t ingress_nsec = getIngressTime(batch, index);
+    
+    if (isFragment(buffer, length))
+    {
+        // message is larger than one datagram. deliver it when all fragments arrive.
+        if ((reassembler.addFragment(buffer, length, &batch.addresses[index], ingress_nsec, batch.reassembled, ingress_nsec)) && (m_OnReceive != NULL))
+        {
+            m_OnReceive((const char *) batch.reassembled.data(), batch.reassembled.size(), &batch.addresses[index], ingress_nsec);
+        }
+        return ;
+    }
+
+    buffer[length]=0; // make it zero-terminated
+    if (m_OnReceive != NULL)
+    {
+        m_OnReceive((const char *) buffer, length, &batch.addresses[index], ingress_nsec);
+    } 
+}
+
+
+/**
+ * @brief receive loop based on io_uring.
+ * @details a recvmsg is kept in flight for every slot of batch. 
+ * reactor fd is polled by the same ring so timers, Unix socket & stop keep working.
+ * 
+ * @param socket_fd 
+ * @param reactor 
+ * @param batch 
+ * @param reassembler 
+ * @return false if io_uring could not be created.
+ */
+bool uavos::comm::CUDPCommunicator::runIOUringReceiver (const int socket_fd, CEpollReactor * reactor, RECEIVE_BATCH& batch, CFragmentReassembler& reassembler)
+{
+    const uint64_t POLL_TAG     = UINT64_MAX;
+    const uint64_t CANCEL_TAG   = UINT64_MAX - 1;
+    const unsigned int batch_size = batch.batch_size;
+
+    CIOUring ring;
+    // room for receives, reactor poll and cancellation of all receives.
+    if (!ring.init(batch_size * 2 + 2)) return false;
+
+    auto armReceive = [&](const unsigned int index)
+    {
+        prepareReceiveSlot(batch, index);
+        struct io_uring_sqe * sqe = ring.getSQE();
+        sqe->opcode     = IORING_OP_RECVMSG;
+        sqe->fd         = socket_fd;
+        sqe->addr       = (unsigned long) &batch.msgs[index].msg_hdr;
+        sqe->len        = 1;
+        sqe->user_data  = index;
+    };
+
+    auto armPoll = [&]()
+    {
+        struct io_uring_sqe * sqe = ring.getSQE();
+        sqe->opcode         = IORING_OP_POLL_ADD;
+        sqe->fd             = reactor->getFD();
+        sqe->poll32_events  = POLLIN;
+        sqe->user_data      = POLL_TAG;
+    };
+
+    for (unsigned int i=0; i<batch_size; ++i)
+    {
+        armReceive(i);
+    }
+    armPoll();
+    
+    unsigned int in_flight = batch_size + 1;
+    std::vector<bool> receiving(batch_size, true);
+    bool stopping = false;
+
+    while (in_flight > 0)
+    {
+        const int res = ring.submit(1);
+        m_rx_syscalls++;
+        if (res < 0)
+        {
+            PLOG(plog::error) << "CUDPCommunicator io_uring submit failed errno:" << -res; 
+            break;
+        }
+
+        const struct io_uring_cqe * cqe;
+        while ((cqe = ring.peekCQE()) != NULL)
+        {
+            const uint64_t tag = cqe->user_data;
+            const int result = cqe->res;
+            ring.seenCQE();
+            in_flight--;
+
+            if (tag == CANCEL_TAG) continue;
+
+            if (tag == POLL_TAG)
+            {
+                reactor->poll();
+                if ((reactor->isStopped()) || (m_stopped_called))
+                {
+                    // cancel receives that are still waiting.
+                    stopping = true;
+                    for (unsigned int i=0; i<batch_size; ++i)
+                    {
+                        if (!receiving[i]) continue;
+                        struct io_uring_sqe * sqe = ring.getSQE();
+                        sqe->opcode     = IORING_OP_ASYNC_CANCEL;
+                        sqe->addr       = i;
+                        sqe->user_data  = CANCEL_TAG;
+                        in_flight++;
+                    }
+                }
+                else
+                {
+                    armPoll();
+                    in_flight++;
+                }
+                continue;
+            }
+
+            const unsigned int index = (unsigned int) tag;
+            receiving[index] = false;
+            if (result > 0)
+            {
+                m_rx_messages++;
+                deliverDatagram(batch, index, result, reassembler);
+            }
+
+            if (!stopping)
+            {
+                armReceive(index);
+                receiving[index] = true;
+                in_flight++;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief receiver thread loop of one socket.
+ * @details buffers are local to each thread so several receivers can run in parallel.
+ * First thread also serves the Unix socket if exists.
+ * 
+ * @param socket_fd 
+ * @param reactor_index reactor that runs in this thread.
+ */
+void uavos::comm::CUDPCommunicator::InternalReceiverEntry(const int socket_fd, const unsigned int reactor_index)
 {
     #ifdef DEBUG        
         std::cout <<__FILE__ << "." << __FUNCTION__ << " line:" << __LINE__ << "  "  << _LOG_CONSOLE_TEXT << "DEBUG: InternalReceiverEntry" << _NORMAL_CONSOLE_TEXT_ << std::endl;
     #endif
     
-    // https://stackoverflow.com/questions/2876024/linux-is-there-a-read-or-recv-from-socket-with-timeout
-    struct timeval tv;
-    tv.tv_sec = 1; // timeout_in_seconds;
-    tv.tv_usec = 0;
-    setsockopt(m_SocketFD, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
-
-    struct sockaddr_in  cliaddr;
-    int n;
-    __socklen_t sender_address_size = sizeof (cliaddr);
-   
-    while (!m_stopped_called)
-    {
-        // TODO: you should send header ot message length and handle if total message size is larger than MAXLINE.
-        n = recvfrom(m_SocketFD, (char *)buffer, MAXLINE,  
-                MSG_WAITALL, ( struct sockaddr *) &cliaddr, &sender_address_size);
-        
-        if (n > 0) 
+    CEpollReactor * reactor = m_reactors[reactor_index].get();
+    
+    // a sender is always served by the same thread so its fragments meet here.
+    CFragmentReassembler reassembler;
+    reactor->addTimer(FRAGMENT_SWEEP_INTERVAL_MS, [&reassembler](const int)
+    {
+        reassembler.expire(get_time_usec());
+    });
+
+    RECEIVE_BATCH udp_batch;
+    initReceiveBatch(udp_batch, m_batch_size, MAXLINE);
+    
+    RECEIVE_BATCH unix_batch;
+    if ((reactor_index == 0) && (m_UnixSocketFD != -1))
+    {
+        initReceiveBatch(unix_batch, std::min<unsigned int>(m_batch_size, UNIX_BATCH_SIZE), MAXLINE_UNIX);
+        reactor->addFD(m_UnixSocketFD, [this, &unix_batch, &reassembler](const int fd)
         {
+            drainSocket(fd, unix_batch, reassembler);
+        });
+    }
 
-            buffer[n]=0; // make it zero-terminated
-            if (m_OnReceive != NULL)
-            {
-                m_OnReceive((const char *) buffer, n, &cliaddr);
-            } 
-        }
+    if ((m_io_backend != IO_BACKEND_IO_URING) 
+        || (!runIOUringReceiver(socket_fd, reactor, udp_batch, reassembler)))
+    {
+        reactor->addFD(socket_fd, [this, &udp_batch, &reassembler](const int fd)
+        {
+            drainSocket(fd, udp_batch, reassembler);
+        });
 
-        
+        // wakes up only on data, timers or stop().
+        reactor->run();
+    }
+
+    const FRAGMENT_COUNTERS& counters = reassembler.getCounters();
+    if (counters.fragments != 0)
+    {
+        PLOG(plog::info) << "Receiver " << reactor_index << " fragments:" << counters.fragments 
+                        << " completed:" << counters.completed << " expired:" << counters.expired 
+                        << " dropped:" << counters.dropped;
     }
 
     #ifdef DEBUG
@@ -189,25 +604,516 @@ void uavos::comm::CUDPCommunicator::SetMessageOnReceive ( ONRECEIVE_CALLBACK onR
 }
 
 
+/**
+ * @brief reactor of first receiver thread.
+ * @details other fds and timers can be added to it to share the same event loop.
+ * Callbacks run in receiver thread so they should not block.
+ * valid after @link init @endlink.
+ * 
+ * @return CEpollReactor* 
+ */
+uavos::comm::CEpollReactor * uavos::comm::CUDPCommunicator::getReactor ()
+{
+    if (m_reactors.empty()) return NULL;
+
+    return m_reactors[0].get();
+}
+
+
+void uavos::comm::CUDPCommunicator::setReceiverThreads (const unsigned int receiver_threads)
+{
+    if (!m_ReceiverSocketFDs.empty())
+        throw "setReceiverThreads called after init";
+
+    m_receiver_threads = (receiver_threads == 0) ? 1 : receiver_threads;
+}
+
+
+void uavos::comm::CUDPCommunicator::enableLoopbackMulticast ()
+{
+    if (!m_ReceiverSocketFDs.empty())
+        throw "enableLoopbackMulticast called after init";
+
+    m_loopback_multicast = true;
+}
+
+
+void uavos::comm::CUDPCommunicator::setIOBackend (const ENUM_IO_BACKEND io_backend)
+{
+    if (m_starrted == true)
+        throw "setIOBackend called after start";
+
+    m_io_backend = io_backend;
+}
+
+
+void uavos::comm::CUDPCommunicator::setBatchSize (const unsigned int batch_size)
+{
+    if (m_starrted == true)
+        throw "setBatchSize called after start";
+
+    m_batch_size = (batch_size == 0) ? 1 : batch_size;
+}
+
+
+uavos::comm::UDP_IO_COUNTERS uavos::comm::CUDPCommunicator::getIOCounters () const
+{
+    UDP_IO_COUNTERS counters;
+    counters.rx_syscalls = m_rx_syscalls;
+    counters.rx_messages = m_rx_messages;
+    counters.tx_syscalls = m_tx_syscalls;
+    counters.tx_messages = m_tx_messages;
+
+    return counters;
+}
+
+
+
+/**
+ * @brief select socket that matches transport of module address.
+ * 
+ * @param module_address 
+ * @return int 
+ */
+int uavos::comm::CUDPCommunicator::getSocketFor (const SOCKET_ADDRESS * module_address) const
+{
+    if (module_address->address.ss_family == AF_UNIX) return m_UnixSocketFD;
+
+    return m_SocketFD;
+}
+
+
+/**
+ * @brief Unix datagram sockets block when receiver queue is full unlike UDP that drops.
+ * a slow local module should not stall the sender thread so Unix sends never block.
+ * 
+ * @param module_address 
+ * @return int 
+ */
+int uavos::comm::CUDPCommunicator::getSendFlags (const SOCKET_ADDRESS * module_address) const
+{
+    if (module_address->address.ss_family == AF_UNIX) return MSG_DONTWAIT;
+
+    return MSG_CONFIRM;
+}
+
+
+/**
+ * @brief largest datagram that can be sent to module address.
+ * 
+ * @param module_address 
+ * @return std::size_t 
+ */
+std::size_t uavos::comm::CUDPCommunicator::getMaxDatagramLength (const SOCKET_ADDRESS * module_address) const
+{
+    if (module_address->address.ss_family == AF_UNIX) return MAXLINE_UNIX;
+
+    return MAXLINE;
+}
+
+
+/**
+ * @brief send a message larger than one datagram as fragments.
+ * @details each fragment is a @link FRAGMENT_HEADER @endlink followed by a slice of message.
+ * message is not copied as header and slice are sent as two iovecs.
+ * 
+ * @param socket_fd 
+ * @param message 
+ * @param datalength 
+ * @param module_address 
+ * @param fragment_length max payload per fragment.
+ */
+void uavos::comm::CUDPCommunicator::SendFragmented (const int socket_fd, const char * message, const std::size_t datalength, const SOCKET_ADDRESS * module_address, const std::size_t fragment_length)
+{
+    const std::size_t fragment_count = (datalength + fragment_length - 1) / fragment_length;
+    if ((datalength > FRAGMENT_MAX_MESSAGE_LENGTH) || (fragment_count > UINT16_MAX))
+    {
+        PLOG(plog::error) << "CUDPCommunicator::SendFragmented message is too large:" << datalength; 
+        return ;
+    }
+
+    const uint32_t message_id = m_fragment_message_id++;
+
+    std::vector<FRAGMENT_HEADER> headers(fragment_count);
+    std::vector<struct iovec> iovecs(fragment_count * 2);
+    std::vector<struct mmsghdr> msgs(fragment_count);
+    memset(msgs.data(), 0, sizeof(struct mmsghdr) * fragment_count);
+    
+    for (std::size_t i=0; i<fragment_count; ++i)
+    {
+        const std::size_t offset = i * fragment_length;
+        buildFragmentHeader(headers[i], message_id, datalength, offset, i, fragment_count);
+        
+        iovecs[i*2].iov_base     = &headers[i];
+        iovecs[i*2].iov_len      = sizeof(FRAGMENT_HEADER);
+        iovecs[i*2 + 1].iov_base = (void *) &message[offset];
+        iovecs[i*2 + 1].iov_len  = std::min(fragment_length, datalength - offset);
+        
+        msgs[i].msg_hdr.msg_name    = (void *) &module_address->address;
+        msgs[i].msg_hdr.msg_namelen = module_address->length;
+        msgs[i].msg_hdr.msg_iov     = &iovecs[i*2];
+        msgs[i].msg_hdr.msg_iovlen  = 2;
+    }
+
+    std::size_t sent = 0;
+    unsigned int retries = 0;
+    while (sent < fragment_count)
+    {
+        const unsigned int chunk = std::min<std::size_t>(fragment_count - sent, m_batch_size);
+        const int res = sendmmsg(socket_fd, &msgs[sent], chunk, getSendFlags(module_address));
+        m_tx_syscalls++;
+        if ((res < 0) && (errno == EAGAIN || errno == EWOULDBLOCK) && (retries < FRAGMENT_SEND_RETRIES))
+        {
+            // Unix peer queue is short. give the module a moment to read instead of losing the whole message.
+            retries++;
+            usleep(FRAGMENT_SEND_RETRY_USEC);
+            continue;
+        }
+        
+        if (res <= 0)
+        {
+            // remaining fragments are useless. receiver drops partial message on timeout.
+            PLOG(plog::error) << "CUDPCommunicator::SendFragmented failed errno:" << errno << " sent " << sent << " of " << fragment_count; 
+            return ;
+        }
+        
+        m_tx_messages += res;
+        sent += res;
+    }
+}
+
 
 /**
  * Sends JMSG to Communicator
  **/
-void uavos::comm::CUDPCommunicator::SendMsg(const char * message, const std::size_t datalength, struct sockaddr_in * module_address)
+void uavos::comm::CUDPCommunicator::SendMsg(const char * message, const std::size_t datalength, const SOCKET_ADDRESS * module_address)
 {
     #ifdef DEBUG        
      //   std::cout << _LOG_CONSOLE_TEXT << "SendMsg: " << jmsg << _NORMAL_CONSOLE_TEXT_ << std::endl;
     #endif
     
+    const int socket_fd = getSocketFor(module_address);
+    if (socket_fd == -1) return ;
+
+    const std::size_t max_datagram = getMaxDatagramLength(module_address);
+    if (datalength > max_datagram)
+    {
+        SendFragmented(socket_fd, message, datalength, module_address, max_datagram - sizeof(FRAGMENT_HEADER));
+        return ;
+    }
+
     try
     {
-    sendto(m_SocketFD, message, datalength,  
-        MSG_CONFIRM, (const struct sockaddr *) module_address, 
-            sizeof(struct sockaddr_in));         
+    sendto(socket_fd, message, datalength,  
+        getSendFlags(module_address), (const struct sockaddr *) &module_address->address, 
+            module_address->length);         
+    m_tx_syscalls++;
+    m_tx_messages++;
     }
     catch(const std::exception& e)
     {
         std::cerr << e.what() << '\n';
         PLOG(plog::error) << e.what(); 
     }
-}
\ No newline at end of file
+}
+
+
+/**
+ * @brief Sends the same message to several modules.
+ * @details fan-out is sent using sendmmsg in chunks of @link m_batch_size @endlink
+ * so N subscribers cost N/batch_size syscalls instead of N.
+ * Modules on different transports are sent on their own sockets.
+ * 
+ * @param message 
+ * @param datalength 
+ * @param module_addresses 
+ */
+void uavos::comm::CUDPCommunicator::SendMsgToMany(const char * message, const std::size_t datalength, const std::vector<SOCKET_ADDRESS>& module_addresses)
+{
+    const std::size_t count = module_addresses.size();
+    if (count == 0) return ;
+    
+    if ((count == 1) || (datalength > MAXLINE))
+    {
+        // large messages are fragmented per module.
+        for (const SOCKET_ADDRESS& module_address : module_addresses)
+        {
+            SendMsg(message, datalength, &module_address);
+        }
+        return ;
+    }
+
+    struct iovec iov;
+    iov.iov_base = (void *) message;
+    iov.iov_len  = datalength;
+
+    const int families[] = {AF_INET, AF_UNIX};
+    for (const int family : families)
+    {
+        std::vector<struct mmsghdr> msgs;
+        msgs.reserve(count);
+        int socket_fd = -1;
+        for (std::size_t i=0; i<count; ++i)
+        {
+            if (module_addresses[i].address.ss_family != family) continue;
+            
+            socket_fd = getSocketFor(&module_addresses[i]);
+            struct mmsghdr msg;
+            memset(&msg, 0, sizeof(struct mmsghdr));
+            msg.msg_hdr.msg_name    = (void *) &module_addresses[i].address;
+            msg.msg_hdr.msg_namelen = module_addresses[i].length;
+            msg.msg_hdr.msg_iov     = &iov;
+            msg.msg_hdr.msg_iovlen  = 1;
+            msgs.push_back(msg);
+        }
+
+        if ((msgs.empty()) || (socket_fd == -1)) continue;
+
+        std::size_t sent = 0;
+        while (sent < msgs.size())
+        {
+            const unsigned int chunk = std::min<std::size_t>(msgs.size() - sent, m_batch_size);
+            const int res = sendmmsg(socket_fd, &msgs[sent], chunk, (family == AF_UNIX) ? MSG_DONTWAIT : MSG_CONFIRM);
+            m_tx_syscalls++;
+            if (res <= 0)
+            {
+                if ((res < 0) && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    // receiving module queue is full. drop its copy as UDP would and continue with others.
+                    sent++;
+                    continue;
+                }
+                PLOG(plog::error) << "CUDPCommunicator::SendMsgToMany sendmmsg failed errno:" << errno; 
+                break;
+            }
+            
+            m_tx_messages += res;
+            sent += res;
+        }
+    }
+}
+
+
+void uavos::comm::CUDPCommunicator::TrySendMany(std::vector<OUTBOUND_DATAGRAM>& datagrams)
+{
+    if (m_send_ring)
+    {
+        TrySendManyIOUring(datagrams);
+        return ;
+    }
+
+    const int families[] = {AF_INET, AF_UNIX};
+    for (const int family : families)
+    {
+        std::vector<OUTBOUND_DATAGRAM *> group;
+        std::vector<struct iovec> iovecs;
+        std::vector<struct mmsghdr> msgs;
+        iovecs.reserve(datagrams.size());
+        msgs.reserve(datagrams.size());
+        int socket_fd = -1;
+
+        for (OUTBOUND_DATAGRAM& datagram : datagrams)
+        {
+            if (datagram.address->address.ss_family != family) continue;
+            
+            socket_fd = getSocketFor(datagram.address);
+            if (socket_fd == -1)
+            {
+                datagram.result = -1;
+                continue;
+            }
+
+            if (datagram.length > getMaxDatagramLength(datagram.address))
+            {
+                // fragmented messages are sent on their own.
+                SendMsg(datagram.message, datagram.length, datagram.address);
+                datagram.result = 1;
+                continue;
+            }
+            
+            struct iovec iov;
+            iov.iov_base = (void *) datagram.message;
+            iov.iov_len  = datagram.length;
+            iovecs.push_back(iov);
+
+            struct mmsghdr msg;
+            memset(&msg, 0, sizeof(struct mmsghdr));
+            msg.msg_hdr.msg_name    = (void *) &datagram.address->address;
+            msg.msg_hdr.msg_namelen = datagram.address->length;
+            msg.msg_hdr.msg_iov     = &iovecs.back();
+            msg.msg_hdr.msg_iovlen  = 1;
+            msgs.push_back(msg);
+            
+            group.push_back(&datagram);
+        }
+
+        std::size_t sent = 0;
+        while (sent < msgs.size())
+        {
+            const unsigned int chunk = std::min<std::size_t>(msgs.size() - sent, m_batch_size);
+            const int res = sendmmsg(socket_fd, &msgs[sent], chunk, MSG_DONTWAIT | ((family == AF_INET) ? MSG_CONFIRM : 0));
+            m_tx_syscalls++;
+            if (res > 0)
+            {
+                for (int i=0; i<res; ++i)
+                {
+                    group[sent + i]->result = 1;
+                }
+                m_tx_messages += res;
+                sent += res;
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) 
+            {
+                // UDP socket buffer is full. retry all later.
+                if (family == AF_INET) break;
+
+                // Unix peer queue is full. keep its datagrams in order for later and continue with others.
+                const SOCKET_ADDRESS * busy_address = group[sent]->address;
+                std::size_t kept = sent;
+                for (std::size_t i=sent; i<msgs.size(); ++i)
+                {
+                    if ((group[i]->address->length == busy_address->length)
+                        && (memcmp(&group[i]->address->address, &busy_address->address, busy_address->length) == 0)) continue;
+                    
+                    msgs[kept] = msgs[i];
+                    group[kept] = group[i];
+                    kept++;
+                }
+                msgs.resize(kept);
+                group.resize(kept);
+                continue;
+            }
+
+            // this datagram cannot be delivered e.g. Unix peer has gone. skip it.
+            group[sent]->result = -1;
+            sent++;
+        }
+    }
+}
+
+
+/**
+ * @brief io_uring version of @link TrySendMany @endlink.
+ * @details adjacent datagrams to the same module are linked so a busy module cancels
+ * the rest of its datagrams and they are retried later in order.
+ * 
+ * @param datagrams 
+ */
+void uavos::comm::CUDPCommunicator::TrySendManyIOUring(std::vector<OUTBOUND_DATAGRAM>& datagrams)
+{
+    const std::lock_guard<std::mutex> lock(m_send_ring_lock);
+    CIOUring& ring = *m_send_ring.get();
+
+    const std::size_t count = datagrams.size();
+    std::vector<struct msghdr> headers(count);
+    std::vector<struct iovec> iovecs(count);
+    std::vector<const SOCKET_ADDRESS *> busy_addresses;
+
+    auto isSameAddress = [](const SOCKET_ADDRESS * a, const SOCKET_ADDRESS * b)
+    {
+        return (a == b) || ((a->length == b->length) && (memcmp(&a->address, &b->address, a->length) == 0));
+    };
+
+    auto isBusy = [&](const SOCKET_ADDRESS * address)
+    {
+        for (const SOCKET_ADDRESS * busy_address : busy_addresses)
+        {
+            if (isSameAddress(busy_address, address)) return true;
+        }
+        return false;
+    };
+
+    std::size_t i = 0;
+    while (i < count)
+    {
+        unsigned int prepared = 0;
+        while (i < count)
+        {
+            OUTBOUND_DATAGRAM& datagram = datagrams[i];
+            const int socket_fd = getSocketFor(datagram.address);
+            if ((socket_fd == -1) || (isBusy(datagram.address)))
+            {
+                datagram.result = (socket_fd == -1) ? -1 : 0;
+                i++;
+                continue;
+            }
+
+            if (datagram.length > getMaxDatagramLength(datagram.address))
+            {
+                // fragmented messages are sent on their own.
+                SendMsg(datagram.message, datagram.length, datagram.address);
+                datagram.result = 1;
+                i++;
+                continue;
+            }
+
+            struct io_uring_sqe * sqe = ring.getSQE();
+            if (sqe == NULL) break;
+
+            iovecs[i].iov_base = (void *) datagram.message;
+            iovecs[i].iov_len  = datagram.length;
+            memset(&headers[i], 0, sizeof(struct msghdr));
+            headers[i].msg_name    = (void *) &datagram.address->address;
+            headers[i].msg_namelen = datagram.address->length;
+            headers[i].msg_iov     = &iovecs[i];
+            headers[i].msg_iovlen  = 1;
+
+            sqe->opcode     = IORING_OP_SENDMSG;
+            sqe->fd         = socket_fd;
+            sqe->addr       = (unsigned long) &headers[i];
+            sqe->len        = 1;
+            sqe->msg_flags  = MSG_DONTWAIT;
+            sqe->user_data  = i;
+            if ((i + 1 < count) && (isSameAddress(datagrams[i + 1].address, datagram.address)))
+            {
+                sqe->flags |= IOSQE_IO_LINK;
+            }
+            
+            prepared++;
+            i++;
+        }
+
+        if (prepared == 0) continue;
+
+        const int res = ring.submit(prepared);
+        m_tx_syscalls++;
+        if (res < 0)
+        {
+            PLOG(plog::error) << "CUDPCommunicator io_uring submit failed errno:" << -res; 
+            return ;
+        }
+
+        unsigned int completed = 0;
+        while (completed < prepared)
+        {
+            const struct io_uring_cqe * cqe = ring.peekCQE();
+            if (cqe == NULL)
+            {
+                ring.submit(prepared - completed);
+                continue;
+            }
+
+            OUTBOUND_DATAGRAM& datagram = datagrams[cqe->user_data];
+            if (cqe->res >= 0)
+            {
+                datagram.result = 1;
+                m_tx_messages++;
+            }
+            else if ((cqe->res == -EAGAIN) || (cqe->res == -ECANCELED))
+            {
+                // module is busy. rest of its datagrams wait for next round.
+                datagram.result = 0;
+                if (!isBusy(datagram.address)) busy_addresses.push_back(datagram.address);
+            }
+            else
+            {
+                datagram.result = -1;
+            }
+            
+            ring.seenCQE();
+            completed++;
+        }
+    }
+}
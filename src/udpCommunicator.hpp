@@ -4,15 +4,99 @@
 
 #include <thread>         // std::thread
 #include <mutex>          // std::mutex, std::unique_lock
+#include <atomic>
+#include <vector>
+#include <string>
+#include <sys/socket.h>
+#include <netinet/in.h>
 
+#include "epollReactor.hpp"
+#include "ioUring.hpp"
 
- typedef void (*ONRECEIVE_CALLBACK)(const char *, int len, struct sockaddr_in *  sock);
+// maximum UDP payload size.
+#define MAXLINE 65507 
+
+// maximum Unix domain datagram size. Unix sockets are not limited by IP packet size.
+#define MAXLINE_UNIX (256 * 1024)
+
+// submission entries of io_uring used by sender.
+#define IO_URING_SEND_ENTRIES 64
+
+// socket receive buffer requested for intermodule UDP sockets.
+#define UDP_RECEIVE_BUFFER_SIZE (4 * 1024 * 1024)
+
+// default number of datagrams received or sent per syscall.
+#define DEFAULT_UDP_BATCH_SIZE 16
+
+// datagrams received per syscall on Unix socket. buffers are large so keep it small.
+#define UNIX_BATCH_SIZE 4
+
+// ancillary buffer of each received datagram. room for SCM_TIMESTAMPNS.
+#define RECEIVE_CONTROL_SIZE CMSG_SPACE(sizeof(struct timespec))
+
+
+/**
+ * @brief address of a module over any transport (AF_INET or AF_UNIX).
+ * @details length is needed as abstract Unix addresses are length-sensitive.
+ */
+typedef struct 
+{
+    struct sockaddr_storage address;
+    socklen_t length;
+} SOCKET_ADDRESS;
+
+
+/**
+ * @brief called for each received message.
+ * @details ingress_nsec is kernel receive time (CLOCK_REALTIME) of the message or of its first fragment.
+ */
+ typedef void (*ONRECEIVE_CALLBACK)(const char *, int len, const SOCKET_ADDRESS *  sock, const uint64_t ingress_nsec);
 
 
 namespace uavos
 {
 namespace comm
 {
+
+class CFragmentReassembler;
+
+
+enum ENUM_IO_BACKEND
+{
+    // epoll reactor with recvmmsg/sendmmsg.
+    IO_BACKEND_EPOLL    = 0,
+    // io_uring. falls back to epoll if kernel does not support it.
+    IO_BACKEND_IO_URING = 1
+};
+
+/**
+ * @brief syscall & datagram counters of intermodule socket.
+ * @details ratio of syscalls to messages shows how well batching works.
+ * 
+ */
+typedef struct 
+{
+    uint64_t rx_syscalls;
+    uint64_t rx_messages;
+    uint64_t tx_syscalls;
+    uint64_t tx_messages;
+} UDP_IO_COUNTERS;
+
+
+/**
+ * @brief one datagram of a non-blocking batch send.
+ * @see CUDPCommunicator::TrySendMany
+ */
+typedef struct
+{
+    const char * message;
+    std::size_t length;
+    const SOCKET_ADDRESS * address;
+    // output: 0 not sent as socket is busy, 1 sent, -1 failed and should not be retried.
+    int result;
+} OUTBOUND_DATAGRAM;
+
+
 class CUDPCommunicator
 {
 
@@ -39,24 +123,126 @@ class CUDPCommunicator
         
         ~CUDPCommunicator ();
         void init(const char * host, int listenningPort);
+        
+        /**
+         * @brief Listen on a Unix domain datagram socket as well.
+         * @details co-located modules can register & communicate over it using the same message format.
+         * path starting with '@' means Linux abstract namespace.
+         * should be called after @link init @endlink and before @link start @endlink.
+         * 
+         * @param socket_path 
+         */
+        void initUnix(const char * socket_path);
         void start();
         void stop();
         void SetMessageOnReceive (ONRECEIVE_CALLBACK onReceive);
-        void SendMsg(const char * message, const std::size_t datalength, struct sockaddr_in * module_address);
+        void SendMsg(const char * message, const std::size_t datalength, const SOCKET_ADDRESS * module_address);
+        void SendMsgToMany(const char * message, const std::size_t datalength, const std::vector<SOCKET_ADDRESS>& module_addresses);
+        
+        /**
+         * @brief send datagrams to different modules in as few syscalls as possible without blocking.
+         * @details datagrams to the same module keep their order and should be adjacent. 
+         * once a socket is busy the rest of its datagrams are left with result 0 to be retried.
+         * 
+         * @param datagrams 
+         */
+        void TrySendMany(std::vector<OUTBOUND_DATAGRAM>& datagrams);
+        
+        /**
+         * @brief Set max number of datagrams handled per syscall.
+         * @details should be called before @link start @endlink. 1 means no batching.
+         * 
+         * @param batch_size 
+         */
+        void setBatchSize (const unsigned int batch_size);
+        
+        /**
+         * @brief Set number of receiver threads.
+         * @details each thread owns a socket bound with SO_REUSEPORT to the same port.
+         * should be called before @link init @endlink. 1 means single socket without SO_REUSEPORT.
+         * 
+         * @param receiver_threads 
+         */
+        void setReceiverThreads (const unsigned int receiver_threads);
+
+        /**
+         * @brief send multicast datagrams over loopback only.
+         * @details modules on the same host join groups on 127.0.0.1. should be called before @link init @endlink.
+         * 
+         */
+        void enableLoopbackMulticast ();
+        
+        /**
+         * @brief Select I/O implementation.
+         * @details should be called before @link start @endlink. 
+         * io_uring is checked at start and epoll is used if it is not available.
+         * 
+         * @param io_backend 
+         */
+        void setIOBackend (const ENUM_IO_BACKEND io_backend);
+        ENUM_IO_BACKEND getIOBackend () const { return m_io_backend; }
+        UDP_IO_COUNTERS getIOCounters () const;
+        CEpollReactor * getReactor ();
 
     protected:
         
+        /**
+         * @brief receive buffers of one socket. owned by the thread that drains the socket.
+         * 
+         */
+        typedef struct 
+        {
+            unsigned int batch_size;
+            std::size_t slot_size;
+            std::vector<char> buffers;
+            std::vector<SOCKET_ADDRESS> addresses;
+            std::vector<struct iovec> iovecs;
+            std::vector<struct mmsghdr> msgs;
+            // ancillary data of each slot. holds SO_TIMESTAMPNS.
+            std::vector<char> controls;
+            std::vector<char> reassembled;
+        } RECEIVE_BATCH;
+
+        int createSocket(const char * host, int listenningPort);
+        int getSocketFor(const SOCKET_ADDRESS * module_address) const;
+        int getSendFlags(const SOCKET_ADDRESS * module_address) const;
+        void initReceiveBatch(RECEIVE_BATCH& batch, const unsigned int batch_size, const std::size_t slot_size);
+        void prepareReceiveSlot(RECEIVE_BATCH& batch, const unsigned int index);
+        uint64_t getIngressTime(const RECEIVE_BATCH& batch, const unsigned int index) const;
+        void deliverDatagram(RECEIVE_BATCH& batch, const unsigned int index, const int length, CFragmentReassembler& reassembler);
+        void drainSocket(const int socket_fd, RECEIVE_BATCH& batch, CFragmentReassembler& reassembler);
+        bool runIOUringReceiver(const int socket_fd, CEpollReactor * reactor, RECEIVE_BATCH& batch, CFragmentReassembler& reassembler);
+        void TrySendManyIOUring(std::vector<OUTBOUND_DATAGRAM>& datagrams);
+        std::size_t getMaxDatagramLength(const SOCKET_ADDRESS * module_address) const;
+        void SendFragmented(const int socket_fd, const char * message, const std::size_t datalength, const SOCKET_ADDRESS * module_address, const std::size_t fragment_length);
         void startReceiver();
-        void InternalReceiverEntry();
+        void InternalReceiverEntry(const int socket_fd, const unsigned int reactor_index);
         void InternelSenderIDEntry();
 
         struct sockaddr_in  *m_CommunicatorModuleAddress = NULL; 
         int m_SocketFD = -1; 
-        std::thread m_threadCreateUDPSocket;
+        int m_UnixSocketFD = -1;
+        std::string m_UnixSocketPath;
+        std::vector<int> m_ReceiverSocketFDs;
+        std::vector<std::thread> m_threadReceivers;
+        std::vector<std::unique_ptr<CEpollReactor>> m_reactors;
         pthread_t m_thread;
 
         ONRECEIVE_CALLBACK m_OnReceive = NULL;
         
+        unsigned int m_batch_size = DEFAULT_UDP_BATCH_SIZE;
+        unsigned int m_receiver_threads = 1;
+        bool m_loopback_multicast = false;
+        ENUM_IO_BACKEND m_io_backend = IO_BACKEND_EPOLL;
+        std::unique_ptr<CIOUring> m_send_ring;
+        std::mutex m_send_ring_lock;
+
+        std::atomic<uint64_t> m_rx_syscalls  = {0};
+        std::atomic<uint64_t> m_rx_messages  = {0};
+        std::atomic<uint64_t> m_tx_syscalls  = {0};
+        std::atomic<uint64_t> m_tx_messages  = {0};
+        std::atomic<uint32_t> m_fragment_message_id = {0};
+        
 
     protected:
         bool m_starrted = false;